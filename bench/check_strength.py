@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+# Checks the strength reduction of `*`, `/` and `%` by constants against the
+# unoptimised program, e.g.
+#   python3 bench/check_strength.py ./comp -O1
+# Each divisor gets a program folding x*d, x/d and x%d over a few dozen
+# dividends into a checksum, and --run must print the same at -O0 as with
+# the given flags (-O1 by default). A mismatch is narrowed down to the
+# operation and dividend that differ.
+#
+# Divisors cover ±1, ±2^k, ±(2^k ± 1), INT64_MIN, INT64_MAX, every small
+# value, and the divisors whose magic multiplier overflows into the sign bit
+# and so needs the add (or, negated, subtract) fixup. Dividends cover 0, ±1,
+# ±2^k, INT64_MIN, INT64_MAX and each divisor's multiples and their
+# neighbours, where rounding towards zero goes wrong first.
+import os
+import subprocess
+import sys
+import tempfile
+
+MASK = (1 << 64) - 1
+INT64_MIN = -(1 << 63)
+INT64_MAX = (1 << 63) - 1
+
+
+def wrap(v):
+    v &= MASK
+    return v - (1 << 64) if v >> 63 else v
+
+
+def literal(v):
+    """The 64-bit value v as an expression over int-sized literals."""
+    v = wrap(v)
+    if -(1 << 31) < v < (1 << 31):
+        return "(0 - %d)" % -v if v < 0 else str(v)
+    u = v & MASK
+    return "((%d << 42) | (%d << 21) | %d)" % (u >> 42, (u >> 21) & 0x1FFFFF, u & 0x1FFFFF)
+
+
+def magic_multiplier(d):
+    """The multiplier StrengthReduce.cpp uses for d (Hacker's Delight 10-1)."""
+    two63 = 1 << 63
+    ad = abs(d)
+    t = two63 + (1 if d < 0 else 0)
+    anc = t - 1 - t % ad
+    p = 63
+    q1, r1 = two63 // anc, two63 % anc
+    q2, r2 = two63 // ad, two63 % ad
+    while True:
+        p += 1
+        q1, r1 = (2 * q1) & MASK, (2 * r1) & MASK
+        if r1 >= anc:
+            q1, r1 = q1 + 1, r1 - anc
+        q2, r2 = (2 * q2) & MASK, (2 * r2) & MASK
+        if r2 >= ad:
+            q2, r2 = q2 + 1, r2 - ad
+        delta = ad - r2
+        if not (q1 < delta or (q1 == delta and r1 == 0)):
+            break
+    m = (q2 + 1) & MASK
+    return wrap(-m if d < 0 else m)
+
+
+def needs_fixup(d):
+    ad = abs(d)
+    if ad < 2 or ad & (ad - 1) == 0:
+        return False
+    m = magic_multiplier(d)
+    return (d > 0 and m < 0) or (d < 0 and m > 0)
+
+
+def divisors():
+    ds = {1, -1, INT64_MIN, INT64_MAX, INT64_MIN + 1}
+    for k in range(1, 63):
+        for v in ((1 << k), (1 << k) + 1, (1 << k) - 1):
+            ds.update((v, -v))
+    ds.update(range(-64, 65))
+    # The first divisors needing the fixup, and some wide ones
+    found = 0
+    d = 3
+    while found < 32:
+        if needs_fixup(d):
+            ds.update((d, -d))
+            found += 1
+        d += 1
+    for k in range(8, 63, 3):
+        for v in ((1 << k) // 3, (1 << k) // 5 + 1, (1 << k) // 7, (1 << k) * 5 // 7):
+            if needs_fixup(v):
+                ds.update((v, -v))
+    ds.discard(0)
+    return sorted(wrap(d) for d in ds)
+
+
+def dividends(d):
+    xs = {0, 1, -1, 2, -2, 3, -3, 7, -7, 100, -100, INT64_MIN, INT64_MIN + 1, INT64_MAX, INT64_MAX - 1}
+    for k in (31, 32, 62):
+        xs.update((1 << k, -(1 << k)))
+    ad = abs(d)
+    for q in {1, 2, 3, 1000, INT64_MAX // ad}:
+        for x in (q * ad - 1, q * ad, q * ad + 1):
+            xs.update((x, -x))
+    return sorted({wrap(x) for x in xs})
+
+
+def program(d, xs, ops):
+    out = ["int pick(int i) {"]
+    for i, x in enumerate(xs):
+        out.append("    if (i == %d) { return %s; }" % (i, literal(x)))
+    out += ["    return 0;", "}", "int main() {", "    int s = 0;", "    int x;", "    int i;",
+            "    for (i = 0; i < %d; i = i + 1) {" % len(xs), "        x = pick(i);"]
+    for op in ops:
+        out.append("        s = s * 31 + x %s %s;" % (op, literal(d)))
+    out += ["    }", "    return s;", "}"]
+    return "\n".join(out) + "\n"
+
+
+def run(comp, flags, source):
+    with tempfile.NamedTemporaryFile("w", suffix=".c", delete=False) as f:
+        f.write(source)
+    try:
+        result = subprocess.run([comp] + flags + ["--run", f.name], capture_output=True, text=True)
+        lines = (result.stdout + result.stderr).splitlines()
+        return lines[0] if lines else "exit status %d" % result.returncode
+    finally:
+        os.unlink(f.name)
+
+
+def main():
+    comp = sys.argv[1] if len(sys.argv) > 1 else "./comp"
+    flags = sys.argv[2:] or ["-O1"]
+    failures = 0
+    ds = divisors()
+    for d in ds:
+        xs = dividends(d)
+        ops = ["*", "/", "%"]
+        if run(comp, ["-O0"], program(d, xs, ops)) == run(comp, flags, program(d, xs, ops)):
+            continue
+        failures += 1
+        # Paired with 0 so the loop still runs twice and cannot fold away
+        for op in ops:
+            for x in xs:
+                expected = run(comp, ["-O0"], program(d, [0, x], [op]))
+                actual = run(comp, flags, program(d, [0, x], [op]))
+                if expected != actual:
+                    print("%d %s %d: -O0 '%s', %s '%s'" % (x, op, d, expected, " ".join(flags), actual))
+                    break
+    print("%d divisors checked, %d failing" % (len(ds), failures))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,15 @@
+#!/bin/sh
+# Compares the moves and spills linear scan and iterated register coalescing
+# leave over the benchmark corpus, e.g.
+#   sh bench/compare_regalloc.sh ./comp
+# Each program is compiled at -O2 as is and with the TAC-level coalesce pass
+# off, which leaves every copy out of SSA form to the allocators.
+COMP=${1:-./comp}
+DIR=$(dirname "$0")
+python3 "$DIR/gen_temps.py" 400 > /tmp/regalloc_temps.c
+for f in "$DIR"/*.c /tmp/regalloc_temps.c; do
+    for flags in "-O2" "-O2 -fno-coalesce"; do
+        echo "$f $flags:"
+        $COMP $flags --bench-regalloc "$f" 2>&1 | grep '^total' | sed 's/^/    /'
+    done
+done
@@ -0,0 +1,23 @@
+#!/usr/bin/env python3
+# Emits a single large function for timing the mid-end, e.g.
+#   python3 bench/gen_temps.py 8000 > big.c && ./comp --bench-dataflow big.c
+# Every statement allocates several temporaries; ifs and whiles are sprinkled
+# in so the CFG has joins and back edges, and short-circuit operators produce
+# temporaries that live across blocks.
+import sys
+
+n = int(sys.argv[1]) if len(sys.argv) > 1 else 8000
+out = ["int main() {", "    int a = 1;", "    int b = 2;", "    int c = 3;"]
+for i in range(n):
+    k = i % 10
+    if k == 3:
+        out.append("    if (a < %d) { b = b + a * %d; } else { c = c - b; }" % (i, i % 7))
+    elif k in (1, 5, 9):
+        out.append("    a = (a < %d && b > c) || c == %d;" % (i, i % 17))
+    elif k == 7:
+        out.append("    while (c > %d) { c = c - 1; a = a + c; }" % (i % 13))
+    else:
+        out.append("    a = (a + b * %d) ^ (c - %d);" % (i % 11, i % 5))
+out.append("    return a + b + c;")
+out.append("}")
+print("\n".join(out))
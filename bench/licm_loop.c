@@ -0,0 +1,21 @@
+// Loop with invariant work for the LICM pass. Compare the instruction
+// counts of
+//   ./comp -O1 --run bench/licm_loop.c
+//   ./comp -O1 -fno-licm --run bench/licm_loop.c
+// kernel() runs 1000 iterations; the products, shifts and loads of a, b
+// and c do not change inside the loop and leave it at -O1.
+int kernel(int a, int b, int c) {
+    int sum = 0;
+    int i = 0;
+    while (i < 1000) {
+        int scale = a * b + (c << 2);
+        int bias = (a - c) * 5;
+        sum = sum + scale * i - bias;
+        i = i + 1;
+    }
+    return sum;
+}
+
+int main() {
+    return kernel(7, 3, 11);
+}
@@ -0,0 +1,49 @@
+// Loops whose variables rotate through each other, leaving copies behind
+// when SSA form is taken apart, for comparing the register allocators:
+//   ./comp -O2 -fno-coalesce --bench-regalloc bench/regalloc_moves.c
+int fib(int n) {
+    int a = 0;
+    int b = 1;
+    int i = 0;
+    while (i < n) {
+        int t = a + b;
+        a = b;
+        b = t;
+        i = i + 1;
+    }
+    return a;
+}
+
+int gcd(int x, int y) {
+    while (y != 0) {
+        int r = x % y;
+        x = y;
+        y = r;
+    }
+    return x;
+}
+
+int tribonacci(int n) {
+    int a = 0;
+    int b = 0;
+    int c = 1;
+    int i = 0;
+    while (i < n) {
+        int d = a + b + c;
+        a = b;
+        b = c;
+        c = d % 1000007;
+        i = i + 1;
+    }
+    return a;
+}
+
+int main() {
+    int sum = 0;
+    int k = 1;
+    while (k < 40) {
+        sum = sum + fib(k) % 1000 + gcd(k * 391, 4301) + tribonacci(k * 3);
+        k = k + 1;
+    }
+    return sum;
+}
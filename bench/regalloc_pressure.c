@@ -0,0 +1,27 @@
+// More values live around a loop with calls than there are registers, for
+// comparing the register allocators:
+//   ./comp -O2 --bench-regalloc bench/regalloc_pressure.c
+// The sixteen accumulators cross the calls to g() and h(), so only the
+// callee-saved registers can hold them and some must spill.
+int g(int x) { return x + 1; }
+
+int h(int a, int b, int c, int d, int e, int f) {
+    return a * 1 + b * 2 + c * 3 + d * 4 + e * 5 + f * 6;
+}
+
+int main() {
+    int a = 1; int b = 2; int c = 3; int d = 4; int e = 5; int f = 6; int i = 7; int j = 8;
+    int k = 9; int l = 10; int m = 11; int n = 12; int o = 13; int p = 14; int q = 15; int r = 16;
+    int s = 0;
+    int w = 0;
+    while (w < 50) {
+        a = a + g(b); b = b + g(c); c = c + d; d = d + e; e = e + f; f = f + i; i = i + j; j = j + k;
+        k = k + l; l = l + m; m = m + n; n = n + o; o = o + p; p = p + q; q = q + r; r = r + g(a);
+        s = s + h(a, b, c, d, e, f) % 1000 + i + j + k + l + m + n + o + p + q + r;
+        s = s % 100000;
+        a = a % 1000; b = b % 1000; c = c % 1000; d = d % 1000; e = e % 1000; f = f % 1000; i = i % 1000; j = j % 1000;
+        k = k % 1000; l = l % 1000; m = m % 1000; n = n % 1000; o = o % 1000; p = p % 1000; q = q % 1000; r = r % 1000;
+        w = w + 1;
+    }
+    return s + a + r;
+}
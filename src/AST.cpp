@@ -1,4 +1,5 @@
 #include "AST.h"
 int AST::tempVarCounter = 0;
 std::vector<std::pair<std::string, std::string>> AST::loopLabels;
-std::vector<std::string> AST::switchLabels;
\ No newline at end of file
+std::vector<std::string> AST::switchLabels;
+int SwitchStmt::tableMinDensity = 40;
@@ -2,7 +2,10 @@
 
 #include "lexer.h"
 #include "TAC.h"
+#include "Eval.h"
+#include "SwitchLowering.h"
 #include "SymbolTable.h"
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -47,6 +50,26 @@ class Expr : public AST {
 public:
   virtual ~Expr() = default;
   virtual void print() = 0;
+
+  // Code for the expression as a condition: it jumps to trueLabel if the
+  // value is nonzero and to falseLabel if it is zero. An empty label falls
+  // through to the code that follows instead. By default the value is
+  // computed and tested against zero.
+  virtual std::vector<TAC> generateBranch(const std::string &trueLabel, const std::string &falseLabel) {
+    std::string condTemp;
+    std::vector<TAC> code = generateTAC(condTemp);
+    if (trueLabel.empty()) {
+      code.push_back(TAC("beqz", condTemp, falseLabel, ""));
+    } else {
+      code.push_back(TAC("bnez", condTemp, trueLabel, ""));
+      if (!falseLabel.empty()) code.push_back(TAC("jmp", "", "", falseLabel));
+    }
+    return code;
+  }
+
+  // The value, if the expression is a constant one (as case labels must
+  // be), with the semantics the TAC it compiles to would compute.
+  virtual bool constantValue(int64_t &) { return false; }
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -83,6 +106,18 @@ public:
       return code;
   }
 
+  bool constantValue(int64_t &value) override {
+      value = this->value;
+      return true;
+  }
+
+  // A constant condition always goes the same way
+  std::vector<TAC> generateBranch(const std::string &trueLabel, const std::string &falseLabel) override {
+      const std::string &target = value ? trueLabel : falseLabel;
+      if (target.empty()) return {};
+      return {TAC("jmp", "", "", target)};
+  }
+
   void resolveSymbol(SymbolTable &symTab) override {}
 };
 
@@ -104,12 +139,18 @@ class ArgList {
     }
   
     std::vector<TAC> generateTAC(std::vector<TAC> &code) {
+      // Evaluate every argument first, so calls nested in the arguments
+      // cannot interleave their own `arg`s with ours
+      std::vector<std::string> argTemps;
       for (auto &arg : args) {
         std::string tempVar;
         auto argCode = arg->generateTAC(tempVar);
         code.insert(code.end(), argCode.begin(), argCode.end());
-  
-        // Push argument before the function call
+        argTemps.push_back(tempVar);
+      }
+
+      // Push the arguments right before the function call
+      for (auto &tempVar : argTemps) {
         code.push_back(TAC("arg", tempVar, "", ""));
       }
       return code;
@@ -165,6 +206,48 @@ public:
       cout << endl;
     }
 
+    // Map TokenType to TAC operation
+    std::string opcode() const {
+        std::string opStr;
+        #define TOKEN_TO_STRING(token, str) \
+        case TokenType::token:          \
+          opStr = str;               \
+            break;
+
+        switch(op){
+          TOKEN_TO_STRING(PLUS, "+")
+          TOKEN_TO_STRING(MINUS, "-")
+          TOKEN_TO_STRING(MUL, "*")
+          TOKEN_TO_STRING(DIV, "/")
+          TOKEN_TO_STRING(MOD, "%")
+          TOKEN_TO_STRING(BITWISE_AND, "&")
+          TOKEN_TO_STRING(BITWISE_OR, "|")
+          TOKEN_TO_STRING(BITWISE_XOR, "^")
+          TOKEN_TO_STRING(LEFT_SHIFT, "<<")
+          TOKEN_TO_STRING(RIGHT_SHIFT, ">>")
+          TOKEN_TO_STRING(LOGICAL_AND, "&&")
+          TOKEN_TO_STRING(LOGICAL_OR, "||")
+          TOKEN_TO_STRING(EQUAL_EQUAL, "==")
+          TOKEN_TO_STRING(NOT_EQUAL, "!=")
+          TOKEN_TO_STRING(LESS_THAN, "<")
+          TOKEN_TO_STRING(GREATER_THAN, ">")
+          TOKEN_TO_STRING(LESS_THAN_EQUAL, "<=")
+          TOKEN_TO_STRING(GREATER_THAN_EQUAL, ">=")
+        }
+        #undef TOKEN_TO_STRING
+        return opStr;
+    }
+
+    bool constantValue(int64_t &value) override {
+        int64_t a, b;
+        if (!left->constantValue(a) || !right->constantValue(b)) return false;
+        // As generateTAC evaluates them, without normalising the right operand
+        if (op == TokenType::LOGICAL_AND) value = a ? b : 0;
+        else if (op == TokenType::LOGICAL_OR) value = a ? 1 : b;
+        else return evalTAC(opcode(), a, b, value);
+        return true;
+    }
+
  std::vector<TAC> generateTAC(std::string &tempVar) override {
         std::vector<TAC> code;
         std::string leftTemp, rightTemp;
@@ -220,38 +303,51 @@ public:
         // Create a new temporary variable
         tempVar = "t" + std::to_string(tempVarCounter++);
         
-        // Map TokenType to TAC operation
-        std::string opStr;
-        #define TOKEN_TO_STRING(token, str) \
-        case TokenType::token:          \
-          opStr = str;               \
-            break;
+        // Emit TAC for binary operation
+        code.push_back(TAC(opcode(), leftTemp, rightTemp, tempVar));
 
-        switch(op){
-          TOKEN_TO_STRING(PLUS, "+")
-          TOKEN_TO_STRING(MINUS, "-")
-          TOKEN_TO_STRING(MUL, "*")
-          TOKEN_TO_STRING(DIV, "/")
-          TOKEN_TO_STRING(MOD, "%")
-          TOKEN_TO_STRING(BITWISE_AND, "&")
-          TOKEN_TO_STRING(BITWISE_OR, "|")
-          TOKEN_TO_STRING(BITWISE_XOR, "^")
-          TOKEN_TO_STRING(LEFT_SHIFT, "<<")
-          TOKEN_TO_STRING(RIGHT_SHIFT, ">>")
-          TOKEN_TO_STRING(LOGICAL_AND, "&&")
-          TOKEN_TO_STRING(LOGICAL_OR, "||")
-          TOKEN_TO_STRING(EQUAL_EQUAL, "==")
-          TOKEN_TO_STRING(NOT_EQUAL, "!=")
-          TOKEN_TO_STRING(LESS_THAN, "<")
-          TOKEN_TO_STRING(GREATER_THAN, ">")
-          TOKEN_TO_STRING(LESS_THAN_EQUAL, "<=")
-          TOKEN_TO_STRING(GREATER_THAN_EQUAL, ">=")
+        return code;
+    }
+
+    // && and || pass the labels down to their operands, and comparisons
+    // branch on their operands directly, so no truth value is computed
+    std::vector<TAC> generateBranch(const std::string &trueLabel, const std::string &falseLabel) override {
+        std::vector<TAC> code;
+        if (op == TokenType::LOGICAL_AND || op == TokenType::LOGICAL_OR) {
+            // The left operand decides on its own when false for &&, when true for ||
+            bool isAnd = op == TokenType::LOGICAL_AND;
+            std::string decided = isAnd ? falseLabel : trueLabel;
+            std::string skipLabel = decided.empty() ? "L" + std::to_string(AST::tempVarCounter++) : decided;
+            auto leftCode = isAnd ? left->generateBranch("", skipLabel) : left->generateBranch(skipLabel, "");
+            code.insert(code.end(), leftCode.begin(), leftCode.end());
+            auto rightCode = right->generateBranch(trueLabel, falseLabel);
+            code.insert(code.end(), rightCode.begin(), rightCode.end());
+            if (decided.empty()) code.push_back(TAC("label", skipLabel, "", ""));
+            return code;
         }
-        #undef TOKEN_TO_STRING
 
-        // Emit TAC for binary operation
-        code.push_back(TAC(opStr, leftTemp, rightTemp, tempVar));
+        std::string branchOp, invertedOp;
+        switch (op) {
+          case TokenType::EQUAL_EQUAL: branchOp = "beq"; invertedOp = "bne"; break;
+          case TokenType::NOT_EQUAL: branchOp = "bne"; invertedOp = "beq"; break;
+          case TokenType::LESS_THAN: branchOp = "blt"; invertedOp = "bge"; break;
+          case TokenType::GREATER_THAN: branchOp = "bgt"; invertedOp = "ble"; break;
+          case TokenType::LESS_THAN_EQUAL: branchOp = "ble"; invertedOp = "bgt"; break;
+          case TokenType::GREATER_THAN_EQUAL: branchOp = "bge"; invertedOp = "blt"; break;
+          default: return Expr::generateBranch(trueLabel, falseLabel);
+        }
 
+        std::string leftTemp, rightTemp;
+        auto leftCode = left->generateTAC(leftTemp);
+        code.insert(code.end(), leftCode.begin(), leftCode.end());
+        auto rightCode = right->generateTAC(rightTemp);
+        code.insert(code.end(), rightCode.begin(), rightCode.end());
+        if (trueLabel.empty()) {
+          code.push_back(TAC(invertedOp, leftTemp, rightTemp, falseLabel));
+        } else {
+          code.push_back(TAC(branchOp, leftTemp, rightTemp, trueLabel));
+          if (!falseLabel.empty()) code.push_back(TAC("jmp", "", "", falseLabel));
+        }
         return code;
     }
 
@@ -301,6 +397,22 @@ public:
     return code;
   }
 
+  bool constantValue(int64_t &value) override {
+    int64_t operand;
+    if (!expr->constantValue(operand)) return false;
+    if (op == TokenType::MINUS) value = evalOp(EvalOp::Neg, operand, 0);
+    else if (op == TokenType::COMPLEMENT) value = evalOp(EvalOp::Not, operand, 0);
+    else if (op == TokenType::LOGICAL_NOT) value = evalOp(EvalOp::Seqz, operand, 0);
+    else return false;
+    return true;
+  }
+
+  // A negated condition swaps the targets
+  std::vector<TAC> generateBranch(const std::string &trueLabel, const std::string &falseLabel) override {
+    if (op == TokenType::LOGICAL_NOT) return expr->generateBranch(falseLabel, trueLabel);
+    return Expr::generateBranch(trueLabel, falseLabel);
+  }
+
   void resolveSymbol(SymbolTable &symTab) override {
     expr->resolveSymbol(symTab);
   }
@@ -327,18 +439,21 @@ class Assignment : public Expr {
 
   std::vector<TAC> generateTAC(std::string &tempVar) override {
     std::vector<TAC> code;
-    std::string nameTemp, valueTemp;
+    std::string valueTemp;
     
-    // Generate TAC for the name
-    auto nameCode = name->generateTAC(nameTemp);
-    code.insert(code.end(), nameCode.begin(), nameCode.end());
+    // The target names the variable to store into; it is not evaluated
+    auto *target = dynamic_cast<Variable*>(name.get());
+    if (!target) {
+      std::cerr << "ERROR: Invalid assignment target" << std::endl;
+      exit(1);
+    }
     
     // Generate TAC for the value
     auto valueCode = value->generateTAC(valueTemp);
     code.insert(code.end(), valueCode.begin(), valueCode.end());
     
     // Emit TAC for assignment
-    code.push_back(TAC("store", valueTemp, "", nameTemp));
+    code.push_back(TAC("store", valueTemp, "", target->name));
 
     tempVar = valueTemp;
     
@@ -409,9 +524,17 @@ class CompoundAssignment : public Expr {
       }
       #undef TOKEN_TO_STRING
   
+      auto *target = dynamic_cast<Variable*>(left.get());
+      if (!target) {
+        std::cerr << "ERROR: Invalid assignment target" << std::endl;
+        exit(1);
+      }
+
       // Emit TAC for compound assignment operation
       code.push_back(TAC(opStr, nameTemp, valueTemp, resultTemp));
-      code.push_back(TAC("store", resultTemp, "", nameTemp));
+      code.push_back(TAC("store", resultTemp, "", target->name));
+
+      tempVar = resultTemp;
   
       return code;
     }
@@ -444,21 +567,18 @@ class TernaryOp : public Expr {
   
     std::vector<TAC> generateTAC(std::string &tempVar) override {
       std::vector<TAC> code;
-      std::string condTemp;
-  
-      // 1. Generate TAC for the condition
-      auto condCode = condition->generateTAC(condTemp);
-      code.insert(code.end(), condCode.begin(), condCode.end());
   
-      // 2. Create labels
+      // 1. Create labels and the result temporary
       std::string trueLabel = "L" + std::to_string(AST::tempVarCounter++);
       std::string falseLabel = "L" + std::to_string(AST::tempVarCounter++);
       std::string endLabel = "L" + std::to_string(AST::tempVarCounter++);
+      tempVar = "t" + std::to_string(AST::tempVarCounter++);
   
-      // 3. Conditional jump: Jump to falseLabel if condition is false
-      code.push_back(TAC("beqz", condTemp, falseLabel, ""));
+      // 2. The condition jumps to falseLabel if false, else falls through
+      auto condCode = condition->generateBranch("", falseLabel);
+      code.insert(code.end(), condCode.begin(), condCode.end());
   
-      // 4. True expression
+      // 3. True expression
       code.push_back(TAC("label", trueLabel, "", ""));
       std::string trueTemp;
       auto trueCode = trueExpr->generateTAC(trueTemp);
@@ -466,14 +586,14 @@ class TernaryOp : public Expr {
       code.push_back(TAC("move", trueTemp, "", tempVar)); // Store result in tempVar
       code.push_back(TAC("jmp", "", "", endLabel)); // Jump to end
   
-      // 5. False expression
+      // 4. False expression
       code.push_back(TAC("label", falseLabel, "", ""));
       std::string falseTemp;
       auto falseCode = falseExpr->generateTAC(falseTemp);
       code.insert(code.end(), falseCode.begin(), falseCode.end());
       code.push_back(TAC("move", falseTemp, "", tempVar)); // Store result in tempVar
   
-      // 6. End label
+      // 5. End label
       code.push_back(TAC("label", endLabel, "", ""));
   
       return code;
@@ -696,13 +816,8 @@ public:
 
   std::vector<TAC> generateTAC(std::string &tempVar) override {
     std::vector<TAC> code;
-    std::string condTemp;
-
-    // 1. Generate TAC for the condition, storing the result in condTemp
-    auto condCode = condition->generateTAC(condTemp);
-    code.insert(code.end(), condCode.begin(), condCode.end());
 
-    // 2. Create labels
+    // 1. Create labels
     std::string thenLabel = "L" + std::to_string(AST::tempVarCounter++); // Label for the 'then' block
     std::string elseLabel = ""; // Initialize to empty string
     std::string endLabel = "L" + std::to_string(AST::tempVarCounter++);
@@ -711,28 +826,30 @@ public:
       elseLabel = "L" + std::to_string(AST::tempVarCounter++);
     }
 
-    // 3. Conditional jump: Jump to elseLabel if condition is false (0)
-    code.push_back(TAC("beqz", condTemp, elseLabel.empty() ? endLabel : elseLabel, "")); // Jump to end if no else
+    // 2. The condition jumps to elseLabel if false (to the end if no else),
+    //    and falls through into the then block if true
+    auto condCode = condition->generateBranch("", elseLabel.empty() ? endLabel : elseLabel);
+    code.insert(code.end(), condCode.begin(), condCode.end());
 
 
-    // 4. Then block
+    // 3. Then block
     code.push_back(TAC("label", thenLabel, "", "")); // Label the then block
     auto thenCode = thenBlock->generateTAC(tempVar);
     code.insert(code.end(), thenCode.begin(), thenCode.end());
 
-    // 5. Jump to end if there's an else block
+    // 4. Jump to end if there's an else block
     if (elseBlock) {
       code.push_back(TAC("jmp", "", "", endLabel));
     }
 
-    // 6. Else block (if it exists)
+    // 5. Else block (if it exists)
     if (elseBlock) {
       code.push_back(TAC("label", elseLabel, "", "")); // Label the else block
       auto elseCode = elseBlock->generateTAC(tempVar);
       code.insert(code.end(), elseCode.begin(), elseCode.end());
     }
 
-    // 7. End label
+    // 6. End label
     code.push_back(TAC("label", endLabel, "", ""));
 
     return code;
@@ -770,7 +887,6 @@ public:
 
   std::vector<TAC> generateTAC(std::string &tempVar) override {
     std::vector<TAC> code;
-    std::string condTemp;
 
     // 1. Create labels
     std::string startLabel = "L" + std::to_string(AST::tempVarCounter++);
@@ -782,21 +898,18 @@ public:
     // 2. Start label
     code.push_back(TAC("label", startLabel, "", ""));
 
-    // 3. Generate TAC for the condition, storing the result in condTemp
-    auto condCode = condition->generateTAC(condTemp);
+    // 3. The condition jumps to endLabel if false (0)
+    auto condCode = condition->generateBranch("", endLabel);
     code.insert(code.end(), condCode.begin(), condCode.end());
 
-    // 4. Conditional jump: Jump to endLabel if condition is false (0)
-    code.push_back(TAC("beqz", condTemp, endLabel, ""));
-
-    // 5. Body
+    // 4. Body
     auto bodyCode = body->generateTAC(tempVar);
     code.insert(code.end(), bodyCode.begin(), bodyCode.end());
 
-    // 6. Jump to startLabel
+    // 5. Jump to startLabel
     code.push_back(TAC("jmp", "", "", startLabel));
 
-    // 7. End label
+    // 6. End label
     code.push_back(TAC("label", endLabel, "", ""));
 
     // Pop loop labels after processing
@@ -837,7 +950,6 @@ public:
 
   std::vector<TAC> generateTAC(std::string &tempVar) override {
     std::vector<TAC> code;
-    std::string condTemp;
 
     // 1. Create labels
     std::string startLabel = "L" + std::to_string(AST::tempVarCounter++);
@@ -854,26 +966,23 @@ public:
     // 3. Start label
     code.push_back(TAC("label", startLabel, "", ""));
     
-    // 4. Generate TAC for the condition, storing the result in condTemp
-    auto condCode = cond->generateTAC(condTemp);
+    // 4. The condition jumps to endLabel if false (0)
+    auto condCode = cond->generateBranch("", endLabel);
     code.insert(code.end(), condCode.begin(), condCode.end());
     
-    // 5. Conditional jump: Jump to endLabel if condition is false (0)
-    code.push_back(TAC("beqz", condTemp, endLabel, ""));
-    
-    // 6. Body
+    // 5. Body
     auto bodyCode = body->generateTAC(tempVar);
     code.insert(code.end(), bodyCode.begin(), bodyCode.end());
     
-    // 7. Increment
+    // 6. Increment
     code.push_back(TAC("label", incLabel, "", ""));
     auto incCode = inc->generateTAC(tempVar);
     code.insert(code.end(), incCode.begin(), incCode.end());
     
-    // 8. Jump to startLabel
+    // 7. Jump to startLabel
     code.push_back(TAC("jmp", "", "", startLabel));
     
-    // 9. End label
+    // 8. End label
     code.push_back(TAC("label", endLabel , "", ""));
 
     AST::loopLabels.pop_back();
@@ -911,7 +1020,6 @@ public:
 
   std::vector<TAC> generateTAC(std::string &tempVar) override {
     std::vector<TAC> code;
-    std::string condTemp;
 
     // 1. Create labels
     std::string startLabel = "L" + std::to_string(AST::tempVarCounter++);
@@ -928,15 +1036,12 @@ public:
     auto bodyCode = body->generateTAC(tempVar);
     code.insert(code.end(), bodyCode.begin(), bodyCode.end());
     
-    // 4. Generate TAC for the condition, storing the result in condTemp
-    auto condCode = cond->generateTAC(condTemp);
+    // 4. The condition jumps to startLabel if true (1)
+    auto condCode = cond->generateBranch(startLabel, "");
     code.push_back(TAC("label", condLabel, "", ""));
     code.insert(code.end(), condCode.begin(), condCode.end());
-    
-    // 5. Conditional jump: Jump to startLabel if condition is true (1)
-    code.push_back(TAC("bnez", condTemp, startLabel, ""));
 
-    // 6. End label
+    // 5. End label
     code.push_back(TAC("label", endLabel, "", ""));
 
     AST::loopLabels.pop_back();
@@ -1006,6 +1111,9 @@ public:
   std::vector<std::pair<std::unique_ptr<Expr>, std::unique_ptr<Stmt>>> cases;
   std::unique_ptr<Stmt> defaultCase;
 
+  // Least percentage of the values a jump table spans that must be cases
+  static int tableMinDensity;
+
   SwitchStmt(std::unique_ptr<Expr> expr) : expr(std::move(expr)) {}
 
   void addCase(std::unique_ptr<Expr> caseExpr, std::unique_ptr<Stmt> caseStmt) {
@@ -1040,7 +1148,7 @@ public:
 
     // 2. Create labels for each case
     std::vector<std::string> caseLabels;
-    for (int i = 0; i < cases.size(); i++) {
+    for (size_t i = 0; i < cases.size(); i++) {
         caseLabels.push_back("L" + std::to_string(AST::tempVarCounter++));
     }
     std::string defaultLabel = defaultCase ? "L" + std::to_string(AST::tempVarCounter++) : ""; 
@@ -1048,40 +1156,57 @@ public:
 
     AST::switchLabels.push_back(endLabel);
 
-    // 3. Emit conditional jumps for each case
-    for (int i = 0; i < cases.size(); i++) {
-        std::string caseTemp;
-        auto caseCode = cases[i].first->generateTAC(caseTemp);
-        code.insert(code.end(), caseCode.begin(), caseCode.end());
-
-        // If exprTemp == caseTemp, jump to corresponding case label
-        code.push_back(TAC("beq", exprTemp, caseTemp, caseLabels[i]));
+    // 3. Generate TAC for each case statement and the default
+    std::vector<std::vector<TAC>> caseCode;
+    for (auto &case_ : cases) caseCode.push_back(case_.second->generateTAC(tempVar));
+    std::vector<TAC> defaultCode;
+    if (defaultCase) defaultCode = defaultCase->generateTAC(tempVar);
+
+    // 4. Case values are known at compile time; a case with no code of its
+    //    own goes wherever it falls through to
+    std::string otherwise = defaultCase && !defaultCode.empty() ? defaultLabel : endLabel;
+    std::vector<std::string> targets(cases.size());
+    std::vector<SwitchCase> dispatch;
+    for (size_t i = cases.size(); i-- > 0;) {
+        targets[i] = !caseCode[i].empty() ? caseLabels[i] : i + 1 < cases.size() ? targets[i + 1] : otherwise;
     }
-
-    // 4. Jump to default case if it exists, otherwise jump to end
-    if (!defaultLabel.empty()) {
-        code.push_back(TAC("jmp", "", "", defaultLabel));
-    } else {
-        code.push_back(TAC("jmp", "", "", endLabel));
+    for (size_t i = 0; i < cases.size(); i++) {
+        int64_t value;
+        if (!cases[i].first->constantValue(value)) {
+            std::cerr << "ERROR: case label is not a constant expression" << std::endl;
+            exit(1);
+        }
+        for (const auto &earlier : dispatch) {
+            if (earlier.value == value) {
+                std::cerr << "ERROR: duplicate case value " << value << std::endl;
+                exit(1);
+            }
+        }
+        dispatch.push_back({value, targets[i]});
     }
+    dispatch.erase(std::remove_if(dispatch.begin(), dispatch.end(),
+                                  [&](const SwitchCase &c) { return c.label == otherwise; }),
+                   dispatch.end());
+
+    // 5. Jump tables, bit tests or a search tree choose the case
+    auto dispatchCode = lowerSwitch(exprTemp, dispatch, otherwise, tableMinDensity, AST::tempVarCounter);
+    code.insert(code.end(), dispatchCode.begin(), dispatchCode.end());
 
-    // 5. Emit TAC for each case statement
-    for (int i = 0; i < cases.size(); i++) {
+    // 6. Emit TAC for each case statement
+    for (size_t i = 0; i < cases.size(); i++) {
         code.push_back(TAC("label", caseLabels[i], "", ""));
-        auto caseCode = cases[i].second->generateTAC(tempVar);
-        code.insert(code.end(), caseCode.begin(), caseCode.end());
+        code.insert(code.end(), caseCode[i].begin(), caseCode[i].end());
 
         // No automatic jump to endLabel to allow fall-through behavior
     }
 
-    // 6. Default case
+    // 7. Default case
     if (!defaultLabel.empty()) {
         code.push_back(TAC("label", defaultLabel, "", ""));
-        auto defaultCode = defaultCase->generateTAC(tempVar);
         code.insert(code.end(), defaultCode.begin(), defaultCode.end());
     }
 
-    // 7. End label
+    // 8. End label
     code.push_back(TAC("label", endLabel, "", ""));
 
     AST::switchLabels.pop_back();
@@ -1158,6 +1283,7 @@ public:
   std::string name;
   std::vector<std::string> params;
   std::unique_ptr<Block> body;
+  bool inlineHint = false; // Declared `inline`
 
   FuncDecl(const std::string &name, std::vector<std::string> params, std::unique_ptr<Block> body)
       : name(name), params(std::move(params)), body(std::move(body)) {}
@@ -1176,7 +1302,7 @@ public:
 
   std::vector<TAC> generateTAC(std::string &tempVar) override {
     std::vector<TAC> code;
-    code.push_back(TAC("function", name, "", ""));
+    code.push_back(TAC("function", name, inlineHint ? "inline" : "", ""));
     
     // Emit TAC for function parameters
     for (const auto &param : params) {
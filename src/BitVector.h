@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Dense fixed-size bitset. Set operations work a 64-bit word at a time, which
+// is what keeps the dataflow solver fast on functions with many temporaries.
+class BitVector {
+    private:
+        std::vector<uint64_t> words;
+        size_t nbits = 0;
+
+        void clearTail() {
+            if (nbits % 64) words.back() &= (uint64_t(1) << (nbits % 64)) - 1;
+        }
+
+    public:
+        BitVector(size_t n = 0, bool value = false)
+            : words((n + 63) / 64, value ? ~uint64_t(0) : 0), nbits(n) {
+            clearTail();
+        }
+
+        size_t size() const { return nbits; }
+
+        bool test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+        void set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+        void reset(size_t i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+
+        void setAll() {
+            for (auto &w : words) w = ~uint64_t(0);
+            clearTail();
+        }
+        void clear() {
+            for (auto &w : words) w = 0;
+        }
+
+        bool any() const {
+            for (auto w : words) if (w) return true;
+            return false;
+        }
+
+        size_t count() const {
+            size_t n = 0;
+            for (auto w : words) n += __builtin_popcountll(w);
+            return n;
+        }
+
+        // Index of the first set bit at or after `from`, or -1.
+        long findNext(size_t from) const {
+            if (from >= nbits) return -1;
+            size_t wi = from / 64;
+            uint64_t w = words[wi] & (~uint64_t(0) << (from % 64));
+            while (true) {
+                if (w) return wi * 64 + __builtin_ctzll(w);
+                if (++wi == words.size()) return -1;
+                w = words[wi];
+            }
+        }
+
+        BitVector &operator|=(const BitVector &o) {
+            for (size_t i = 0; i < words.size(); i++) words[i] |= o.words[i];
+            return *this;
+        }
+        BitVector &operator&=(const BitVector &o) {
+            for (size_t i = 0; i < words.size(); i++) words[i] &= o.words[i];
+            return *this;
+        }
+        // Set difference: this = this & ~o
+        BitVector &operator-=(const BitVector &o) {
+            for (size_t i = 0; i < words.size(); i++) words[i] &= ~o.words[i];
+            return *this;
+        }
+        bool operator==(const BitVector &o) const { return words == o.words; }
+        bool operator!=(const BitVector &o) const { return words != o.words; }
+
+        // this = gen | (in & ~kill); returns true if the value changed.
+        bool assignTransfer(const BitVector &gen, const BitVector &in, const BitVector &kill) {
+            bool changed = false;
+            for (size_t i = 0; i < words.size(); i++) {
+                uint64_t w = gen.words[i] | (in.words[i] & ~kill.words[i]);
+                changed |= w != words[i];
+                words[i] = w;
+            }
+            return changed;
+        }
+
+        template <typename F>
+        void forEach(F f) const {
+            for (size_t wi = 0; wi < words.size(); wi++) {
+                uint64_t w = words[wi];
+                while (w) {
+                    f(wi * 64 + __builtin_ctzll(w));
+                    w &= w - 1;
+                }
+            }
+        }
+};
@@ -0,0 +1,225 @@
+#include "CFG.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+int Function::findBlock(const std::string &label) const {
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (blocks[i].label == label) return i;
+    }
+    return -1;
+}
+
+void Function::recomputeEdges() {
+    std::unordered_map<std::string, int> index;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        index[blocks[i].label] = i;
+        blocks[i].succs.clear();
+        blocks[i].preds.clear();
+    }
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        auto &bb = blocks[i];
+        auto addEdge = [&](const std::string &label) {
+            auto it = index.find(label);
+            if (it == index.end()) return;
+            for (int s : bb.succs) if (s == it->second) return;
+            bb.succs.push_back(it->second);
+        };
+        // Only the last two instructions can transfer control
+        size_t n = bb.code.size();
+        for (size_t k = n >= 2 ? n - 2 : 0; k < n; k++) forEachTarget(bb.code[k], addEdge);
+    }
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        for (int s : blocks[i].succs) blocks[s].preds.push_back(i);
+    }
+}
+
+std::vector<int> Function::reversePostOrder() const {
+    std::vector<int> order;
+    if (blocks.empty()) return order;
+
+    std::vector<char> visited(blocks.size(), 0);
+    std::vector<std::pair<int, size_t>> stack; // (block, next successor)
+    stack.push_back({0, 0});
+    visited[0] = 1;
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        const auto &succs = blocks[top.first].succs;
+        if (top.second < succs.size()) {
+            int s = succs[top.second++];
+            if (!visited[s]) {
+                visited[s] = 1;
+                stack.push_back({s, 0});
+            }
+        } else {
+            order.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    return std::vector<int>(order.rbegin(), order.rend());
+}
+
+size_t removeUnreachableBlocks(Function &fn) {
+    std::vector<char> reachable(fn.blocks.size(), 0);
+    for (int b : fn.reversePostOrder()) reachable[b] = 1;
+
+    std::unordered_set<std::string> removed;
+    size_t out = 0;
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        if (!reachable[b]) {
+            removed.insert(fn.blocks[b].label);
+            continue;
+        }
+        if (out != b) fn.blocks[out] = std::move(fn.blocks[b]);
+        out++;
+    }
+    if (removed.empty()) return 0;
+    fn.blocks.erase(fn.blocks.begin() + out, fn.blocks.end());
+
+    for (auto &bb : fn.blocks) {
+        for (auto &tac : bb.code) {
+            if (tac.op != "phi") break;
+            auto &args = tac.phiArgs;
+            args.erase(std::remove_if(args.begin(), args.end(),
+                                      [&](const auto &arg) { return removed.count(arg.first) > 0; }),
+                       args.end());
+        }
+    }
+    fn.recomputeEdges();
+    return removed.size();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// Largest N over names of the form tN / LN, so fresh names never collide.
+static void scanName(const std::string &s, int &maxId) {
+    if (s.size() < 2 || (s[0] != 't' && s[0] != 'L')) return;
+    for (size_t i = 1; i < s.size(); i++) {
+        if (!isdigit((unsigned char)s[i])) return;
+    }
+    maxId = std::max(maxId, std::stoi(s.substr(1)));
+}
+
+static void finishFunction(Module &module, Function &fn) {
+    // Drop the empty block left behind by a trailing terminator
+    if (fn.blocks.size() > 1 && fn.blocks.back().code.empty() && fn.blocks.back().label.empty()) {
+        fn.blocks.pop_back();
+    }
+
+    for (auto &bb : fn.blocks) {
+        if (bb.label.empty()) bb.label = module.newLabel();
+    }
+
+    // Make fall-through explicit
+    for (size_t i = 0; i + 1 < fn.blocks.size(); i++) {
+        auto &code = fn.blocks[i].code;
+        if (code.empty() || !isTerminator(code.back())) {
+            code.push_back(TAC("jmp", "", "", fn.blocks[i + 1].label));
+        }
+    }
+
+    fn.recomputeEdges();
+    module.functions.push_back(std::move(fn));
+}
+
+Module buildModule(const std::vector<TAC> &code) {
+    Module module;
+    int maxId = -1;
+    for (const auto &tac : code) {
+        scanName(tac.arg1, maxId);
+        scanName(tac.arg2, maxId);
+        scanName(tac.result, maxId);
+    }
+    module.nextId = maxId + 1;
+
+    Function fn;
+    bool inFunction = false;
+    for (const auto &tac : code) {
+        if (tac.op == "function") {
+            if (inFunction) finishFunction(module, fn);
+            fn = Function();
+            fn.name = tac.arg1;
+            fn.inlineHint = tac.arg2 == "inline";
+            fn.blocks.emplace_back();
+            inFunction = true;
+            continue;
+        }
+        if (!inFunction) continue;
+
+        if (tac.op == "label") {
+            auto &cur = fn.blocks.back();
+            if (cur.code.empty() && cur.label.empty() && fn.blocks.size() > 1) {
+                cur.label = tac.arg1;
+            } else {
+                fn.blocks.emplace_back();
+                fn.blocks.back().label = tac.arg1;
+            }
+            continue;
+        }
+
+        fn.blocks.back().code.push_back(tac);
+        if (isTerminator(tac) || isCondBranch(tac.op)) {
+            fn.blocks.emplace_back();
+        }
+    }
+    if (inFunction) finishFunction(module, fn);
+    return module;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+std::string invertBranch(const std::string &op) {
+    if (op == "beqz") return "bnez";
+    if (op == "bnez") return "beqz";
+    if (op == "beq") return "bne";
+    if (op == "bne") return "beq";
+    if (op == "blt") return "bge";
+    if (op == "bge") return "blt";
+    if (op == "bgt") return "ble";
+    if (op == "ble") return "bgt";
+    return "";
+}
+
+std::vector<TAC> flattenModule(const Module &module) {
+    std::vector<TAC> out;
+    for (const auto &fn : module.functions) {
+        // Lay the blocks out in order, dropping jumps to the next block
+        std::vector<std::vector<TAC>> bodies;
+        for (size_t i = 0; i < fn.blocks.size(); i++) {
+            std::vector<TAC> body = fn.blocks[i].code;
+            std::string next = i + 1 < fn.blocks.size() ? fn.blocks[i + 1].label : "";
+            size_t n = body.size();
+            if (n && body[n - 1].op == "jmp") {
+                if (body[n - 1].result == next) {
+                    body.pop_back();
+                } else if (n >= 2 && isCondBranch(body[n - 2].op) &&
+                           branchTarget(body[n - 2]) == next) {
+                    // `bxx L_next; jmp L_far` becomes `b!xx L_far`
+                    TAC &br = body[n - 2];
+                    br.op = invertBranch(br.op);
+                    setBranchTarget(br, body[n - 1].result);
+                    body.pop_back();
+                }
+            }
+            bodies.push_back(std::move(body));
+        }
+
+        std::unordered_set<std::string> referenced;
+        for (const auto &body : bodies) {
+            for (const auto &tac : body) {
+                forEachTarget(tac, [&](const std::string &target) { referenced.insert(target); });
+            }
+        }
+
+        out.push_back(TAC("function", fn.name, fn.inlineHint ? "inline" : "", ""));
+        for (size_t i = 0; i < fn.blocks.size(); i++) {
+            if (referenced.count(fn.blocks[i].label)) {
+                out.push_back(TAC("label", fn.blocks[i].label, "", ""));
+            }
+            out.insert(out.end(), bodies[i].begin(), bodies[i].end());
+        }
+    }
+    return out;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "TAC.h"
+#include <string>
+#include <vector>
+
+// Control flow graph over the TAC stream produced by the front end.
+//
+// Every block carries a label and ends in an explicit terminator: `jmp`,
+// `RETURN`, or a conditional branch followed by a `jmp` to the fall-through
+// successor. The only exception is a final block that runs off the end of the
+// function, which has no successors. Edges are derived from the terminators,
+// so passes edit `code` and call recomputeEdges() afterwards.
+//
+// In SSA form (see SSA.h) a block may open with `phi` instructions, which
+// carry one operand per predecessor, keyed by the predecessor's label.
+
+struct BasicBlock {
+    std::string label;
+    std::vector<TAC> code; // Instructions, without the `label` TAC
+    std::vector<int> succs;
+    std::vector<int> preds;
+};
+
+struct Function {
+    std::string name;
+    std::vector<BasicBlock> blocks; // blocks[0] is the entry block
+    bool ssa = false;               // Registers have one definition each; blocks may open with phis
+    bool inlineHint = false;        // Declared `inline`, carried as `function name inline`
+
+    int findBlock(const std::string &label) const;
+    void recomputeEdges();
+    std::vector<int> reversePostOrder() const;
+};
+
+struct Module {
+    std::vector<Function> functions;
+    int nextId = 0; // Next free suffix for fresh tN / LN names
+
+    std::string newTemp() { return "t" + std::to_string(nextId++); }
+    std::string newLabel() { return "L" + std::to_string(nextId++); }
+};
+
+// Deletes the blocks the entry cannot reach, along with the phi operands
+// flowing out of them. Returns the number of blocks removed.
+size_t removeUnreachableBlocks(Function &fn);
+
+Module buildModule(const std::vector<TAC> &code);
+std::vector<TAC> flattenModule(const Module &module);
+
+// The conditional branch taken exactly when `op` is not.
+std::string invertBranch(const std::string &op);
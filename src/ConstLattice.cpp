@@ -0,0 +1,242 @@
+#include "ConstLattice.h"
+#include <string>
+#include <unordered_map>
+
+ConstValue foldConstants(EvalOp op, const ConstValue &a, const ConstValue &b) {
+    bool unary = op == EvalOp::Neg || op == EvalOp::Not || op == EvalOp::Seqz || op == EvalOp::Move;
+    if (a.isConst() && (unary || b.isConst())) return ConstValue::constant(evalOp(op, a.value, b.value));
+
+    // One known operand can decide the result on its own
+    auto zero = [](const ConstValue &v) { return v.isConst() && v.value == 0; };
+    auto nonZero = [](const ConstValue &v) { return v.isConst() && v.value != 0; };
+    if (!unary) {
+        if ((op == EvalOp::Mul || op == EvalOp::MulHigh || op == EvalOp::And || op == EvalOp::LogAnd) && (zero(a) || zero(b))) {
+            return ConstValue::constant(0);
+        }
+        if (op == EvalOp::LogOr && (nonZero(a) || nonZero(b))) return ConstValue::constant(1);
+    }
+
+    // An Undef operand may still turn into the constant that decides it
+    if (a.kind == ConstValue::Undef || (!unary && b.kind == ConstValue::Undef)) return ConstValue();
+    return ConstValue::varying();
+}
+
+size_t removeDeadConstants(Function &fn) {
+    RegisterNumbering regs(fn);
+    std::vector<int> useCount;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) {
+            forEachUse(tac, [&](const std::string &u) {
+                size_t r = regs.id(u);
+                if (r >= useCount.size()) useCount.resize(r + 1, 0);
+                useCount[r]++;
+            });
+        }
+    }
+    size_t removed = 0;
+    for (auto &bb : fn.blocks) {
+        size_t out = 0;
+        for (size_t i = 0; i < bb.code.size(); i++) {
+            const TAC &tac = bb.code[i];
+            if (tac.op == "li") {
+                int r = regs.find(tac.result);
+                if (r < 0 || (size_t)r >= useCount.size() || useCount[r] == 0) {
+                    removed++;
+                    continue;
+                }
+            }
+            if (out != i) bb.code[out] = std::move(bb.code[i]);
+            out++;
+        }
+        bb.code.erase(bb.code.begin() + out, bb.code.end());
+    }
+    return removed;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int ConstCode::edgeIndex(int p, int s) const {
+    for (const auto &[succ, k] : outEdges[p]) {
+        if (succ == s) return k;
+    }
+    return -1;
+}
+
+ConstCode::ConstCode(const Function &fn) : regs(fn), dom(computeDominators(fn)) {
+    size_t n = fn.blocks.size();
+    outEdges.resize(n);
+    for (size_t s = 0; s < n; s++) {
+        const auto &preds = fn.blocks[s].preds;
+        for (size_t k = 0; k < preds.size(); k++) outEdges[preds[k]].push_back({s, k});
+    }
+
+    std::unordered_map<std::string, int> vars, blockIndex;
+    for (size_t b = 0; b < n; b++) blockIndex[fn.blocks[b].label] = b;
+    auto varId = [&](const std::string &name) { return vars.emplace(name, vars.size()).first->second; };
+    auto operand = [&](const std::string &s) { return s == "0" ? ConstInstr::ZERO : regs.id(s); };
+    auto block = [&](const std::string &label) {
+        auto it = blockIndex.find(label);
+        return it == blockIndex.end() ? -1 : it->second;
+    };
+
+    code.resize(n);
+    std::unordered_map<int, int> predIndex; // Of the block being decoded, for its phis
+    for (size_t bi = 0; bi < n; bi++) {
+        predIndex.clear();
+        for (const auto &tac : fn.blocks[bi].code) {
+            ConstInstr d;
+            if (tac.op == "li") {
+                d.kind = ConstInstr::Li;
+                d.imm = std::stoll(tac.arg1);
+            } else if (tac.op == "load") {
+                d.kind = ConstInstr::Load;
+                d.var = varId(tac.arg1);
+            } else if (tac.op == "store") {
+                d.kind = ConstInstr::Store;
+                d.var = varId(tac.result);
+                d.a = operand(tac.arg1);
+            } else if (tac.op == "param") {
+                d.kind = ConstInstr::Param;
+                d.var = varId(tac.arg1);
+            } else if (tac.op == "call") {
+                d.kind = ConstInstr::Call;
+            } else if (tac.op == "phi") {
+                d.kind = ConstInstr::Phi;
+                const auto &preds = fn.blocks[bi].preds;
+                if (predIndex.empty()) {
+                    for (size_t k = preds.size(); k-- > 0;) predIndex[preds[k]] = k;
+                }
+                for (const auto &[label, value] : tac.phiArgs) {
+                    auto it = predIndex.find(block(label));
+                    if (it != predIndex.end()) d.incoming.push_back({it->second, operand(value)});
+                }
+            } else if (isCondBranch(tac.op)) {
+                d.kind = ConstInstr::Branch;
+                d.eval = evalOpFor(tac.op);
+                d.a = operand(tac.arg1);
+                if (tac.op != "beqz" && tac.op != "bnez") d.b = operand(tac.arg2);
+                d.target = block(branchTarget(tac));
+            } else if (tac.op == "jmp") {
+                d.kind = ConstInstr::Jmp;
+                d.target = block(tac.result);
+            } else if (tac.op == "jtab") {
+                d.kind = ConstInstr::Table;
+                d.a = operand(tac.arg1);
+                for (const auto &target : tac.targets) d.targets.push_back(block(target));
+            } else if (isBinaryOpcode(tac.op) || isUnaryOpcode(tac.op)) {
+                d.kind = ConstInstr::Compute;
+                d.eval = evalOpFor(tac.op);
+                d.a = operand(tac.arg1);
+                if (isBinaryOpcode(tac.op)) d.b = operand(tac.arg2);
+            }
+            if (!tacDef(tac).empty()) {
+                d.def = regs.id(tac.result);
+                if ((size_t)d.def >= defCount.size()) {
+                    defCount.resize(d.def + 1, 0);
+                    defSite.resize(d.def + 1);
+                }
+                defCount[d.def]++;
+                defSite[d.def] = {bi, code[bi].size()};
+            }
+            code[bi].push_back(std::move(d));
+        }
+    }
+    defCount.resize(regs.size(), 0);
+    defSite.resize(regs.size());
+
+    // Variables only carry values between blocks through the loads that read
+    // them before any store in their block
+    size_t nvars = vars.size();
+    std::vector<std::vector<int>> exposedIn(nvars), defBlocks(nvars);
+    std::vector<int> definedIn(nvars, -1), exposedMark(nvars, -1);
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &d : code[b]) {
+            if (d.kind == ConstInstr::Load && definedIn[d.var] != (int)b && exposedMark[d.var] != (int)b) {
+                exposedMark[d.var] = b;
+                exposedIn[d.var].push_back(b);
+            } else if ((d.kind == ConstInstr::Store || d.kind == ConstInstr::Param) && definedIn[d.var] != (int)b) {
+                definedIn[d.var] = b;
+                defBlocks[d.var].push_back(b);
+            }
+        }
+    }
+
+    auto df = dominanceFrontiers(fn, dom);
+    phisAt.resize(n);
+    std::vector<int> liveMark(n, -1), defMark(n, -1), phiMark(n, -1), queued(n, -1);
+    std::vector<int> work;
+    for (size_t v = 0; v < nvars; v++) {
+        if (exposedIn[v].empty() || defBlocks[v].empty()) continue;
+        for (int b : defBlocks[v]) defMark[b] = v;
+
+        work = exposedIn[v];
+        for (int b : work) liveMark[b] = v;
+        while (!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            for (int p : fn.blocks[b].preds) {
+                if (liveMark[p] == (int)v || defMark[p] == (int)v) continue;
+                liveMark[p] = v;
+                work.push_back(p);
+            }
+        }
+
+        work = defBlocks[v];
+        work.push_back(0);
+        for (int b : work) queued[b] = v;
+        while (!work.empty()) {
+            int x = work.back();
+            work.pop_back();
+            for (int y : df[x]) {
+                if (phiMark[y] == (int)v || liveMark[y] != (int)v) continue;
+                phiMark[y] = v;
+                phisAt[y].push_back(phis.size());
+                phis.push_back({(int)v, y, {}});
+                if (queued[y] != (int)v) {
+                    queued[y] = v;
+                    work.push_back(y);
+                }
+            }
+        }
+    }
+
+    // Each definition pushes its value, read by the loads it dominates and
+    // the phi operands on its outgoing edges, and is popped on the way back up
+    std::vector<std::vector<int>> current(nvars, std::vector<int>{ConstInstr::VARYING});
+    std::vector<int> pushed;
+    struct Frame {
+        int block;
+        size_t child;
+        size_t mark; // Size of `pushed` on entry
+    };
+    std::vector<Frame> stack;
+    auto enter = [&](int b) {
+        stack.push_back({b, 0, pushed.size()});
+        auto define = [&](int v, int src) {
+            current[v].push_back(src);
+            pushed.push_back(v);
+        };
+        for (int k : phisAt[b]) define(phis[k].var, ConstInstr::VAR_PHI - k);
+        for (auto &d : code[b]) {
+            if (d.kind == ConstInstr::Load) d.src = current[d.var].back();
+            else if (d.kind == ConstInstr::Store) define(d.var, d.a);
+            else if (d.kind == ConstInstr::Param) define(d.var, ConstInstr::VARYING);
+        }
+        for (const auto &[s, k] : outEdges[b]) {
+            for (int p : phisAt[s]) phis[p].incoming.push_back({k, current[phis[p].var].back()});
+        }
+    };
+    if (n) enter(0);
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        if (top.child < dom.children[top.block].size()) {
+            enter(dom.children[top.block][top.child++]);
+            continue;
+        }
+        while (pushed.size() > top.mark) {
+            current[pushed.back()].pop_back();
+            pushed.pop_back();
+        }
+        stack.pop_back();
+    }
+}
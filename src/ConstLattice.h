@@ -0,0 +1,94 @@
+#pragma once
+
+#include "CFG.h"
+#include "Dominators.h"
+#include "Eval.h"
+#include "Registers.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// What the constant propagation passes (ConstProp.h, SCCP.h) share: the
+// lattice, folding over it, and a decoded form of the function in which
+// every load already points at the stores that can reach it.
+
+// Undef (no value seen yet) above every constant, Varying below them all.
+struct ConstValue {
+    enum Kind : uint8_t { Undef, Const, Varying };
+    Kind kind = Undef;
+    int64_t value = 0;
+
+    static ConstValue constant(int64_t v) { return {Const, v}; }
+    static ConstValue varying() { return {Varying, 0}; }
+
+    bool isConst() const { return kind == Const; }
+    bool operator==(const ConstValue &o) const { return kind == o.kind && (kind != Const || value == o.value); }
+    bool operator!=(const ConstValue &o) const { return !(*this == o); }
+
+    // Lowers this value to the meet of both; returns true if it changed.
+    bool meet(const ConstValue &o) {
+        if (o.kind == Undef || kind == Varying || *this == o) return false;
+        if (kind == Undef) *this = o;
+        else *this = varying();
+        return true;
+    }
+};
+
+// Value of an operator applied to lattice values (b is ignored for unary
+// operators). A constant operand may decide the result on its own, as in
+// `x * 0` or `0 && x`; otherwise an Undef operand makes it Undef and a
+// Varying one Varying. The result only moves down as its operands do.
+ConstValue foldConstants(EvalOp op, const ConstValue &a, const ConstValue &b);
+
+// Deletes the `li`s whose result nothing reads. Returns how many went.
+size_t removeDeadConstants(Function &fn);
+
+// An instruction with its operands resolved to register, variable and block
+// ids, so propagation never touches strings.
+struct ConstInstr {
+    enum Kind { Li, Load, Store, Param, Compute, Call, Phi, Branch, Jmp, Table, Other };
+    // Operands that are not registers: the literal 0, a value nothing is
+    // known about, and variable phi k as VAR_PHI - k
+    static const int ZERO = -2, VARYING = -3, VAR_PHI = -4;
+
+    Kind kind = Other;
+    EvalOp eval = EvalOp::Invalid;
+    int def = -1;       // Register written
+    int a = -1, b = -1; // Operands
+    int var = -1;
+    int src = VARYING;  // Load: the value of the store reaching it, or a variable phi
+    int64_t imm = 0;
+    int target = -1;                           // Branch or jmp destination block
+    std::vector<std::pair<int, int>> incoming; // Phi: (index in the block's preds, operand)
+    std::vector<int> targets;                  // Jump table destination blocks
+};
+
+// Where a variable's stores from different blocks meet, as a register phi
+// would after promotion.
+struct VariablePhi {
+    int var = -1;
+    int block = -1;
+    std::vector<std::pair<int, int>> incoming; // (index in the block's preds, operand)
+};
+
+// A function decoded for constant propagation. Variables are linked as
+// constructSSA() links registers: phis go on the iterated dominance frontier
+// of the blocks storing the variable (and the entry, where every variable
+// is Varying), pruned to the blocks it is live into, and each load's `src`
+// is the store operand, VARYING or phi reaching it along the dominator tree.
+// Loads in unreachable blocks keep VARYING.
+struct ConstCode {
+    RegisterNumbering regs;
+    DominatorTree dom;
+    std::vector<std::vector<ConstInstr>> code;             // Parallel to each block's TAC
+    std::vector<int> defCount;                             // Per register
+    std::vector<std::pair<int, int>> defSite;              // (block, instr) of each register's last definition
+    std::vector<VariablePhi> phis;
+    std::vector<std::vector<int>> phisAt;                  // Variable phis of each block
+    std::vector<std::vector<std::pair<int, int>>> outEdges; // (successor, index in its preds) of each block
+
+    explicit ConstCode(const Function &fn);
+
+    // Index of the edge p -> s in s's preds, or -1.
+    int edgeIndex(int p, int s) const;
+};
@@ -0,0 +1,87 @@
+#include "ConstProp.h"
+#include "ConstLattice.h"
+
+void propagateConstants(Module &module, Function &fn, Statistics &stats) {
+    (void)module;
+    size_t n = fn.blocks.size();
+    ConstCode cc(fn);
+    const auto &code = cc.code;
+
+    // Optimistic propagation along the register def-use edges and the links
+    // from loads to stores: every register defined once and every variable
+    // phi starts Undef, and is revisited only when something it reads moves
+    // down the lattice
+    size_t nregs = cc.regs.size();
+    std::vector<ConstValue> regVal(nregs), phiVal(cc.phis.size());
+    auto value = [&](int src) {
+        if (src >= 0) return regVal[src];
+        if (src == ConstInstr::ZERO) return ConstValue::constant(0);
+        if (src == ConstInstr::VARYING) return ConstValue::varying();
+        return phiVal[ConstInstr::VAR_PHI - src];
+    };
+    // Nodes are registers, then variable phis
+    std::vector<std::vector<int>> users(nregs + cc.phis.size());
+    auto addUse = [&](int src, int user) {
+        if (src >= 0) users[src].push_back(user);
+        else if (src <= ConstInstr::VAR_PHI) users[nregs + ConstInstr::VAR_PHI - src].push_back(user);
+    };
+    for (size_t r = 0; r < nregs; r++) {
+        if (cc.defCount[r] != 1) continue;
+        const auto &d = code[cc.defSite[r].first][cc.defSite[r].second];
+        if (d.kind == ConstInstr::Load) {
+            addUse(d.src, r);
+        } else if (d.kind == ConstInstr::Compute) {
+            addUse(d.a, r);
+            if (d.b != -1) addUse(d.b, r);
+        }
+    }
+    for (size_t k = 0; k < cc.phis.size(); k++) {
+        for (const auto &[pred, src] : cc.phis[k].incoming) addUse(src, nregs + k);
+    }
+
+    auto evaluate = [&](size_t x) {
+        if (x >= nregs) {
+            ConstValue result;
+            for (const auto &[pred, src] : cc.phis[x - nregs].incoming) result.meet(value(src));
+            return result;
+        }
+        if (cc.defCount[x] != 1) return ConstValue::varying();
+        const auto &d = code[cc.defSite[x].first][cc.defSite[x].second];
+        switch (d.kind) {
+            case ConstInstr::Li: return ConstValue::constant(d.imm);
+            case ConstInstr::Load: return value(d.src);
+            case ConstInstr::Compute: return foldConstants(d.eval, value(d.a), d.b == -1 ? ConstValue() : value(d.b));
+            default: return ConstValue::varying();
+        }
+    };
+    std::vector<int> work;
+    for (size_t x = users.size(); x-- > 0;) work.push_back(x);
+    while (!work.empty()) {
+        size_t x = work.back();
+        work.pop_back();
+        ConstValue &val = x < nregs ? regVal[x] : phiVal[x - nregs];
+        if (!val.meet(evaluate(x))) continue;
+        for (int u : users[x]) work.push_back(u);
+    }
+
+    // Rewrite constant computations and loads as `li`
+    long folded = 0, forwarded = 0;
+    for (size_t b = 0; b < n; b++) {
+        if (!cc.dom.isReachable(b)) continue;
+        for (size_t i = 0; i < code[b].size(); i++) {
+            const auto &d = code[b][i];
+            if (d.def < 0 || !regVal[d.def].isConst()) continue;
+            if (d.kind != ConstInstr::Compute && d.kind != ConstInstr::Load) continue;
+            TAC &tac = fn.blocks[b].code[i];
+            tac = TAC("li", std::to_string(regVal[d.def].value), "", tac.result);
+            if (d.kind == ConstInstr::Load) forwarded++;
+            else folded++;
+        }
+    }
+
+    long removed = removeDeadConstants(fn);
+
+    stats.add("constprop", fn.name, "operations folded", folded);
+    stats.add("constprop", fn.name, "loads forwarded", forwarded);
+    stats.add("constprop", fn.name, "constants removed", removed);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Forward constant propagation and folding. Stack variables are tracked
+// through their stores and loads (no variable ever has its address taken):
+// each load is linked to the store reaching it, or to a phi where several
+// meet (see ConstLattice.h). Registers with a single definition carry the
+// value computed there. Values propagate sparsely along those links, so the
+// work is proportional to them rather than to blocks times variables. Every
+// computation or load proven constant becomes an `li`, and `li`s left
+// without uses are deleted. Branches are left alone: see the SCCP pass.
+void propagateConstants(Module &module, Function &fn, Statistics &stats);
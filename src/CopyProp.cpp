@@ -0,0 +1,280 @@
+#include "CopyProp.h"
+#include "Registers.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+static bool isRegisterMove(const TAC &tac) {
+    return tac.op == "move" && !isImmediate(tac.arg1) && tac.arg1 != tac.result;
+}
+
+// Deletes the moves marked in `remove`, indexed in layout order.
+static void eraseMarked(Function &fn, const std::vector<char> &remove) {
+    size_t pos = 0;
+    for (auto &bb : fn.blocks) {
+        size_t out = 0;
+        for (size_t i = 0; i < bb.code.size(); i++, pos++) {
+            if (remove[pos]) continue;
+            if (out != i) bb.code[out] = std::move(bb.code[i]);
+            out++;
+        }
+        bb.code.erase(bb.code.begin() + out, bb.code.end());
+    }
+}
+
+void propagateCopies(Module &module, Function &fn, Statistics &stats) {
+    (void)module;
+    RegisterNumbering regs(fn);
+    std::vector<int> defCount;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) {
+            if (tacDef(tac).empty()) continue;
+            size_t r = regs.id(tac.result);
+            if (r >= defCount.size()) defCount.resize(r + 1, 0);
+            defCount[r]++;
+        }
+    }
+    defCount.resize(regs.size(), 0);
+
+    // source[b] = a for each propagatable `b = move a`
+    std::vector<int> source(regs.size(), -1);
+    std::vector<char> remove;
+    long eliminated = 0;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) {
+            bool copy = false;
+            if (isRegisterMove(tac)) {
+                int a = regs.find(tac.arg1), b = regs.find(tac.result);
+                if (a >= 0 && defCount[a] == 1 && defCount[b] == 1) {
+                    source[b] = a;
+                    copy = true;
+                    eliminated++;
+                }
+            }
+            remove.push_back(copy);
+        }
+    }
+    if (!eliminated) return;
+
+    // Chains of copies resolve to the register at their head
+    auto resolve = [&](int r) {
+        int root = r;
+        while (source[root] >= 0) root = source[root];
+        while (source[r] >= 0) {
+            int next = source[r];
+            source[r] = root;
+            r = next;
+        }
+        return root;
+    };
+    for (auto &bb : fn.blocks) {
+        for (auto &tac : bb.code) {
+            forEachUse(tac, [&](std::string &u) {
+                int r = regs.find(u);
+                if (r >= 0 && source[r] >= 0) u = regs.name(resolve(r));
+            });
+        }
+    }
+    eraseMarked(fn, remove);
+
+    stats.add("copyprop", fn.name, "moves eliminated", eliminated);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// Coalesces the function's register moves; returns the number removed.
+//
+// Liveness is only needed for the registers of moves, so it is computed
+// sparsely for those: the blocks each one is live into are found by
+// walking backwards from the blocks reading it before any write, stopping
+// at the blocks that write it. Merged registers form classes in a
+// union-find structure, each class keeping the blocks it is live into and
+// its definitions by block; since merged registers never overlap, a class
+// is live wherever one of its members is.
+static long coalesceMoves(Function &fn) {
+    RegisterNumbering regs(fn);
+    struct Candidate {
+        int src, dst;
+        size_t pos;
+    };
+    std::vector<Candidate> candidates;
+    size_t pos = 0;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) {
+            if (isRegisterMove(tac)) candidates.push_back({regs.id(tac.arg1), regs.id(tac.result), pos});
+            pos++;
+        }
+    }
+    if (candidates.empty()) return 0;
+
+    // Definitions of each move register and the blocks it is live into
+    std::vector<int> slot(regs.size(), -1), slotReg;
+    for (const auto &c : candidates) {
+        for (int r : {c.src, c.dst}) {
+            if (slot[r] >= 0) continue;
+            slot[r] = slotReg.size();
+            slotReg.push_back(r);
+        }
+    }
+    size_t slots = slotReg.size();
+    auto slotOf = [&](const std::string &name) {
+        int r = regs.find(name);
+        return r >= 0 && (size_t)r < slot.size() ? slot[r] : -1;
+    };
+    std::vector<std::unordered_map<int, std::vector<int>>> defsAt(slots); // Block -> instructions
+    std::vector<std::vector<int>> liveIn(slots);
+    std::vector<int> definedIn(slots, -1), exposedIn(slots, -1);
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        const auto &code = fn.blocks[b].code;
+        for (size_t i = 0; i < code.size(); i++) {
+            forEachUse(code[i], [&](const std::string &u) {
+                int k = slotOf(u);
+                if (k < 0 || definedIn[k] == (int)b || exposedIn[k] == (int)b) return;
+                exposedIn[k] = b;
+                liveIn[k].push_back(b);
+            });
+            int k = tacDef(code[i]).empty() ? -1 : slotOf(code[i].result);
+            if (k < 0) continue;
+            definedIn[k] = b;
+            defsAt[k][b].push_back(i);
+        }
+    }
+    std::vector<std::unordered_set<int>> live(slots);
+    std::vector<int> defMark(fn.blocks.size(), -1), liveMark(fn.blocks.size(), -1), work;
+    for (size_t k = 0; k < slots; k++) {
+        for (const auto &d : defsAt[k]) defMark[d.first] = k;
+        for (int b : liveIn[k]) liveMark[b] = k;
+        work = liveIn[k];
+        while (!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            for (int p : fn.blocks[b].preds) {
+                if (liveMark[p] == (int)k || defMark[p] == (int)k) continue;
+                liveMark[p] = k;
+                liveIn[k].push_back(p);
+                work.push_back(p);
+            }
+        }
+        live[k].insert(liveIn[k].begin(), liveIn[k].end());
+        liveIn[k].clear();
+        liveIn[k].shrink_to_fit();
+    }
+
+    std::vector<int> parent(slots);
+    for (size_t k = 0; k < slots; k++) parent[k] = k;
+    auto find = [&](int k) {
+        int root = k;
+        while (parent[root] != root) root = parent[root];
+        while (parent[k] != root) {
+            int next = parent[k];
+            parent[k] = root;
+            k = next;
+        }
+        return root;
+    };
+    auto classOf = [&](const std::string &name) {
+        int k = slotOf(name);
+        return k < 0 ? -1 : find(k);
+    };
+    // A move within a class becomes a no-op once its registers are merged
+    auto internal = [&](const TAC &tac, int c) { return isRegisterMove(tac) && classOf(tac.arg1) == c; };
+
+    // Whether class c holds a needed value right after instruction i
+    auto liveAfter = [&](int c, int b, int i) {
+        const auto &code = fn.blocks[b].code;
+        for (size_t j = i + 1; j < code.size(); j++) {
+            bool defines = !tacDef(code[j]).empty() && classOf(code[j].result) == c;
+            if (defines && internal(code[j], c)) continue;
+            bool used = false;
+            forEachUse(code[j], [&](const std::string &u) { used |= classOf(u) == c; });
+            if (used) return true;
+            if (defines) return false;
+        }
+        for (int s : fn.blocks[b].succs) {
+            if (live[c].count(s)) return true;
+        }
+        return false;
+    };
+    // A definition in block b of one class interferes with the other if the
+    // other is live after it, unless the definition copies the other
+    auto defsInterfere = [&](int c, int other, int b) {
+        auto it = defsAt[c].find(b);
+        if (it == defsAt[c].end()) return false;
+        for (int i : it->second) {
+            const TAC &tac = fn.blocks[b].code[i];
+            if (isRegisterMove(tac) && (classOf(tac.arg1) == other || classOf(tac.arg1) == c)) continue;
+            if (liveAfter(other, b, i)) return true;
+        }
+        return false;
+    };
+    // Two classes can only meet in the blocks where the smaller one is live
+    // or defined
+    auto interferes = [&](int a, int b) {
+        int small = live[a].size() + defsAt[a].size() <= live[b].size() + defsAt[b].size() ? a : b;
+        auto check = [&](int block) { return defsInterfere(a, b, block) || defsInterfere(b, a, block); };
+        for (int block : live[small]) {
+            if (check(block)) return true;
+        }
+        for (const auto &d : defsAt[small]) {
+            if (check(d.first)) return true;
+        }
+        return false;
+    };
+    // The smaller class joins the larger
+    auto merge = [&](int a, int b) {
+        if (live[a].size() + defsAt[a].size() < live[b].size() + defsAt[b].size()) std::swap(a, b);
+        parent[b] = a;
+        live[a].insert(live[b].begin(), live[b].end());
+        for (auto &[block, instrs] : defsAt[b]) {
+            auto &into = defsAt[a][block];
+            into.insert(into.end(), instrs.begin(), instrs.end());
+        }
+        std::unordered_set<int>().swap(live[b]);
+        std::unordered_map<int, std::vector<int>>().swap(defsAt[b]);
+    };
+
+    // Merge the classes of each move whose registers never overlap
+    std::vector<char> remove(pos, 0);
+    long merged = 0;
+    for (const auto &c : candidates) {
+        int a = find(slot[c.src]), b = find(slot[c.dst]);
+        if (a != b) {
+            if (interferes(a, b)) continue;
+            merge(a, b);
+        }
+        remove[c.pos] = 1;
+        merged++;
+    }
+    if (!merged) return 0;
+
+    auto rename = [&](std::string &s) {
+        int k = slotOf(s);
+        if (k >= 0) s = regs.name(slotReg[find(k)]);
+    };
+    for (auto &bb : fn.blocks) {
+        for (auto &tac : bb.code) {
+            forEachUse(tac, rename);
+            if (!tacDef(tac).empty()) rename(tac.result);
+        }
+    }
+    eraseMarked(fn, remove);
+    return merged;
+}
+
+void coalesceCopies(Module &module, Function &fn, Statistics &stats) {
+    (void)module;
+    long eliminated = coalesceMoves(fn);
+
+    // Moves whose registers already coincide
+    std::vector<char> remove;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) {
+            bool self = tac.op == "move" && tac.arg1 == tac.result;
+            remove.push_back(self);
+            eliminated += self;
+        }
+    }
+    eraseMarked(fn, remove);
+
+    stats.add("coalesce", fn.name, "moves eliminated", eliminated);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Removal of the `move`s the front end emits for assignments, `?:` and
+// `&&`/`||`, and that leaving SSA form adds for phis.
+//
+// propagateCopies() handles `b = move a` where both registers are defined
+// once, as every register is in SSA form: uses of b read a instead and the
+// move goes.
+//
+// coalesceCopies() runs once the function is out of SSA form, on the moves
+// that are left. When the live ranges of a move's registers do not overlap
+// they are merged into one register, which the backend then maps to a single
+// machine register, so the move disappears from the assembly. Merged
+// registers form a class whose live range is the union of its members',
+// and later moves are checked against the whole class, so one pass removes
+// every move that can go: merging only ever grows what a class overlaps.
+
+void propagateCopies(Module &module, Function &fn, Statistics &stats);
+void coalesceCopies(Module &module, Function &fn, Statistics &stats);
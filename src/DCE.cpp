@@ -0,0 +1,66 @@
+#include "DCE.h"
+#include "Registers.h"
+
+void eliminateDeadCode(Module &module, Function &fn, Statistics &stats) {
+    (void)module;
+    long blocks = removeUnreachableBlocks(fn);
+
+    // Instructions are numbered in layout order; defs lists the positions
+    // defining each register (only one in SSA form)
+    RegisterNumbering regs(fn);
+    std::vector<size_t> start;
+    std::vector<std::vector<size_t>> defs;
+    std::vector<char> live;
+    std::vector<size_t> work;
+    size_t pos = 0;
+    for (const auto &bb : fn.blocks) {
+        start.push_back(pos);
+        for (const auto &tac : bb.code) {
+            if (!tacDef(tac).empty()) {
+                size_t r = regs.id(tac.result);
+                if (r >= defs.size()) defs.resize(r + 1);
+                defs[r].push_back(pos);
+            }
+            live.push_back(!isPure(tac));
+            if (live.back()) work.push_back(pos);
+            pos++;
+        }
+    }
+
+    // Positions back to instructions, for the uses of marked ones
+    std::vector<const TAC *> at(pos);
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        for (size_t i = 0; i < fn.blocks[b].code.size(); i++) at[start[b] + i] = &fn.blocks[b].code[i];
+    }
+    while (!work.empty()) {
+        size_t p = work.back();
+        work.pop_back();
+        forEachUse(*at[p], [&](const std::string &u) {
+            int r = regs.find(u);
+            if (r < 0 || (size_t)r >= defs.size()) return;
+            for (size_t d : defs[r]) {
+                if (live[d]) continue;
+                live[d] = 1;
+                work.push_back(d);
+            }
+        });
+    }
+
+    long removed = 0;
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        auto &code = fn.blocks[b].code;
+        size_t out = 0;
+        for (size_t i = 0; i < code.size(); i++) {
+            if (!live[start[b] + i]) {
+                removed++;
+                continue;
+            }
+            if (out != i) code[out] = std::move(code[i]);
+            out++;
+        }
+        code.erase(code.begin() + out, code.end());
+    }
+
+    stats.add("dce", fn.name, "instructions removed", removed);
+    stats.add("dce", fn.name, "blocks removed", blocks);
+}
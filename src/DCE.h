@@ -0,0 +1,15 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Mark-and-sweep dead code elimination.
+//
+// Blocks the entry cannot reach go first: the `?:` arm the front end leaves
+// without a jump into it, and code lowered after a `return`, `break` or
+// `continue`. Then every instruction with an effect (stores, calls and their
+// arguments, returns and branches) is marked live, and so, transitively, is
+// each definition of a register a live instruction reads. Everything left
+// unmarked, such as the value of an expression statement or a phi nobody
+// reads, is deleted. Works in and out of SSA form.
+void eliminateDeadCode(Module &module, Function &fn, Statistics &stats);
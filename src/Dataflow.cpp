@@ -0,0 +1,322 @@
+#include "Dataflow.h"
+#include <algorithm>
+
+DataflowResult solveDataflow(const Function &fn, const DataflowProblem &problem) {
+    size_t n = fn.blocks.size();
+    bool forward = problem.direction == Direction::Forward;
+    bool intersect = problem.meet == Meet::Intersection;
+
+    DataflowResult res;
+    res.in.assign(n, BitVector(problem.universe, intersect));
+    res.out.assign(n, BitVector(problem.universe, intersect));
+
+    // Visit order: RPO for forward problems, post-order for backward ones.
+    // Unreachable blocks go last so they still get a (conservative) value.
+    std::vector<int> order = fn.reversePostOrder();
+    std::vector<char> seen(n, 0);
+    for (int b : order) seen[b] = 1;
+    for (size_t b = 0; b < n; b++) if (!seen[b]) order.push_back(b);
+    if (!forward) std::reverse(order.begin(), order.end());
+
+    std::vector<size_t> position(n);
+    for (size_t i = 0; i < n; i++) position[order[i]] = i;
+
+    BitVector pending(n, true);
+    size_t cursor = 0;
+    while (true) {
+        long pos = pending.findNext(cursor);
+        if (pos < 0) pos = pending.findNext(0);
+        if (pos < 0) break;
+        pending.reset(pos);
+        cursor = pos + 1;
+
+        int b = order[pos];
+        const auto &bb = fn.blocks[b];
+        const auto &sources = forward ? bb.preds : bb.succs;
+        BitVector &meetIn = forward ? res.in[b] : res.out[b];
+        BitVector &result = forward ? res.out[b] : res.in[b];
+
+        bool isBoundary = forward ? b == 0 : bb.succs.empty();
+        if (isBoundary) {
+            meetIn = problem.boundary;
+        } else if (intersect) {
+            meetIn.setAll();
+        } else {
+            meetIn.clear();
+        }
+        for (int s : sources) {
+            if (intersect) meetIn &= forward ? res.out[s] : res.in[s];
+            else meetIn |= forward ? res.out[s] : res.in[s];
+        }
+
+        res.visits++;
+        if (result.assignTransfer(problem.gen[b], meetIn, problem.kill[b])) {
+            for (int d : forward ? bb.succs : bb.preds) pending.set(position[d]);
+        }
+    }
+    return res;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool Liveness::isLiveIn(int block, const std::string &name) const {
+    auto it = index.find(name);
+    return it != index.end() && sets.in[block].test(it->second);
+}
+
+bool Liveness::isLiveOut(int block, const std::string &name) const {
+    auto it = index.find(name);
+    return it != index.end() && sets.out[block].test(it->second);
+}
+
+// Registers of a function interned to ids, with each block's operands
+// recorded as (id, isDef) events in program order.
+struct RegisterEvents {
+    std::unordered_map<std::string, unsigned> intern;
+    std::vector<std::string> names;
+    std::vector<std::vector<std::pair<unsigned, bool>>> events;
+    std::vector<char> crossesBlocks;
+};
+
+// Registers that are only touched inside one block, and defined there before
+// any use, can never be live across (or usefully reach) a block boundary.
+// Leaving them out of the universe keeps the bit-vectors small: most
+// front-end temps are of this kind.
+static RegisterEvents scanRegisters(const Function &fn) {
+    RegisterEvents r;
+    size_t n = fn.blocks.size();
+    r.events.resize(n);
+    std::vector<std::string> uses;
+    auto add = [&](size_t b, const std::string &name, bool isDef) {
+        auto it = r.intern.try_emplace(name, r.names.size()).first;
+        if (it->second == r.names.size()) r.names.push_back(name);
+        r.events[b].push_back({it->second, isDef});
+    };
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &tac : fn.blocks[b].code) {
+            uses.clear();
+            tacUses(tac, uses);
+            for (const auto &u : uses) add(b, u, false);
+            std::string d = tacDef(tac);
+            if (!d.empty()) add(b, d, true);
+        }
+    }
+
+    std::vector<int> home(r.names.size(), -2); // -1 once seen in two blocks
+    std::vector<int> definedIn(r.names.size(), -1);
+    r.crossesBlocks.assign(r.names.size(), 0);
+    for (size_t b = 0; b < n; b++) {
+        for (auto [id, isDef] : r.events[b]) {
+            if (home[id] == -2) home[id] = b;
+            else if (home[id] != (int)b) r.crossesBlocks[id] = 1;
+            if (isDef) definedIn[id] = b;
+            else if (definedIn[id] != (int)b) r.crossesBlocks[id] = 1;
+        }
+    }
+    return r;
+}
+
+Liveness computeLiveness(const Function &fn) {
+    Liveness live;
+    size_t n = fn.blocks.size();
+    RegisterEvents regs = scanRegisters(fn);
+
+    std::vector<int> dense(regs.names.size(), -1);
+    for (size_t id = 0; id < regs.names.size(); id++) {
+        if (!regs.crossesBlocks[id]) continue;
+        dense[id] = live.names.size();
+        live.index[regs.names[id]] = live.names.size();
+        live.names.push_back(regs.names[id]);
+    }
+
+    DataflowProblem p;
+    p.direction = Direction::Backward;
+    p.meet = Meet::Union;
+    p.universe = live.names.size();
+    p.gen.assign(n, BitVector(p.universe));
+    p.kill.assign(n, BitVector(p.universe));
+    p.boundary = BitVector(p.universe);
+
+    // gen = upward-exposed uses, kill = definitions. Within an instruction
+    // the def follows its uses, so walking events backwards is exact.
+    for (size_t b = 0; b < n; b++) {
+        for (auto it = regs.events[b].rbegin(); it != regs.events[b].rend(); ++it) {
+            int id = dense[it->first];
+            if (id < 0) continue;
+            if (it->second) {
+                p.kill[b].set(id);
+                p.gen[b].reset(id);
+            } else {
+                p.gen[b].set(id);
+            }
+        }
+    }
+
+    live.sets = solveDataflow(fn, p);
+    return live;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+ReachingDefs computeReachingDefs(const Function &fn) {
+    ReachingDefs rd;
+    RegisterEvents regs = scanRegisters(fn);
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        const auto &code = fn.blocks[b].code;
+        for (size_t i = 0; i < code.size(); i++) {
+            std::string d = tacDef(code[i]);
+            if (d.empty() || !regs.crossesBlocks[regs.intern[d]]) continue;
+            rd.defsOf[d].push_back(rd.defs.size());
+            rd.defs.push_back({(int)b, (int)i});
+            rd.defName.push_back(d);
+        }
+    }
+
+    size_t n = fn.blocks.size();
+    DataflowProblem p;
+    p.direction = Direction::Forward;
+    p.meet = Meet::Union;
+    p.universe = rd.defs.size();
+    p.gen.assign(n, BitVector(p.universe));
+    p.kill.assign(n, BitVector(p.universe));
+    p.boundary = BitVector(p.universe);
+
+    // A definition kills every other definition of the same register; the
+    // last one in the block is the one that survives to the exit.
+    for (unsigned id = 0; id < rd.defs.size(); id++) {
+        int b = rd.defs[id].first;
+        for (unsigned other : rd.defsOf[rd.defName[id]]) {
+            p.kill[b].set(other);
+            p.gen[b].reset(other);
+        }
+        p.gen[b].set(id);
+    }
+
+    rd.sets = solveDataflow(fn, p);
+    return rd;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static bool isCommutative(const std::string &op) {
+    return op == "+" || op == "*" || op == "mulh" || op == "&" || op == "|" || op == "^" ||
+           op == "==" || op == "!=" || op == "&&" || op == "||";
+}
+
+std::string exprKey(const TAC &tac) {
+    if (tac.op == "load") return "load " + tac.arg1;
+    if (tac.op == "move" || !(isBinaryOpcode(tac.op) || isUnaryOpcode(tac.op))) return "";
+    std::string a = tac.arg1, b = tac.arg2;
+    if (isCommutative(tac.op) && b < a) std::swap(a, b);
+    return tac.op + " " + a + " " + b;
+}
+
+AvailableExprs computeAvailableExprs(const Function &fn) {
+    AvailableExprs ae;
+    RegisterEvents regs = scanRegisters(fn);
+
+    // Which expressions each register or variable feeds, for killing
+    std::unordered_map<std::string, std::vector<unsigned>> usersOfReg, usersOfVar;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) {
+            std::string key = exprKey(tac);
+            if (key.empty() || ae.index.count(key)) continue;
+            // An expression over a block-local register cannot be recomputed
+            // anywhere else, so it is not worth tracking
+            std::vector<std::string> uses;
+            tacUses(tac, uses);
+            bool local = false;
+            for (const auto &u : uses) local |= !regs.crossesBlocks[regs.intern[u]];
+            if (local) continue;
+            unsigned id = ae.exprs.size();
+            ae.index[key] = id;
+            ae.exprs.push_back(key);
+            if (tac.op == "load") {
+                usersOfVar[tac.arg1].push_back(id);
+            } else {
+                for (const auto &u : uses) usersOfReg[u].push_back(id);
+            }
+        }
+    }
+
+    size_t n = fn.blocks.size();
+    DataflowProblem p;
+    p.direction = Direction::Forward;
+    p.meet = Meet::Intersection;
+    p.universe = ae.exprs.size();
+    p.gen.assign(n, BitVector(p.universe));
+    p.kill.assign(n, BitVector(p.universe));
+    p.boundary = BitVector(p.universe);
+
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &tac : fn.blocks[b].code) {
+            auto key = ae.index.find(exprKey(tac));
+            if (key != ae.index.end()) p.gen[b].set(key->second);
+
+            const std::vector<unsigned> *killed = nullptr;
+            if (tac.op == "store" || tac.op == "param") {
+                auto it = usersOfVar.find(tac.op == "store" ? tac.result : tac.arg1);
+                if (it != usersOfVar.end()) killed = &it->second;
+            } else {
+                std::string d = tacDef(tac);
+                auto it = usersOfReg.find(d);
+                if (!d.empty() && it != usersOfReg.end()) killed = &it->second;
+            }
+            if (killed) {
+                for (unsigned id : *killed) {
+                    p.kill[b].set(id);
+                    p.gen[b].reset(id);
+                }
+            }
+        }
+    }
+
+    ae.sets = solveDataflow(fn, p);
+    return ae;
+}
+
+std::vector<std::string> variablesReadBeforeWritten(const Function &fn) {
+    std::unordered_map<std::string, unsigned> index;
+    std::vector<std::string> names;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) {
+            const std::string *var = tac.op == "load" || tac.op == "param" ? &tac.arg1
+                                     : tac.op == "store"                  ? &tac.result
+                                                                          : nullptr;
+            if (var && index.emplace(*var, names.size()).second) names.push_back(*var);
+        }
+    }
+
+    // Forward, over all paths: the variables written on every way here
+    size_t n = fn.blocks.size();
+    DataflowProblem p;
+    p.meet = Meet::Intersection;
+    p.universe = names.size();
+    p.gen.assign(n, BitVector(p.universe));
+    p.kill.assign(n, BitVector(p.universe));
+    p.boundary = BitVector(p.universe);
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &tac : fn.blocks[b].code) {
+            if (tac.op == "store") p.gen[b].set(index.at(tac.result));
+            if (tac.op == "param") p.gen[b].set(index.at(tac.arg1));
+        }
+    }
+    DataflowResult written = solveDataflow(fn, p);
+
+    BitVector reported(names.size());
+    std::vector<std::string> out;
+    for (size_t b = 0; b < n; b++) {
+        BitVector stored = written.in[b];
+        for (const auto &tac : fn.blocks[b].code) {
+            if (tac.op == "store") stored.set(index.at(tac.result));
+            if (tac.op == "param") stored.set(index.at(tac.arg1));
+            if (tac.op != "load") continue;
+            unsigned v = index.at(tac.arg1);
+            if (!stored.test(v) && !reported.test(v)) {
+                reported.set(v);
+                out.push_back(tac.arg1);
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "CFG.h"
+#include "BitVector.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Iterative bit-vector dataflow over a Function's CFG.
+//
+// A problem supplies per-block gen/kill sets over a universe of N facts; the
+// solver computes out = gen | (in & ~kill) (in and out swap roles for
+// backward problems) and joins with union or intersection. Blocks are
+// visited from a worklist ordered by reverse post-order (post-order for
+// backward problems), so acyclic regions converge in a single sweep.
+
+enum class Direction { Forward, Backward };
+enum class Meet { Union, Intersection };
+
+struct DataflowProblem {
+    Direction direction = Direction::Forward;
+    Meet meet = Meet::Union;
+    size_t universe = 0;
+    std::vector<BitVector> gen;  // Per block
+    std::vector<BitVector> kill; // Per block
+    BitVector boundary;          // Value flowing into the entry (forward) or out of exits (backward)
+};
+
+struct DataflowResult {
+    std::vector<BitVector> in;  // Value at block entry
+    std::vector<BitVector> out; // Value at block exit
+    unsigned visits = 0;        // Transfer function evaluations
+};
+
+DataflowResult solveDataflow(const Function &fn, const DataflowProblem &problem);
+
+//////////////////////////////////////////////////////////////////////////
+
+// Live registers at block boundaries. Registers that never cross a boundary
+// are not tracked and always report as dead; walk the block backwards from
+// the live-out set for per-instruction liveness.
+struct Liveness {
+    std::vector<std::string> names;
+    std::unordered_map<std::string, unsigned> index;
+    DataflowResult sets; // in = live-in, out = live-out
+
+    bool isLiveIn(int block, const std::string &name) const;
+    bool isLiveOut(int block, const std::string &name) const;
+};
+
+Liveness computeLiveness(const Function &fn);
+
+// Definitions (block, instruction) of registers reaching each block boundary.
+// As with liveness, registers confined to one block are not tracked.
+struct ReachingDefs {
+    std::vector<std::pair<int, int>> defs;
+    std::vector<std::string> defName; // Register written by each definition
+    std::unordered_map<std::string, std::vector<unsigned>> defsOf;
+    DataflowResult sets;
+};
+
+ReachingDefs computeReachingDefs(const Function &fn);
+
+// Expressions (pure operators and variable loads) computed on every path to
+// a point and not invalidated since. Expressions over block-local registers
+// are not tracked.
+struct AvailableExprs {
+    std::vector<std::string> exprs;
+    std::unordered_map<std::string, unsigned> index;
+    DataflowResult sets;
+};
+
+// Canonical key of the value an instruction computes, or "" if it is not an
+// expression. Commutative operands are ordered so `a+b` and `b+a` match.
+std::string exprKey(const TAC &tac);
+
+AvailableExprs computeAvailableExprs(const Function &fn);
+
+// Stack variables some path from the entry may load before any store or
+// param writes them, in order of first such load. A fresh frame starts them
+// at zero, which code reusing a frame (inlined or looping) must redo.
+std::vector<std::string> variablesReadBeforeWritten(const Function &fn);
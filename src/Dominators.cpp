@@ -0,0 +1,80 @@
+#include "Dominators.h"
+
+DominatorTree computeDominators(const Function &fn) {
+    size_t n = fn.blocks.size();
+    DominatorTree dt;
+    dt.idom.assign(n, -1);
+    dt.rpoIndex.assign(n, -1);
+    dt.children.assign(n, {});
+    dt.pre.assign(n, -1);
+    dt.post.assign(n, -1);
+    if (n == 0) return dt;
+
+    std::vector<int> rpo = fn.reversePostOrder();
+    for (size_t i = 0; i < rpo.size(); i++) dt.rpoIndex[rpo[i]] = i;
+
+    // Walk both fingers up the partial tree until they meet
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (dt.rpoIndex[a] > dt.rpoIndex[b]) a = dt.idom[a];
+            while (dt.rpoIndex[b] > dt.rpoIndex[a]) b = dt.idom[b];
+        }
+        return a;
+    };
+
+    dt.idom[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); i++) {
+            int b = rpo[i];
+            int newIdom = -1;
+            for (int p : fn.blocks[b].preds) {
+                if (dt.idom[p] < 0) continue; // Unprocessed or unreachable
+                newIdom = newIdom < 0 ? p : intersect(p, newIdom);
+            }
+            if (newIdom != dt.idom[b]) {
+                dt.idom[b] = newIdom;
+                changed = true;
+            }
+        }
+    }
+    dt.idom[0] = -1;
+
+    for (size_t i = 1; i < rpo.size(); i++) dt.children[dt.idom[rpo[i]]].push_back(rpo[i]);
+
+    int clock = 0;
+    std::vector<std::pair<int, size_t>> stack = {{0, 0}};
+    dt.pre[0] = clock++;
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        if (top.second < dt.children[top.first].size()) {
+            int c = dt.children[top.first][top.second++];
+            dt.pre[c] = clock++;
+            stack.push_back({c, 0});
+        } else {
+            dt.post[top.first] = clock++;
+            stack.pop_back();
+        }
+    }
+    return dt;
+}
+
+std::vector<std::vector<int>> dominanceFrontiers(const Function &fn, const DominatorTree &dt) {
+    std::vector<std::vector<int>> df(fn.blocks.size());
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        const auto &preds = fn.blocks[b].preds;
+        if (preds.size() < 2 || !dt.isReachable(b)) continue;
+        // Walk up from each predecessor to b's immediate dominator
+        for (int p : preds) {
+            int runner = p;
+            while (dt.isReachable(runner) && runner != dt.idom[b]) {
+                auto &frontier = df[runner];
+                if (frontier.empty() || frontier.back() != (int)b) frontier.push_back(b);
+                runner = dt.idom[runner];
+                if (runner < 0) break;
+            }
+        }
+    }
+    return df;
+}
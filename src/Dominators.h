@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CFG.h"
+#include <vector>
+
+// Dominator tree of a Function's CFG, computed with the iterative algorithm
+// of Cooper, Harvey and Kennedy over reverse post-order. The tree is numbered
+// in DFS pre/post order so dominance queries are O(1).
+struct DominatorTree {
+    std::vector<int> idom;                  // Immediate dominator; -1 for the entry and unreachable blocks
+    std::vector<int> rpoIndex;              // Position in reverse post-order; -1 if unreachable
+    std::vector<std::vector<int>> children; // Blocks immediately dominated
+    std::vector<int> pre, post;             // Tree numbering
+
+    bool isReachable(int b) const { return rpoIndex[b] >= 0; }
+
+    // True if every path from the entry to `b` passes through `a`; a block
+    // dominates itself.
+    bool dominates(int a, int b) const {
+        return isReachable(a) && isReachable(b) && pre[a] <= pre[b] && post[b] <= post[a];
+    }
+};
+
+DominatorTree computeDominators(const Function &fn);
+
+// Dominance frontier of every block: the blocks where its dominance ends,
+// which is where definitions in it need phis.
+std::vector<std::vector<int>> dominanceFrontiers(const Function &fn, const DominatorTree &dt);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Value semantics of TAC operators, shared by everything that evaluates TAC
+// at compile time or interprets it. Values are 64-bit two's complement, as in
+// the RV64 registers the backend computes in: arithmetic wraps, shift amounts
+// use their low six bits, `>>` is arithmetic, and division follows the
+// RISC-V M extension (x/0 == -1, x%0 == x, INT64_MIN/-1 == INT64_MIN,
+// INT64_MIN%-1 == 0) rather than trapping. `mulh` is the high half of the
+// 128-bit signed product, which only strength reduction generates.
+
+enum class EvalOp {
+    Add, Sub, Mul, MulHigh, Div, Rem, And, Or, Xor, Shl, Shr, LogAnd, LogOr,
+    Eq, Ne, Lt, Gt, Le, Ge,                 // Binary
+    Neg, Not, Seqz, Move,                   // Unary
+    Beqz, Bnez, Beq, Bne, Blt, Bgt, Bge, Ble, // Branch conditions
+    Invalid
+};
+
+inline EvalOp evalOpFor(const std::string &op) {
+    static const std::pair<const char *, EvalOp> table[] = {
+        {"+", EvalOp::Add}, {"-", EvalOp::Sub}, {"*", EvalOp::Mul}, {"mulh", EvalOp::MulHigh}, {"/", EvalOp::Div},
+        {"%", EvalOp::Rem}, {"&", EvalOp::And}, {"|", EvalOp::Or}, {"^", EvalOp::Xor},
+        {"<<", EvalOp::Shl}, {">>", EvalOp::Shr}, {"&&", EvalOp::LogAnd}, {"||", EvalOp::LogOr},
+        {"==", EvalOp::Eq}, {"!=", EvalOp::Ne}, {"<", EvalOp::Lt}, {">", EvalOp::Gt},
+        {"<=", EvalOp::Le}, {">=", EvalOp::Ge}, {"NEG", EvalOp::Neg}, {"~", EvalOp::Not},
+        {"seq", EvalOp::Seqz}, {"move", EvalOp::Move}, {"beqz", EvalOp::Beqz},
+        {"bnez", EvalOp::Bnez}, {"beq", EvalOp::Beq}, {"bne", EvalOp::Bne},
+        {"blt", EvalOp::Blt}, {"bgt", EvalOp::Bgt}, {"bge", EvalOp::Bge}, {"ble", EvalOp::Ble}};
+    for (const auto &entry : table) {
+        if (op == entry.first) return entry.second;
+    }
+    return EvalOp::Invalid;
+}
+
+// High 64 bits of the signed 128-bit product a*b.
+inline int64_t mulHigh(int64_t a, int64_t b) {
+    uint64_t ua = a, ub = b;
+    uint64_t aLo = ua & 0xffffffff, aHi = ua >> 32, bLo = ub & 0xffffffff, bHi = ub >> 32;
+    uint64_t cross = (aLo * bLo >> 32) + (aHi * bLo & 0xffffffff) + aLo * bHi;
+    uint64_t high = aHi * bHi + (aHi * bLo >> 32) + (cross >> 32);
+    // Unsigned to signed: subtract b * 2^64 if a < 0, and a * 2^64 if b < 0
+    if (a < 0) high -= ub;
+    if (b < 0) high -= ua;
+    return (int64_t)high;
+}
+
+// Evaluates a binary or unary operator (b is ignored for unary ones), or a
+// branch condition as 0/1.
+inline int64_t evalOp(EvalOp op, int64_t a, int64_t b) {
+    uint64_t ua = a, ub = b;
+    switch (op) {
+        case EvalOp::Add: return (int64_t)(ua + ub);
+        case EvalOp::Sub: return (int64_t)(ua - ub);
+        case EvalOp::Mul: return (int64_t)(ua * ub);
+        case EvalOp::MulHigh: return mulHigh(a, b);
+        case EvalOp::Div:
+            if (b == 0) return -1;
+            if (a == INT64_MIN && b == -1) return INT64_MIN;
+            return a / b;
+        case EvalOp::Rem:
+            if (b == 0) return a;
+            if (a == INT64_MIN && b == -1) return 0;
+            return a % b;
+        case EvalOp::And: return a & b;
+        case EvalOp::Or: return a | b;
+        case EvalOp::Xor: return a ^ b;
+        case EvalOp::Shl: return (int64_t)(ua << (ub & 63));
+        case EvalOp::Shr: return a >> (ub & 63);
+        case EvalOp::LogAnd: return a != 0 && b != 0;
+        case EvalOp::LogOr: return a != 0 || b != 0;
+        case EvalOp::Eq: case EvalOp::Beq: return a == b;
+        case EvalOp::Ne: case EvalOp::Bne: return a != b;
+        case EvalOp::Lt: case EvalOp::Blt: return a < b;
+        case EvalOp::Gt: case EvalOp::Bgt: return a > b;
+        case EvalOp::Le: case EvalOp::Ble: return a <= b;
+        case EvalOp::Ge: case EvalOp::Bge: return a >= b;
+        case EvalOp::Neg: return (int64_t)(0 - ua);
+        case EvalOp::Not: return ~a;
+        case EvalOp::Seqz: case EvalOp::Beqz: return a == 0;
+        case EvalOp::Bnez: return a != 0;
+        case EvalOp::Move: return a;
+        case EvalOp::Invalid: break;
+    }
+    return 0;
+}
+
+// String-keyed convenience for passes; returns false for non-value ops.
+inline bool evalTAC(const std::string &op, int64_t a, int64_t b, int64_t &result) {
+    EvalOp e = evalOpFor(op);
+    if (e == EvalOp::Invalid) return false;
+    result = evalOp(e, a, b);
+    return true;
+}
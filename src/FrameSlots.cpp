@@ -0,0 +1,173 @@
+#include "FrameSlots.h"
+#include "Dataflow.h"
+#include <unordered_map>
+
+namespace {
+
+// Pairs of a variable and a register that may hold its value, numbered for
+// the bit-vectors
+struct Copies {
+    struct Copy {
+        std::string var, reg;
+        bool stored; // From a store rather than a load
+    };
+    std::vector<Copy> copies;
+    std::unordered_map<std::string, unsigned> index; // "var reg" -> id
+    std::unordered_map<std::string, std::vector<unsigned>> ofVar, ofReg;
+
+    void add(const std::string &var, const std::string &reg, bool stored) {
+        if (isImmediate(reg) || !index.emplace(var + " " + reg, copies.size()).second) return;
+        ofVar[var].push_back(copies.size());
+        ofReg[reg].push_back(copies.size());
+        copies.push_back({var, reg, stored});
+    }
+
+    int find(const std::string &var, const std::string &reg) const {
+        auto it = index.find(var + " " + reg);
+        return it == index.end() ? -1 : (int)it->second;
+    }
+
+    const std::vector<unsigned> &of(const std::unordered_map<std::string, std::vector<unsigned>> &m,
+                                   const std::string &name) const {
+        static const std::vector<unsigned> none;
+        auto it = m.find(name);
+        return it == m.end() ? none : it->second;
+    }
+
+    // Applies `tac` to the pairs holding before it. With `killed`, also
+    // records the pairs it invalidates.
+    void step(const TAC &tac, BitVector &avail, BitVector *killed = nullptr) const {
+        auto kill = [&](const std::vector<unsigned> &ids) {
+            for (unsigned k : ids) {
+                avail.reset(k);
+                if (killed) killed->set(k);
+            }
+        };
+        std::string def = tacDef(tac);
+        if (!def.empty()) kill(of(ofReg, def));
+        if (tac.op == "store") kill(of(ofVar, tac.result));
+        if (tac.op == "param") kill(of(ofVar, tac.arg1));
+
+        int k = tac.op == "store" ? find(tac.result, tac.arg1) : tac.op == "load" ? find(tac.arg1, tac.result) : -1;
+        if (k >= 0) avail.set(k);
+    }
+};
+
+// Replaces loads with moves from registers known to hold the variable.
+void forwardLoads(Function &fn, long &forwarded, long &reused) {
+    Copies c;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) {
+            if (tac.op == "store") c.add(tac.result, tac.arg1, true);
+            else if (tac.op == "load") c.add(tac.arg1, tac.result, false);
+        }
+    }
+    if (c.copies.empty()) return;
+
+    size_t n = fn.blocks.size();
+    DataflowProblem problem;
+    problem.direction = Direction::Forward;
+    problem.meet = Meet::Intersection;
+    problem.universe = c.copies.size();
+    problem.boundary = BitVector(c.copies.size());
+    problem.gen.assign(n, BitVector(c.copies.size()));
+    problem.kill.assign(n, BitVector(c.copies.size()));
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &tac : fn.blocks[b].code) c.step(tac, problem.gen[b], &problem.kill[b]);
+    }
+    DataflowResult res = solveDataflow(fn, problem);
+
+    for (size_t b = 0; b < n; b++) {
+        BitVector avail = res.in[b];
+        for (auto &tac : fn.blocks[b].code) {
+            if (tac.op != "load") {
+                c.step(tac, avail);
+                continue;
+            }
+            int from = -1;
+            for (unsigned k : c.of(c.ofVar, tac.arg1)) {
+                if (avail.test(k) && c.copies[k].reg != tac.result) {
+                    from = k;
+                    break;
+                }
+            }
+            c.step(tac, avail);
+            if (from < 0) continue;
+            (c.copies[from].stored ? forwarded : reused)++;
+            tac = TAC("move", c.copies[from].reg, "", tac.result);
+        }
+    }
+}
+
+// Deletes stores whose value no load reads.
+long removeDeadStores(Function &fn) {
+    std::unordered_map<std::string, unsigned> index;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) {
+            if (tac.op == "load") index.emplace(tac.arg1, index.size());
+            else if (tac.op == "store") index.emplace(tac.result, index.size());
+        }
+    }
+    if (index.empty()) return 0;
+
+    // A variable is live where some path reads it before writing it; the
+    // frame is gone once the function returns
+    size_t n = fn.blocks.size();
+    DataflowProblem problem;
+    problem.direction = Direction::Backward;
+    problem.meet = Meet::Union;
+    problem.universe = index.size();
+    problem.boundary = BitVector(index.size());
+    problem.gen.assign(n, BitVector(index.size()));
+    problem.kill.assign(n, BitVector(index.size()));
+    for (size_t b = 0; b < n; b++) {
+        const auto &code = fn.blocks[b].code;
+        for (size_t i = code.size(); i-- > 0;) {
+            const TAC &tac = code[i];
+            if (tac.op == "load") {
+                problem.gen[b].set(index[tac.arg1]);
+            } else if (tac.op == "store") {
+                problem.gen[b].reset(index[tac.result]);
+                problem.kill[b].set(index[tac.result]);
+            }
+        }
+    }
+    DataflowResult res = solveDataflow(fn, problem);
+
+    long removed = 0;
+    for (size_t b = 0; b < n; b++) {
+        auto &code = fn.blocks[b].code;
+        BitVector live = res.out[b];
+        std::vector<TAC> kept;
+        for (size_t i = code.size(); i-- > 0;) {
+            const TAC &tac = code[i];
+            if (tac.op == "store") {
+                unsigned v = index[tac.result];
+                if (!live.test(v)) {
+                    removed++;
+                    continue;
+                }
+                live.reset(v);
+            } else if (tac.op == "load") {
+                live.set(index[tac.arg1]);
+            }
+            kept.push_back(tac);
+        }
+        code.assign(kept.rbegin(), kept.rend());
+    }
+    return removed;
+}
+
+} // namespace
+
+void optimizeFrameSlots(Module &module, Function &fn, Statistics &stats) {
+    (void)module;
+    if (fn.ssa) return; // Promotion has taken the variables out of memory by then
+    long forwarded = 0, reused = 0;
+    forwardLoads(fn, forwarded, reused);
+    long removed = removeDeadStores(fn);
+
+    stats.add("slots", fn.name, "loads forwarded", forwarded);
+    stats.add("slots", fn.name, "loads reused", reused);
+    stats.add("slots", fn.name, "stores removed", removed);
+}
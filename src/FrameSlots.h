@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Redundant load and dead store elimination for stack variables.
+//
+// Every read of a variable is a `load` from its frame slot and every write a
+// `store`, even when the value is still in a register. Only loads, stores
+// and params reach a slot (the language has no address-of, and a callee
+// cannot see its caller's frame), so the slots can be tracked exactly:
+//
+// - A forward dataflow pass over (variable, register) pairs finds, at each
+//   load, registers holding the variable's value on every path to it: the
+//   register last stored to it or a previous load's result, as long as
+//   neither the variable nor the register has been written since. The load
+//   becomes a `move` from that register, which copy propagation removes.
+// - A backward liveness pass over variables then deletes stores that no
+//   load can read before the variable is written again or the function
+//   returns.
+//
+// Runs just before promotion, which takes the variables out of memory
+// altogether; with -fno-promote, this is what remains of the memory traffic
+// to remove.
+void optimizeFrameSlots(Module &module, Function &fn, Statistics &stats);
@@ -0,0 +1,186 @@
+#include "GVN.h"
+#include "Dominators.h"
+#include "Registers.h"
+#include <unordered_map>
+
+static bool isCommutative(const std::string &op) {
+    return op == "+" || op == "*" || op == "mulh" || op == "&" || op == "|" || op == "^" ||
+           op == "&&" || op == "||" || op == "==" || op == "!=";
+}
+
+// Comparisons numbered as their partner with the operands swapped.
+static const char *mirrored(const std::string &op) {
+    if (op == ">") return "<";
+    if (op == ">=") return "<=";
+    return nullptr;
+}
+
+void numberGlobalValues(Module &module, Function &fn, Statistics &stats) {
+    (void)module;
+    if (!fn.ssa) return; // Reusing a register is only sound if nothing redefines it
+    size_t n = fn.blocks.size();
+    RegisterNumbering regs(fn);
+    std::unordered_map<std::string, int> vars;
+    auto varId = [&](const std::string &name) { return vars.emplace(name, vars.size()).first->second; };
+
+    std::vector<std::vector<int>> storesIn(n); // Variables each block writes
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &tac : fn.blocks[b].code) {
+            forEachUse(tac, [&](const std::string &u) { regs.id(u); });
+            if (!tacDef(tac).empty()) regs.id(tac.result);
+            if (tac.op == "store") storesIn[b].push_back(varId(tac.result));
+            else if (tac.op == "param") storesIn[b].push_back(varId(tac.arg1));
+            else if (tac.op == "load") varId(tac.arg1);
+        }
+    }
+
+    DominatorTree dt = computeDominators(fn);
+
+    // Variables that may be written between b's immediate dominator and the
+    // entry to b: those stored in any block reaching b without passing the
+    // dominator, b itself included when it is in a loop
+    std::vector<int> visited(n, -1), clobbered, work;
+    auto findClobbered = [&](int b) {
+        clobbered.clear();
+        int d = dt.idom[b];
+        const auto &preds = fn.blocks[b].preds;
+        if (d < 0 || (preds.size() == 1 && preds[0] == d)) return;
+        work.assign(preds.begin(), preds.end());
+        while (!work.empty()) {
+            int p = work.back();
+            work.pop_back();
+            if (p == d || visited[p] == b) continue;
+            visited[p] = b;
+            clobbered.insert(clobbered.end(), storesIn[p].begin(), storesIn[p].end());
+            work.insert(work.end(), fn.blocks[p].preds.begin(), fn.blocks[p].preds.end());
+        }
+    };
+
+    // Scoped state, undone on the way back up the dominator tree
+    std::unordered_map<std::string, int> available; // Expression -> register holding it
+    std::vector<std::string> addedKeys;
+    std::vector<int> version(vars.size(), 0);
+    std::vector<std::pair<int, int>> oldVersions;
+    int nextVersion = 1;
+    auto bump = [&](int v) {
+        oldVersions.push_back({v, version[v]});
+        version[v] = nextVersion++;
+    };
+
+    std::vector<int> leader(regs.size(), -1); // Register replacing each redundant one
+    auto resolve = [&](std::string &u) {
+        int r = regs.find(u);
+        if (r < 0 || (size_t)r >= leader.size() || leader[r] < 0) return;
+        while (leader[r] >= 0) r = leader[r];
+        u = regs.name(r);
+    };
+    std::vector<std::vector<char>> redundant(n);
+    long expressions = 0, loads = 0;
+
+    auto visit = [&](int b) {
+        findClobbered(b);
+        for (int v : clobbered) bump(v);
+
+        auto &code = fn.blocks[b].code;
+        redundant[b].assign(code.size(), 0);
+        for (size_t i = 0; i < code.size(); i++) {
+            TAC &tac = code[i];
+            forEachUse(tac, resolve);
+
+            std::string key;
+            if (tac.op == "phi") {
+                // A phi whose operands are all one register, or itself, is that register
+                std::string same;
+                bool trivial = true;
+                for (const auto &arg : tac.phiArgs) {
+                    if (arg.second == tac.result || arg.second == same) continue;
+                    if (!same.empty() || isImmediate(arg.second)) trivial = false;
+                    same = arg.second;
+                }
+                if (trivial && !same.empty()) {
+                    leader[regs.find(tac.result)] = regs.id(same);
+                    redundant[b][i] = 1;
+                    expressions++;
+                    continue;
+                }
+                key = "phi " + fn.blocks[b].label;
+                for (const auto &arg : tac.phiArgs) key += " " + arg.first + ":" + arg.second;
+            } else if (tac.op == "store") {
+                bump(vars.at(tac.result));
+            } else if (tac.op == "param") {
+                bump(vars.at(tac.arg1));
+            } else if (tac.op == "load") {
+                int v = vars.at(tac.arg1);
+                key = "load " + tac.arg1 + "#" + std::to_string(version[v]);
+            } else if (isBinaryOpcode(tac.op)) {
+                std::string op = tac.op, a = tac.arg1, c = tac.arg2;
+                if (const char *m = mirrored(op)) {
+                    op = m;
+                    std::swap(a, c);
+                } else if (isCommutative(op) && c < a) {
+                    std::swap(a, c);
+                }
+                key = op + " " + a + " " + c;
+            } else if (isUnaryOpcode(tac.op) && tac.op != "move") {
+                key = tac.op + " " + tac.arg1;
+            }
+            if (key.empty()) continue;
+
+            int def = regs.find(tac.result);
+            auto it = available.emplace(key, def);
+            if (it.second) {
+                addedKeys.push_back(key);
+                continue;
+            }
+            leader[def] = it.first->second;
+            redundant[b][i] = 1;
+            if (tac.op == "load") loads++;
+            else expressions++;
+        }
+    };
+
+    struct Frame {
+        int block;
+        size_t child;
+        size_t keys, versions; // Sizes of the undo logs on entry
+    };
+    std::vector<Frame> stack;
+    auto enter = [&](int b) {
+        stack.push_back({b, 0, addedKeys.size(), oldVersions.size()});
+        visit(b);
+    };
+    enter(0);
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        if (top.child < dt.children[top.block].size()) {
+            enter(dt.children[top.block][top.child++]);
+            continue;
+        }
+        while (addedKeys.size() > top.keys) {
+            available.erase(addedKeys.back());
+            addedKeys.pop_back();
+        }
+        while (oldVersions.size() > top.versions) {
+            version[oldVersions.back().first] = oldVersions.back().second;
+            oldVersions.pop_back();
+        }
+        stack.pop_back();
+    }
+
+    // Drop the redundant instructions; phi operands on back edges were
+    // visited before their definitions, so resolve every use once more
+    for (size_t b = 0; b < n; b++) {
+        auto &code = fn.blocks[b].code;
+        size_t out = 0;
+        for (size_t i = 0; i < code.size(); i++) {
+            if (i < redundant[b].size() && redundant[b][i]) continue;
+            forEachUse(code[i], resolve);
+            if (out != i) code[out] = std::move(code[i]);
+            out++;
+        }
+        code.erase(code.begin() + out, code.end());
+    }
+
+    stats.add("gvn", fn.name, "expressions removed", expressions);
+    stats.add("gvn", fn.name, "loads removed", loads);
+}
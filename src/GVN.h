@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Dominator-based global value numbering over SSA form (the hash-based
+// walk of Briggs, Cooper and Simpson).
+//
+// Blocks are visited in a pre-order walk of the dominator tree with a scoped
+// table from expression to the register that first computed it, so a value
+// is only reused where its definition dominates. A pure operation whose
+// expression is already in the table is deleted and its uses read the
+// earlier register instead. Commutative operands are put in a canonical
+// order and `a > b` is numbered as `b < a`, so `a*b` matches `b*a`.
+//
+// Loads are keyed by the variable and its memory version, which a store to
+// the variable advances. A block whose paths from its immediate dominator
+// may pass a store also starts a new version, so `x + x` loads x once but a
+// load after a loop that assigns x does not reuse one from before it.
+//
+// `li` is left alone: a constant is cheaper to materialise again than to
+// keep in a register across the function.
+void numberGlobalValues(Module &module, Function &fn, Statistics &stats);
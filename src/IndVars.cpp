@@ -0,0 +1,173 @@
+#include "IndVars.h"
+#include "ScalarEvolution.h"
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+// Branch leaving the loop unless `pred` holds.
+static const char *exitBranch(const std::string &pred) {
+    if (pred == "<") return "bge";
+    if (pred == "<=") return "bgt";
+    if (pred == ">") return "ble";
+    if (pred == ">=") return "blt";
+    if (pred == "==") return "bne";
+    return "beq";
+}
+
+void simplifyInductionVariables(Module &module, Function &fn, Statistics &stats) {
+    if (!fn.ssa) return;
+    DominatorTree dt = computeDominators(fn);
+    if (findLoops(fn, dt).loops.empty()) return;
+    insertPreheaders(module, fn);
+    insertDedicatedExits(module, fn);
+    dt = computeDominators(fn);
+    LoopInfo info = findLoops(fn, dt);
+    ScalarEvolution se(fn, info);
+    size_t n = fn.blocks.size();
+    std::unordered_map<std::string, int> index;
+    for (size_t b = 0; b < n; b++) index[fn.blocks[b].label] = b;
+
+    // Blocks reading each register, for finding uses after a loop; a phi
+    // operand is read at the end of its predecessor
+    std::unordered_map<std::string, std::vector<int>> useBlocks;
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &tac : fn.blocks[b].code) {
+            if (tac.op == "phi") {
+                for (const auto &[label, value] : tac.phiArgs) {
+                    if (!isImmediate(value)) useBlocks[value].push_back(index.at(label));
+                }
+                continue;
+            }
+            forEachUse(tac, [&](const std::string &u) { useBlocks[u].push_back(b); });
+        }
+    }
+
+    // Instructions are added and removed at the end, so the indices the
+    // analysis holds stay valid; only branches are rewritten in place
+    std::vector<std::vector<TAC>> atStart(n), atEnd(n); // After the phis; before the closing branches
+    std::unordered_set<std::string> removedPhis;
+    std::unordered_map<std::string, std::string> replaced;              // Register -> register read instead
+    std::unordered_map<std::string, std::pair<std::string, int>> final; // Register -> (final value, loop)
+    long redundant = 0, rewritten = 0, finalValues = 0;
+
+    for (size_t l = info.loops.size(); l-- > 0;) {
+        const Loop &loop = info.loops[l];
+        int pre = findPreheader(fn, loop);
+        if (pre < 0) continue;
+        ExitTest test;
+        int64_t count = 0;
+        bool counted = se.exitTest(l, test) && ScalarEvolution::constantTripCount(test, count);
+
+        // The header phis that are recurrences, the one the exit test reads first
+        std::vector<std::pair<std::string, Recurrence>> ivs;
+        for (const auto &tac : fn.blocks[loop.header].code) {
+            if (tac.op != "phi") break;
+            Recurrence rec;
+            if (!se.recurrence(tac.result, l, rec)) continue;
+            ivs.push_back({tac.result, rec});
+            if (tac.result == test.value) std::swap(ivs.front(), ivs.back());
+        }
+
+        std::map<int64_t, size_t> kept; // Step -> index in ivs of the phi kept
+        for (size_t k = 0; k < ivs.size(); k++) {
+            const auto &[phi, rec] = ivs[k];
+            auto it = kept.emplace(rec.step, k);
+            if (it.second) continue;
+            const auto &[primary, primaryRec] = ivs[it.first->second];
+            LinearValue delta;
+            if (!addLinear(rec.start, primaryRec.start, -1, delta)) continue;
+            if (delta.isConstant() && delta.offset == 0) {
+                replaced[phi] = primary;
+            } else {
+                std::string d = materialize(module, delta, atEnd[pre]);
+                atStart[loop.header].push_back(TAC("+", primary, d, phi));
+            }
+            removedPhis.insert(phi);
+            redundant++;
+        }
+        if (!counted) continue;
+
+        // An exit test on a value derived from a kept phi i, x = i + d,
+        // compares i against bound - d instead, unless x is what the phi
+        // itself steps by. The values involved must not wrap, or the two
+        // tests could disagree
+        auto primary = kept.find(test.iv.step);
+        bool derived = primary != kept.end() && se.definition(test.value)->op != "phi";
+        for (const auto &tac : fn.blocks[loop.header].code) {
+            if (tac.op != "phi") break;
+            for (const auto &arg : tac.phiArgs) derived &= arg.second != test.value;
+        }
+        if (derived && test.iv.start.isConstant()) {
+            const auto &[phi, rec] = ivs[primary->second];
+            int64_t d, bound, last;
+            if (rec.start.isConstant() &&
+                !__builtin_sub_overflow(test.iv.start.offset, rec.start.offset, &d) &&
+                !__builtin_sub_overflow(test.bound.offset, d, &bound) &&
+                !__builtin_mul_overflow(count, rec.step, &last) &&
+                !__builtin_add_overflow(rec.start.offset, last, &last)) {
+                auto &code = fn.blocks[test.exiting].code;
+                TAC &branch = code[code.size() - 2];
+                std::string inside = loop.contains(index.at(branchTarget(branch))) ? branchTarget(branch) : code.back().result;
+                std::string b = materialize(module, LinearValue::constant(bound), atEnd[pre]);
+                branch = TAC(exitBranch(test.pred), phi, b, fn.blocks[test.exit].label);
+                code.back() = TAC("jmp", "", "", inside);
+                rewritten++;
+            }
+        }
+
+        // Final values of the recurrences computed on the last iteration
+        for (int b : loop.blocks) {
+            if (!dt.dominates(b, test.exiting)) continue;
+            for (const auto &tac : fn.blocks[b].code) {
+                Recurrence rec;
+                if (tacDef(tac).empty() || !se.recurrence(tac.result, l, rec) || !rec.start.isConstant()) continue;
+                bool usedAfter = false;
+                for (int u : useBlocks[tac.result]) usedAfter |= u >= 0 && !loop.contains(u);
+                if (!usedAfter || final.count(tac.result)) continue;
+                int64_t value = (int64_t)((uint64_t)rec.start.offset + (uint64_t)count * (uint64_t)rec.step);
+                std::string r = materialize(module, LinearValue::constant(value), atStart[test.exit]);
+                final[tac.result] = {r, (int)l};
+                finalValues++;
+            }
+        }
+    }
+
+    for (size_t b = 0; b < n; b++) {
+        auto &code = fn.blocks[b].code;
+        size_t phis = 0;
+        while (phis < code.size() && code[phis].op == "phi") phis++;
+        size_t out = 0;
+        for (size_t i = 0; i < phis; i++) {
+            if (removedPhis.count(code[i].result)) continue;
+            if (out != i) code[out] = std::move(code[i]);
+            out++;
+        }
+        code.erase(code.begin() + out, code.begin() + phis);
+        code.insert(code.begin() + out, atStart[b].begin(), atStart[b].end());
+        size_t at = code.size();
+        if (at && isTerminator(code[at - 1])) at--;
+        if (at && isCondBranch(code[at - 1].op)) at--;
+        code.insert(code.begin() + at, atEnd[b].begin(), atEnd[b].end());
+    }
+
+    // Uses after a loop read final values, and the phis removed read the
+    // ones kept; a register may be replaced by one that was itself replaced
+    auto resolve = [&](std::string &u, int at) {
+        auto f = final.find(u);
+        if (f != final.end() && at >= 0 && !info.loops[f->second.second].contains(at)) u = f->second.first;
+        for (auto r = replaced.find(u); r != replaced.end(); r = replaced.find(u)) u = r->second;
+    };
+    for (size_t b = 0; b < n; b++) {
+        for (auto &tac : fn.blocks[b].code) {
+            if (tac.op == "phi") {
+                for (auto &[label, value] : tac.phiArgs) resolve(value, index.at(label));
+            } else {
+                forEachUse(tac, [&](std::string &u) { resolve(u, b); });
+            }
+        }
+    }
+
+    stats.add("indvars", fn.name, "redundant phis removed", redundant);
+    stats.add("indvars", fn.name, "exit tests rewritten", rewritten);
+    stats.add("indvars", fn.name, "final values replaced", finalValues);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Induction variable simplification over SSA form, using the recurrences
+// and trip counts of ScalarEvolution.h.
+//
+// Loops are first put in canonical form: a preheader, and exit blocks
+// entered only from inside the loop. Then, per loop:
+//
+// - Header phis stepping by the same amount are redundant: all but one are
+//   replaced by the one kept plus the (invariant) difference of their
+//   starting values, computed in the preheader. With equal starts the phi
+//   simply becomes the kept one.
+// - An exit test on a derived value, such as `j < 10` for a j that is
+//   i + 3, is rewritten to test the kept phi against an adjusted constant,
+//   `i < 7`, when the trip count is known and neither side can wrap. The
+//   computation feeding the old test can then die.
+// - With a known trip count, uses after the loop of a recurrence computed on
+//   every iteration read its final value, start + count*step, from an `li`
+//   in the exit block when that is a constant.
+//
+// The code these make dead is left for dce.
+void simplifyInductionVariables(Module &module, Function &fn, Statistics &stats);
@@ -0,0 +1,275 @@
+#include "Inline.h"
+#include "Dataflow.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+// Instructions a call takes besides passing its arguments: the call, the
+// move of the result, and the callee's prologue and epilogue.
+const int CALL_COST = 10;
+// Saving for each use of a parameter whose argument is a constant.
+const int CONSTANT_USE_BONUS = 2;
+// How much further the limit stretches for callees declared `inline`.
+const int HINT_SCALE = 4;
+
+typedef std::unordered_map<std::string, std::string> Renaming;
+
+// Functions calling each other, with the strongly connected components
+// found by Tarjan's algorithm, which completes them callees first.
+struct CallGraph {
+    std::vector<std::vector<int>> callees;
+    std::vector<int> order;      // Functions, callees before their callers
+    std::vector<char> recursive; // Per function: on a cycle of calls
+    std::vector<int> index, low;
+    std::vector<int> stack;
+    std::vector<char> onStack;
+    int counter = 0;
+
+    void visit(int f) {
+        index[f] = low[f] = counter++;
+        stack.push_back(f);
+        onStack[f] = 1;
+        for (int g : callees[f]) {
+            if (index[g] < 0) {
+                visit(g);
+                low[f] = std::min(low[f], low[g]);
+            } else if (onStack[g]) {
+                low[f] = std::min(low[f], index[g]);
+            }
+        }
+        if (low[f] != index[f]) return;
+        size_t start = std::find(stack.begin(), stack.end(), f) - stack.begin();
+        bool cycle = stack.size() - start > 1 || std::count(callees[f].begin(), callees[f].end(), f);
+        for (size_t i = start; i < stack.size(); i++) {
+            recursive[stack[i]] = cycle;
+            onStack[stack[i]] = 0;
+            order.push_back(stack[i]);
+        }
+        stack.resize(start);
+    }
+
+    explicit CallGraph(std::vector<std::vector<int>> edges) : callees(std::move(edges)) {
+        size_t n = callees.size();
+        recursive.assign(n, 0);
+        index.assign(n, -1);
+        low.assign(n, 0);
+        onStack.assign(n, 0);
+        for (size_t f = 0; f < n; f++) {
+            if (index[f] < 0) visit(f);
+        }
+    }
+};
+
+// Instructions an inlined copy of the function adds.
+int bodySize(const Function &fn) {
+    int size = 0;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) size += tac.op != "param" && tac.op != "jmp";
+    }
+    return size;
+}
+
+std::vector<TAC> params(const Function &fn) {
+    std::vector<TAC> list;
+    for (const auto &tac : fn.blocks[0].code) {
+        if (tac.op != "param") break;
+        list.push_back(tac);
+    }
+    return list;
+}
+
+// Replaces the call at code[i] of block b, after its `nargs` args, with a
+// copy of the callee's body. The code after the call moves to a new block
+// following the copy, whose index is returned.
+size_t inlineCall(Module &module, Function &fn, size_t b, size_t i, size_t nargs, const Function &callee) {
+    auto &code = fn.blocks[b].code;
+    TAC call = code[i];
+    std::vector<std::string> args;
+    for (size_t k = i - nargs; k < i; k++) args.push_back(code[k].arg1);
+    BasicBlock rest;
+    rest.label = module.newLabel();
+    rest.code.assign(code.begin() + i + 1, code.end());
+    code.erase(code.begin() + (i - nargs), code.end());
+
+    Renaming labels, regs, vars;
+    for (const auto &bb : callee.blocks) labels[bb.label] = module.newLabel();
+    auto reg = [&](std::string &r) {
+        if (r.empty() || isImmediate(r)) return;
+        auto it = regs.try_emplace(r).first;
+        if (it->second.empty()) it->second = module.newTemp();
+        r = it->second;
+    };
+    // Source identifiers have no '.', so these never meet the caller's
+    auto var = [&](std::string &v) {
+        auto it = vars.try_emplace(v).first;
+        if (it->second.empty()) it->second = v + "." + std::to_string(module.nextId++);
+        v = it->second;
+    };
+
+    // The arguments go to the parameters' new variables, or registers once
+    // they have been promoted
+    std::vector<TAC> incoming = params(callee);
+    for (size_t k = 0; k < incoming.size(); k++) {
+        std::string arg = k < args.size() ? args[k] : "0";
+        if (incoming[k].result.empty()) {
+            var(incoming[k].arg1);
+            code.push_back(TAC("store", arg, "", incoming[k].arg1));
+        } else {
+            reg(incoming[k].result);
+            code.push_back(TAC("move", arg, "", incoming[k].result));
+        }
+    }
+    for (std::string v : variablesReadBeforeWritten(callee)) {
+        var(v);
+        code.push_back(TAC("store", "0", "", v));
+    }
+    code.push_back(TAC("jmp", "", "", labels.at(callee.blocks[0].label)));
+
+    std::vector<BasicBlock> body;
+    for (size_t cb = 0; cb < callee.blocks.size(); cb++) {
+        BasicBlock bb;
+        bb.label = labels.at(callee.blocks[cb].label);
+        for (TAC tac : callee.blocks[cb].code) {
+            if (tac.op == "param") continue;
+            forEachUse(tac, reg);
+            if (tac.op == "RETURN") {
+                if (!call.result.empty()) bb.code.push_back(TAC("move", tac.arg1, "", call.result));
+                bb.code.push_back(TAC("jmp", "", "", rest.label));
+                continue;
+            }
+            if (tac.op == "load") var(tac.arg1);
+            if (tac.op == "store") var(tac.result);
+            if (!tacDef(tac).empty()) reg(tac.result);
+            forEachTarget(tac, [&](std::string &target) { target = labels.at(target); });
+            bb.code.push_back(tac);
+        }
+        // Running off the end returns 0
+        if (cb + 1 == callee.blocks.size() && (bb.code.empty() || !isTerminator(bb.code.back()))) {
+            if (!call.result.empty()) bb.code.push_back(TAC("li", "0", "", call.result));
+            bb.code.push_back(TAC("jmp", "", "", rest.label));
+        }
+        body.push_back(std::move(bb));
+    }
+    body.push_back(std::move(rest));
+    fn.blocks.insert(fn.blocks.begin() + b + 1, body.begin(), body.end());
+    return b + body.size();
+}
+
+} // namespace
+
+void inlineCalls(Module &module, Statistics &stats, int limit, std::ostream *report) {
+    for (const auto &fn : module.functions) {
+        if (fn.ssa) return; // Inlined code would need phis of its own
+    }
+    std::unordered_map<std::string, int> byName;
+    for (size_t f = 0; f < module.functions.size(); f++) byName[module.functions[f].name] = f;
+
+    size_t n = module.functions.size();
+    std::vector<std::vector<int>> edges(n);
+    std::vector<int> calls(n, 0); // Call sites left, across the module
+    for (size_t f = 0; f < n; f++) {
+        for (const auto &bb : module.functions[f].blocks) {
+            for (const auto &tac : bb.code) {
+                auto it = tac.op == "call" ? byName.find(tac.arg1) : byName.end();
+                if (it == byName.end()) continue;
+                edges[f].push_back(it->second);
+                calls[it->second]++;
+            }
+        }
+    }
+    CallGraph graph(edges);
+
+    if (report) *report << "inlining decisions:" << std::endl;
+    std::vector<char> inlined(n, 0);
+    for (int f : graph.order) {
+        Function &fn = module.functions[f];
+        long done = 0;
+        for (size_t b = 0; b < fn.blocks.size(); b++) {
+            const auto &code = fn.blocks[b].code;
+            for (size_t i = 0; i < code.size(); i++) {
+                auto it = code[i].op == "call" ? byName.find(code[i].arg1) : byName.end();
+                if (it == byName.end()) continue;
+                int g = it->second;
+                const Function &callee = module.functions[g];
+                std::string decision = "    " + fn.name + " -> " + callee.name + ": ";
+                if (graph.recursive[g]) {
+                    if (report) *report << decision << "kept, recursive" << std::endl;
+                    stats.add("inline", fn.name, "calls kept (recursive)");
+                    continue;
+                }
+
+                size_t nargs = 0;
+                while (nargs < i && code[i - 1 - nargs].op == "arg") nargs++;
+                int cost = -CALL_COST;
+                bool once = calls[g] == 1 && callee.name != "main";
+                if (!once) {
+                    // Parameters given constants fold wherever they are read
+                    std::vector<TAC> incoming = params(callee);
+                    int bonus = 0;
+                    for (size_t k = 0; k < nargs && k < incoming.size(); k++) {
+                        const std::string &arg = code[i - nargs + k].arg1;
+                        bool constant = arg == "0";
+                        for (size_t d = i - nargs; d-- > 0;) {
+                            if (tacDef(code[d]) != arg) continue;
+                            constant = code[d].op == "li";
+                            break;
+                        }
+                        if (!constant) continue;
+                        const TAC &param = incoming[k];
+                        for (const auto &bb : callee.blocks) {
+                            for (const auto &tac : bb.code) {
+                                if (param.result.empty()) {
+                                    bonus += tac.op == "load" && tac.arg1 == param.arg1 ? CONSTANT_USE_BONUS : 0;
+                                } else {
+                                    forEachUse(tac, [&](const std::string &u) {
+                                        bonus += u == param.result ? CONSTANT_USE_BONUS : 0;
+                                    });
+                                }
+                            }
+                        }
+                    }
+                    cost = bodySize(callee) - CALL_COST - bonus;
+                }
+                int threshold = callee.inlineHint ? limit * HINT_SCALE : limit;
+                std::string weighed = "cost " + std::to_string(cost) + ", limit " + std::to_string(threshold) +
+                                      (once ? ", only call" : "") + (callee.inlineHint ? ", inline hint" : "");
+                if (cost > threshold) {
+                    if (report) *report << decision << "kept, " << weighed << std::endl;
+                    stats.add("inline", fn.name, "calls kept (cost)");
+                    continue;
+                }
+                if (report) *report << decision << "inlined, " << weighed << std::endl;
+
+                // The copy's calls are new call sites of their callees
+                calls[g]--;
+                inlined[g] = 1;
+                for (const auto &bb : callee.blocks) {
+                    for (const auto &tac : bb.code) {
+                        auto c = tac.op == "call" ? byName.find(tac.arg1) : byName.end();
+                        if (c != byName.end()) calls[c->second]++;
+                    }
+                }
+                b = inlineCall(module, fn, b, i, nargs, callee) - 1;
+                done++;
+                break;
+            }
+        }
+        if (!done) continue;
+        fn.recomputeEdges();
+        stats.add("inline", fn.name, "calls inlined", done);
+    }
+
+    // Functions whose every call was inlined
+    std::vector<Function> kept;
+    for (size_t f = 0; f < n; f++) {
+        Function &fn = module.functions[f];
+        if (inlined[f] && !calls[f] && fn.name != "main") {
+            if (report) *report << "    " << fn.name << ": removed, no calls left" << std::endl;
+            stats.add("inline", fn.name, "function removed");
+            continue;
+        }
+        kept.push_back(std::move(fn));
+    }
+    module.functions = std::move(kept);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+#include <ostream>
+
+// Inlining of calls, before SSA construction, driven by the call graph.
+//
+// Functions are visited callees first (strongly connected components of the
+// call graph in reverse topological order), so a callee has had its own
+// calls inlined before it is weighed as a whole. Functions that are part of
+// a cycle, directly or through others, are never inlined.
+//
+// A call site is inlined when its cost is at most `limit`, or four times
+// that for a callee declared `inline`. The cost is the callee's size in
+// instructions, less what the call itself takes (the call and return, and
+// the callee's prologue and epilogue) and less two for every use of a
+// parameter given a constant argument, which constant propagation can then
+// fold. Moving the body of a function called from one place copies nothing,
+// so such a call always qualifies. A function whose last call was inlined is
+// removed; main never is.
+//
+// The inlined body gets fresh labels, registers and stack variables: each
+// `param` becomes a store of the argument, each RETURN a move into the
+// call's result and a jump to the code after the call. Callee variables
+// that may be read before being written start at zero, as they do in a
+// fresh frame.
+//
+// With `report` set, every decision is written to it, one line per call.
+void inlineCalls(Module &module, Statistics &stats, int limit, std::ostream *report);
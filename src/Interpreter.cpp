@@ -0,0 +1,271 @@
+#include "Interpreter.h"
+#include <iomanip>
+#include <unordered_map>
+
+void Interpreter::decode(const Module &module) {
+    std::unordered_map<std::string, int> funcIndex;
+    for (size_t f = 0; f < module.functions.size(); f++) {
+        funcIndex[module.functions[f].name] = f;
+    }
+    std::unordered_map<std::string, int> opIndex;
+
+    for (const auto &fn : module.functions) {
+        DecodedFunction df;
+        df.name = fn.name;
+        std::unordered_map<std::string, int> regs, vars;
+        auto reg = [&](const std::string &name) {
+            return regs.try_emplace(name, (int)regs.size()).first->second;
+        };
+        auto var = [&](const std::string &name) {
+            return vars.try_emplace(name, (int)vars.size()).first->second;
+        };
+        auto operand = [&](const std::string &s) {
+            Operand o;
+            if (isImmediate(s)) o.imm = std::stoll(s);
+            else o.slot = reg(s);
+            return o;
+        };
+
+        // Lay the blocks out in order; branch targets are patched afterwards
+        std::vector<int> blockStart;
+        std::unordered_map<std::string, int> blockIndex;
+        std::vector<std::pair<int, std::string>> fixups;
+        std::vector<std::vector<std::string>> tableLabels; // Per jump table
+        for (size_t b = 0; b < fn.blocks.size(); b++) {
+            const auto &bb = fn.blocks[b];
+            blockIndex.emplace(bb.label, b);
+            std::string next = b + 1 < fn.blocks.size() ? fn.blocks[b + 1].label : "";
+            blockStart.push_back(df.code.size());
+            for (size_t i = 0; i < bb.code.size(); i++) {
+                const TAC &tac = bb.code[i];
+                Instr in;
+                in.opIndex = opIndex.try_emplace(tac.op, (int)opNames.size()).first->second;
+                if (in.opIndex == (int)opNames.size()) opNames.push_back(tac.op);
+
+                if (tac.op == "li") {
+                    in.kind = Kind::Li;
+                    in.a.imm = std::stoll(tac.arg1);
+                    in.dst = reg(tac.result);
+                } else if (tac.op == "load") {
+                    in.kind = Kind::Load;
+                    in.var = var(tac.arg1);
+                    in.dst = reg(tac.result);
+                } else if (tac.op == "store") {
+                    in.kind = Kind::Store;
+                    in.a = operand(tac.arg1);
+                    in.var = var(tac.result);
+                } else if (tac.op == "param") {
+                    in.kind = Kind::Param;
+                    if (tac.result.empty()) in.var = var(tac.arg1);
+                    else in.dst = reg(tac.result);
+                } else if (isBinaryOpcode(tac.op) || isUnaryOpcode(tac.op)) {
+                    in.kind = Kind::Compute;
+                    in.eval = evalOpFor(tac.op);
+                    in.a = operand(tac.arg1);
+                    if (isBinaryOpcode(tac.op)) in.b = operand(tac.arg2);
+                    in.dst = reg(tac.result);
+                } else if (isCondBranch(tac.op)) {
+                    in.kind = Kind::Branch;
+                    in.eval = evalOpFor(tac.op);
+                    in.a = operand(tac.arg1);
+                    if (tac.op != "beqz" && tac.op != "bnez") in.b = operand(tac.arg2);
+                    fixups.push_back({(int)df.code.size(), branchTarget(tac)});
+                } else if (tac.op == "jmp") {
+                    in.kind = Kind::Jmp;
+                    // Fall-through jumps, and the jump a preceding branch is
+                    // inverted over, disappear when the CFG is flattened
+                    bool prevFallsThrough = i > 0 && isCondBranch(bb.code[i - 1].op) &&
+                                            branchTarget(bb.code[i - 1]) == next;
+                    in.counted = tac.result != next && !prevFallsThrough;
+                    fixups.push_back({(int)df.code.size(), tac.result});
+                } else if (tac.op == "jtab") {
+                    in.kind = Kind::Table;
+                    in.a = operand(tac.arg1);
+                    in.target = tableLabels.size();
+                    tableLabels.push_back(tac.targets);
+                } else if (tac.op == "call") {
+                    in.kind = Kind::Call;
+                    auto it = funcIndex.find(tac.arg1);
+                    if (it == funcIndex.end()) {
+                        if (decodeError.empty()) decodeError = "call to undefined function '" + tac.arg1 + "'";
+                    } else {
+                        in.callee = it->second;
+                    }
+                    if (!tac.result.empty()) in.dst = reg(tac.result);
+                } else if (tac.op == "arg") {
+                    in.kind = Kind::Arg;
+                    in.a = operand(tac.arg1);
+                } else if (tac.op == "RETURN") {
+                    in.kind = Kind::Return;
+                    in.a = operand(tac.arg1);
+                } else if (tac.op == "phi") {
+                    // Only the flattened, out-of-SSA TAC is executable
+                    if (decodeError.empty()) decodeError = "cannot execute phi in " + fn.name;
+                } else {
+                    in.kind = Kind::Nop;
+                    in.counted = false;
+                }
+                df.code.push_back(in);
+            }
+        }
+        // Running off the end of the function returns 0
+        Instr ret;
+        ret.kind = Kind::Return;
+        ret.counted = false;
+        df.code.push_back(ret);
+
+        for (auto &[pc, label] : fixups) {
+            auto it = blockIndex.find(label);
+            if (it == blockIndex.end()) {
+                if (decodeError.empty()) decodeError = "branch to missing label '" + label + "' in " + fn.name;
+                continue;
+            }
+            df.code[pc].target = blockStart[it->second];
+        }
+        for (const auto &labels : tableLabels) {
+            std::vector<int> table;
+            for (const auto &label : labels) {
+                auto it = blockIndex.find(label);
+                if (it == blockIndex.end()) {
+                    if (decodeError.empty()) decodeError = "branch to missing label '" + label + "' in " + fn.name;
+                    table.push_back(0);
+                } else {
+                    table.push_back(blockStart[it->second]);
+                }
+            }
+            df.tables.push_back(std::move(table));
+        }
+
+        df.numRegs = regs.size();
+        df.numVars = vars.size();
+        functions.push_back(std::move(df));
+    }
+}
+
+bool Interpreter::run(const std::string &entry, InterpResult &result, std::string &error) {
+    if (!decodeError.empty()) {
+        error = decodeError;
+        return false;
+    }
+    int entryIndex = -1;
+    for (size_t f = 0; f < functions.size(); f++) {
+        if (functions[f].name == entry) entryIndex = f;
+    }
+    if (entryIndex < 0) {
+        error = "no function named '" + entry + "'";
+        return false;
+    }
+
+    struct Frame {
+        int func;
+        int pc = 0;
+        int retDst = -1;   // Caller register receiving the return value
+        size_t regBase;    // Into the shared register/variable stacks
+        size_t varBase;
+        size_t argBase;    // Incoming arguments are args[argBase, outBase)
+        size_t outBase;    // Outgoing arguments pushed by `arg` start here
+        int nextParam = 0;
+    };
+    std::vector<Frame> frames;
+    std::vector<int64_t> regs, vars, args;
+    std::vector<uint64_t> opCounts(opNames.size(), 0);
+    std::vector<uint64_t> funcCounts(functions.size(), 0), callCounts(functions.size(), 0);
+
+    auto push = [&](int func, int retDst, size_t argBase) {
+        Frame fr;
+        fr.func = func;
+        fr.retDst = retDst;
+        fr.regBase = regs.size();
+        fr.varBase = vars.size();
+        fr.argBase = argBase;
+        fr.outBase = args.size();
+        regs.resize(regs.size() + functions[func].numRegs, 0);
+        vars.resize(vars.size() + functions[func].numVars, 0);
+        frames.push_back(fr);
+        callCounts[func]++;
+    };
+    push(entryIndex, -1, 0);
+
+    while (true) {
+        Frame &fr = frames.back();
+        const Instr &in = functions[fr.func].code[fr.pc++];
+        if (in.counted) {
+            opCounts[in.opIndex]++;
+            funcCounts[fr.func]++;
+        }
+        int64_t *r = &regs[fr.regBase];
+        auto value = [&](const Operand &o) { return o.slot < 0 ? o.imm : r[o.slot]; };
+
+        switch (in.kind) {
+            case Kind::Li: r[in.dst] = in.a.imm; break;
+            case Kind::Load: r[in.dst] = vars[fr.varBase + in.var]; break;
+            case Kind::Store: vars[fr.varBase + in.var] = value(in.a); break;
+            case Kind::Param: {
+                size_t i = fr.argBase + fr.nextParam++;
+                int64_t arg = i < fr.outBase ? args[i] : 0;
+                if (in.dst >= 0) r[in.dst] = arg;
+                else vars[fr.varBase + in.var] = arg;
+                break;
+            }
+            case Kind::Compute: r[in.dst] = evalOp(in.eval, value(in.a), value(in.b)); break;
+            case Kind::Branch:
+                if (evalOp(in.eval, value(in.a), value(in.b))) fr.pc = in.target;
+                break;
+            case Kind::Jmp: fr.pc = in.target; break;
+            case Kind::Table: {
+                const auto &table = functions[fr.func].tables[in.target];
+                int64_t index = value(in.a);
+                if (index < 0 || index >= (int64_t)table.size()) {
+                    error = "jump table index " + std::to_string(index) + " out of range in " + functions[fr.func].name;
+                    return false;
+                }
+                fr.pc = table[index];
+                break;
+            }
+            case Kind::Arg: args.push_back(value(in.a)); break;
+            case Kind::Call:
+                // Every argument pushed since the last call belongs to this one
+                push(in.callee, in.dst, fr.outBase);
+                break;
+            case Kind::Return: {
+                int64_t v = value(in.a);
+                Frame done = fr;
+                frames.pop_back();
+                regs.resize(done.regBase);
+                vars.resize(done.varBase);
+                args.resize(done.argBase);
+                if (frames.empty()) {
+                    result.returnValue = v;
+                    for (size_t i = 0; i < opNames.size(); i++) {
+                        if (opCounts[i]) result.opCounts[opNames[i]] = opCounts[i];
+                        result.executed += opCounts[i];
+                    }
+                    for (size_t f = 0; f < functions.size(); f++) {
+                        if (callCounts[f]) {
+                            result.functionCounts[functions[f].name] = funcCounts[f];
+                            result.callCounts[functions[f].name] = callCounts[f];
+                        }
+                    }
+                    return true;
+                }
+                if (done.retDst >= 0) regs[frames.back().regBase + done.retDst] = v;
+                break;
+            }
+            case Kind::Nop: break;
+        }
+    }
+}
+
+void printInterpResult(std::ostream &out, const InterpResult &result) {
+    out << "return value: " << result.returnValue << "\n";
+    out << "instructions executed: " << result.executed << "\n";
+    out << "per opcode:\n";
+    for (const auto &[op, n] : result.opCounts) {
+        out << "    " << std::left << std::setw(10) << op << std::right << std::setw(12) << n << "\n";
+    }
+    out << "per function:\n";
+    for (const auto &[name, n] : result.functionCounts) {
+        out << "    " << std::left << std::setw(10) << name << std::right << std::setw(12) << n
+            << "  (" << result.callCounts.at(name) << " calls)\n";
+    }
+}
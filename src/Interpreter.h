@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CFG.h"
+#include "Eval.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Reference interpreter for TAC. Executes a Module directly, so the effect of
+// any pass can be checked and measured without the RISC-V toolchain.
+//
+// Dynamic counts follow what the backend emits: `EXPR` markers and jumps
+// that flattening turns into fall-through are executed but not counted.
+
+struct InterpResult {
+    int64_t returnValue = 0;
+    uint64_t executed = 0;                          // Counted instructions
+    std::map<std::string, uint64_t> opCounts;       // Per TAC op
+    std::map<std::string, uint64_t> functionCounts; // Instructions per function
+    std::map<std::string, uint64_t> callCounts;     // Calls per function
+};
+
+class Interpreter {
+    private:
+        enum class Kind { Li, Load, Store, Param, Compute, Branch, Jmp, Table, Call, Arg, Return, Nop };
+
+        struct Operand {
+            int slot = -1;   // Register slot, or -1 for an immediate
+            int64_t imm = 0;
+        };
+
+        struct Instr {
+            Kind kind;
+            EvalOp eval = EvalOp::Invalid;
+            int opIndex = 0;    // Into opNames, for counting
+            int dst = -1;       // Register slot written
+            Operand a, b;
+            int var = -1;       // Variable slot for load/store/param
+            int target = -1;    // Instruction index for branches; jump table for `jtab`
+            int callee = -1;
+            bool counted = true;
+        };
+
+        struct DecodedFunction {
+            std::string name;
+            int numRegs = 0;
+            int numVars = 0;
+            std::vector<Instr> code;
+            std::vector<std::vector<int>> tables; // Instruction indices of each `jtab`'s targets
+        };
+
+        std::vector<DecodedFunction> functions;
+        std::vector<std::string> opNames;
+        std::string decodeError;
+
+        void decode(const Module &module);
+
+    public:
+        Interpreter(const Module &module) { decode(module); }
+
+        // Runs `entry` with no arguments. Returns false and sets `error` if
+        // the program cannot be executed.
+        bool run(const std::string &entry, InterpResult &result, std::string &error);
+};
+
+void printInterpResult(std::ostream &out, const InterpResult &result);
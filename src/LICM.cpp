@@ -0,0 +1,86 @@
+#include "LICM.h"
+#include "Loops.h"
+#include "Registers.h"
+#include <unordered_map>
+
+void hoistLoopInvariants(Module &module, Function &fn, Statistics &stats) {
+    if (!fn.ssa) return; // Operands must have a single definition to be placed
+    long preheaders = insertPreheaders(module, fn);
+    DominatorTree dt = computeDominators(fn);
+    LoopInfo info = findLoops(fn, dt);
+    size_t n = fn.blocks.size();
+
+    RegisterNumbering regs(fn);
+    std::unordered_map<std::string, int> vars;
+    std::vector<int> defBlock;
+    std::vector<std::vector<int>> storesIn(n);
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &tac : fn.blocks[b].code) {
+            forEachUse(tac, [&](const std::string &u) { regs.id(u); });
+            if (tac.op == "store") storesIn[b].push_back(vars.emplace(tac.result, vars.size()).first->second);
+            if (tacDef(tac).empty()) continue;
+            size_t r = regs.id(tac.result);
+            if (r >= defBlock.size()) defBlock.resize(r + 1, -1);
+            defBlock[r] = b;
+        }
+    }
+    defBlock.resize(regs.size(), -1);
+
+    std::vector<int> rpoIndex(n, -1);
+    std::vector<int> rpo = fn.reversePostOrder();
+    for (size_t k = 0; k < rpo.size(); k++) rpoIndex[rpo[k]] = k;
+
+    std::vector<int> storedMark(vars.size(), -1);
+    long hoisted = 0;
+    for (size_t l = info.loops.size(); l-- > 0;) {
+        const Loop &loop = info.loops[l];
+        int pre = findPreheader(fn, loop);
+        if (pre < 0) continue;
+        for (int b : loop.blocks) {
+            for (int v : storesIn[b]) storedMark[v] = l;
+        }
+        auto invariant = [&](const TAC &tac) {
+            if (tac.op == "load") {
+                auto it = vars.find(tac.arg1);
+                if (it != vars.end() && storedMark[it->second] == (int)l) return false;
+            } else if (tac.op != "li" && !isBinaryOpcode(tac.op) && !isUnaryOpcode(tac.op)) {
+                return false;
+            }
+            bool outside = true;
+            forEachUse(tac, [&](const std::string &u) {
+                int d = defBlock[regs.find(u)];
+                if (d < 0 || loop.contains(d)) outside = false;
+            });
+            return outside;
+        };
+
+        std::vector<int> order = loop.blocks;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return rpoIndex[a] < rpoIndex[b]; });
+        std::vector<TAC> moved;
+        for (int b : order) {
+            auto &code = fn.blocks[b].code;
+            size_t out = 0;
+            for (size_t i = 0; i < code.size(); i++) {
+                if (invariant(code[i])) {
+                    defBlock[regs.find(code[i].result)] = pre;
+                    moved.push_back(std::move(code[i]));
+                    continue;
+                }
+                if (out != i) code[out] = std::move(code[i]);
+                out++;
+            }
+            code.erase(code.begin() + out, code.end());
+        }
+
+        // Before the preheader's closing branches
+        auto &code = fn.blocks[pre].code;
+        size_t at = code.size();
+        if (at && isTerminator(code[at - 1])) at--;
+        if (at && isCondBranch(code[at - 1].op)) at--;
+        code.insert(code.begin() + at, moved.begin(), moved.end());
+        hoisted += moved.size();
+    }
+
+    stats.add("licm", fn.name, "preheaders inserted", preheaders);
+    stats.add("licm", fn.name, "instructions hoisted", hoisted);
+}
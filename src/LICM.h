@@ -0,0 +1,19 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Loop-invariant code motion over SSA form.
+//
+// Every loop first gets a preheader (see Loops.h). Then, innermost loops
+// first, each pure instruction whose operands are all defined outside the
+// loop moves to the end of the preheader, so it runs once per entry into
+// the loop instead of once per iteration. That covers constants, arithmetic
+// on values fixed before the loop, and loads of variables the loop never
+// stores to. Blocks are visited in reverse post-order, so an instruction
+// that only depends on hoisted ones follows them out, and code hoisted out
+// of an inner loop can leave the enclosing one too.
+//
+// Nothing hoisted can trap or write memory, so moving it out of a branch
+// that might not run, or out of a loop that runs zero times, is harmless.
+void hoistLoopInvariants(Module &module, Function &fn, Statistics &stats);
@@ -0,0 +1,231 @@
+#include "LoopIdiom.h"
+#include "ScalarEvolution.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// binomial(n, j) modulo 2^64, for j up to 3. Among j consecutive factors
+// n, n-1, ... one is divisible by each d <= j in turn, even after the larger
+// divisors are taken out, so dividing before multiplying stays exact.
+uint64_t binomial(uint64_t n, int j) {
+    if (n < (uint64_t)j) return 0;
+    uint64_t factors[3];
+    for (int i = 0; i < j; i++) factors[i] = n - i;
+    for (int d = j; d >= 2; d--) {
+        for (int i = 0; i < j; i++) {
+            if (factors[i] % d == 0) {
+                factors[i] /= d;
+                break;
+            }
+        }
+    }
+    uint64_t r = 1;
+    for (int i = 0; i < j; i++) r *= factors[i];
+    return r;
+}
+
+// Appends the code replacing one loop, writing fresh registers.
+struct Emitter {
+    Module &module;
+    std::vector<TAC> &out;
+
+    std::string constant(int64_t v) {
+        std::string t = module.newTemp();
+        out.push_back(TAC("li", std::to_string(v), "", t));
+        return t;
+    }
+    std::string binary(const std::string &op, const std::string &a, const std::string &b) {
+        std::string t = module.newTemp();
+        out.push_back(TAC(op, a, b, t));
+        return t;
+    }
+    std::string sum(const std::string &a, const std::string &b) { return a.empty() ? b : binary("+", a, b); }
+};
+
+// The value of rec after a constant number of passing tests.
+std::string constantForm(Emitter &e, const Chrec &rec, uint64_t count) {
+    // Terms sharing a base register are added up before any code is emitted
+    std::vector<LinearValue> terms;
+    for (int j = 0; j <= rec.order(); j++) {
+        const LinearValue &c = rec.coeffs[j];
+        int64_t b = (int64_t)binomial(count, j);
+        LinearValue term{c.base, (int64_t)((uint64_t)c.scale * (uint64_t)b), (int64_t)((uint64_t)c.offset * (uint64_t)b)};
+        if (term.scale == 0) term.base.clear();
+        bool merged = false;
+        for (auto &t : terms) {
+            if (!merged && addLinear(t, term, 1, t)) merged = true;
+        }
+        if (!merged) terms.push_back(term);
+    }
+    std::string r;
+    for (const auto &t : terms) r = e.sum(r, materialize(e.module, t, e.out));
+    return r;
+}
+
+// The value of rec, of order 2 at most, after `count` passing tests.
+std::string runtimeForm(Emitter &e, const Chrec &rec, const std::string &count, std::string &pairs) {
+    std::string r = materialize(e.module, rec.coeffs[0], e.out);
+    for (int j = 1; j <= rec.order(); j++) {
+        const LinearValue &c = rec.coeffs[j];
+        if (c.isConstant() && c.offset == 0) continue;
+        if (j == 2 && pairs.empty()) {
+            // binomial(n, 2) as (n >> 1) * (n - 1 + (n & 1)), with a logical
+            // shift: whichever of n and n - 1 is even is halved
+            std::string one = e.constant(1);
+            std::string half = e.binary("&", e.binary(">>", count, one), e.constant(INT64_MAX));
+            std::string odd = e.binary("-", e.binary("+", count, e.binary("&", count, one)), one);
+            pairs = e.binary("*", half, odd);
+        }
+        const std::string &b = j == 1 ? count : pairs;
+        std::string term = c.isConstant() && c.offset == 1 ? b : e.binary("*", b, materialize(e.module, c, e.out));
+        r = e.sum(r, term);
+    }
+    return r;
+}
+
+// A register read after a loop, and the recurrence giving its value there.
+struct LiveOut {
+    std::string reg;
+    Chrec rec;
+    bool ahead; // rec is of the header phi reg feeds, one iteration on
+};
+
+} // namespace
+
+void replaceClosedFormLoops(Module &module, Function &fn, Statistics &stats) {
+    if (!fn.ssa) return;
+    DominatorTree dt = computeDominators(fn);
+    if (findLoops(fn, dt).loops.empty()) return;
+    insertPreheaders(module, fn);
+    insertDedicatedExits(module, fn);
+    dt = computeDominators(fn);
+    LoopInfo info = findLoops(fn, dt);
+    ScalarEvolution se(fn, info);
+    size_t n = fn.blocks.size();
+
+    // Blocks reading each register; a phi reads its operands in its own block
+    std::unordered_map<std::string, std::vector<int>> useBlocks;
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &tac : fn.blocks[b].code) {
+            if (tac.op == "phi") {
+                for (const auto &arg : tac.phiArgs) useBlocks[arg.second].push_back(b);
+            } else {
+                forEachUse(tac, [&](const std::string &u) { useBlocks[u].push_back(b); });
+            }
+        }
+    }
+
+    std::vector<char> innermost(info.loops.size(), 1);
+    for (const auto &loop : info.loops) {
+        if (loop.parent >= 0) innermost[loop.parent] = 0;
+    }
+
+    std::unordered_map<std::string, std::pair<std::string, int>> final; // Register -> (closed form, loop)
+    long replaced = 0, forms = 0, runtime = 0;
+    for (size_t l = 0; l < info.loops.size(); l++) {
+        const Loop &loop = info.loops[l];
+        int pre = findPreheader(fn, loop);
+        ExitTest test;
+        if (!innermost[l] || pre < 0 || fn.blocks[pre].code.back().op != "jmp" || !se.exitTest(l, test) ||
+            fn.blocks[test.exit].preds.size() != 1) {
+            continue;
+        }
+
+        // A value sent round the back edge is its header phi one iteration
+        // on. Its own recurrence may not be expressible, as when a rotated
+        // loop reads `a + c` after the loop: the start adds two registers
+        std::unordered_map<std::string, std::string> backEdge; // Latch value -> header phi
+        for (const auto &tac : fn.blocks[loop.header].code) {
+            if (tac.op != "phi") break;
+            for (const auto &[from, value] : tac.phiArgs) {
+                if (from == fn.blocks[loop.latches[0]].label) backEdge[value] = tac.result;
+            }
+        }
+
+        // Nothing but values may come out of the loop, and every value read
+        // after it must have a closed form, taken after the last iteration's
+        // passing tests or, for a back edge value, one more
+        bool ok = true;
+        std::vector<LiveOut> liveOut;
+        for (int b : loop.blocks) {
+            for (const auto &tac : fn.blocks[b].code) {
+                if (!isPure(tac) && tac.op != "jmp" && !isCondBranch(tac.op)) ok = false;
+                if (!ok || tacDef(tac).empty()) continue;
+                bool usedAfter = false;
+                for (int u : useBlocks[tac.result]) usedAfter |= !loop.contains(u);
+                if (!usedAfter) continue;
+                LiveOut live{tac.result, {}, false};
+                ok = dt.dominates(b, test.exiting);
+                if (ok && !se.chrec(tac.result, l, live.rec)) {
+                    auto phi = backEdge.find(tac.result);
+                    live.ahead = true;
+                    ok = phi != backEdge.end() && se.chrec(phi->second, l, live.rec);
+                }
+                liveOut.push_back(live);
+            }
+        }
+        int64_t count = 0;
+        bool constant = ScalarEvolution::constantTripCount(test, count);
+        for (const auto &live : liveOut) ok &= constant || live.rec.order() <= 2;
+        if (!ok) continue;
+
+        std::vector<TAC> code;
+        Emitter e{module, code};
+        std::string countReg, pairs, nextReg, nextPairs;
+        if (!constant) {
+            countReg = runtimeTripCount(module, test, code);
+            if (countReg.empty()) continue;
+            runtime++;
+        }
+        for (const auto &live : liveOut) {
+            std::string r;
+            if (constant) {
+                r = constantForm(e, live.rec, (uint64_t)count + live.ahead);
+            } else if (!live.ahead) {
+                r = runtimeForm(e, live.rec, countReg, pairs);
+            } else {
+                if (nextReg.empty()) nextReg = e.binary("+", countReg, e.constant(1));
+                r = runtimeForm(e, live.rec, nextReg, nextPairs);
+            }
+            final[live.reg] = {r, (int)l};
+            forms++;
+        }
+
+        // The preheader computes the values and goes straight to the exit
+        auto &preCode = fn.blocks[pre].code;
+        preCode.insert(preCode.end() - 1, code.begin(), code.end());
+        preCode.back().result = fn.blocks[test.exit].label;
+        for (auto &tac : fn.blocks[test.exit].code) {
+            if (tac.op != "phi") break;
+            for (auto &arg : tac.phiArgs) {
+                if (arg.first == fn.blocks[test.exiting].label) arg.first = fn.blocks[pre].label;
+            }
+        }
+        stats.add("idiom", fn.name, "loop " + fn.blocks[loop.header].label + " replaced");
+        replaced++;
+    }
+    if (!replaced) return;
+
+    // Reads after a replaced loop take its closed forms; the loop itself is
+    // now unreachable
+    for (size_t b = 0; b < n; b++) {
+        auto resolve = [&](std::string &u) {
+            auto f = final.find(u);
+            if (f != final.end() && !info.loops[f->second.second].contains(b)) u = f->second.first;
+        };
+        for (auto &tac : fn.blocks[b].code) {
+            if (tac.op == "phi") {
+                for (auto &arg : tac.phiArgs) resolve(arg.second);
+            } else {
+                forEachUse(tac, resolve);
+            }
+        }
+    }
+    fn.recomputeEdges();
+    removeUnreachableBlocks(fn);
+
+    stats.add("idiom", fn.name, "loops replaced", replaced);
+    stats.add("idiom", fn.name, "runtime trip counts", runtime);
+    stats.add("idiom", fn.name, "closed forms computed", forms);
+}
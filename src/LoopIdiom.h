@@ -0,0 +1,30 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Replaces loops that only compute values with the closed form of those
+// values, over SSA form and the recurrences of ScalarEvolution.h.
+//
+// An innermost loop qualifies when it has no side effects (only pure
+// instructions and branches), a trip count worked out from its exit test,
+// and every register it defines that is read after it is a polynomial
+// recurrence computed on every iteration. Sums such as `x += i` over an
+// affine i are order 2 recurrences, counted increments order 1, and sums of
+// products of affine values up to order 3. A value sent round the back edge
+// whose own recurrence cannot be expressed, as in a rotated loop reading
+// `a + c` after it, takes the value of its header phi one iteration on.
+//
+// The value of {c0, +, c1, ..., +, ck} when the loop leaves, after n passing
+// tests, is the sum of cj * binomial(n, j); it is computed in the preheader,
+// which then jumps straight to the exit, and the loop is removed. All of it
+// is modulo 2^64, exactly like the wrapping arithmetic it replaces: the
+// binomials divide their factors before multiplying, and n is exact as an
+// unsigned count.
+//
+// A constant trip count folds the binomials. Otherwise the count is computed
+// at run time, by runtimeTripCount() of ScalarEvolution.h, for recurrences up
+// to order 2.
+//
+// Each loop replaced is reported with its header's label.
+void replaceClosedFormLoops(Module &module, Function &fn, Statistics &stats);
@@ -0,0 +1,176 @@
+#include "Loops.h"
+
+LoopInfo findLoops(const Function &fn, const DominatorTree &dt) {
+    LoopInfo info;
+    size_t n = fn.blocks.size();
+    std::vector<int> mark(n, -1), work;
+    for (size_t h = 0; h < n; h++) {
+        if (!dt.isReachable(h)) continue;
+        Loop loop;
+        loop.header = h;
+        for (int p : fn.blocks[h].preds) {
+            if (dt.dominates(h, p)) loop.latches.push_back(p);
+        }
+        if (loop.latches.empty()) continue;
+
+        mark[h] = h;
+        loop.blocks.push_back(h);
+        work = loop.latches;
+        while (!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            if (mark[b] == (int)h) continue;
+            mark[b] = h;
+            loop.blocks.push_back(b);
+            for (int p : fn.blocks[b].preds) {
+                if (dt.isReachable(p)) work.push_back(p);
+            }
+        }
+        std::sort(loop.blocks.begin(), loop.blocks.end());
+        info.loops.push_back(std::move(loop));
+    }
+
+    // Natural loops with different headers are either disjoint or nested,
+    // the outer one strictly larger, so by decreasing size every loop comes
+    // after the loops around it
+    std::stable_sort(info.loops.begin(), info.loops.end(),
+                     [](const Loop &a, const Loop &b) { return a.blocks.size() > b.blocks.size(); });
+    info.innermost.assign(n, -1);
+    for (size_t l = 0; l < info.loops.size(); l++) {
+        Loop &loop = info.loops[l];
+        loop.parent = info.innermost[loop.header];
+        loop.depth = loop.parent < 0 ? 1 : info.loops[loop.parent].depth + 1;
+        for (int b : loop.blocks) info.innermost[b] = l;
+    }
+    return info;
+}
+
+std::vector<int> exitBlocks(const Function &fn, const Loop &loop) {
+    std::vector<int> exits;
+    for (int b : loop.blocks) {
+        for (int s : fn.blocks[b].succs) {
+            if (!loop.contains(s) && std::find(exits.begin(), exits.end(), s) == exits.end()) exits.push_back(s);
+        }
+    }
+    return exits;
+}
+
+int findPreheader(const Function &fn, const Loop &loop) {
+    int preheader = -1;
+    for (int p : fn.blocks[loop.header].preds) {
+        if (loop.contains(p)) continue;
+        if (preheader >= 0) return -1;
+        preheader = p;
+    }
+    if (preheader < 0 || fn.blocks[preheader].succs.size() != 1) return -1;
+    return preheader;
+}
+
+// A new block that jumps to block h and takes over the edges into h from
+// the blocks `from`: their branches are redirected to it, and in SSA form
+// the phi operands they supplied arrive through it instead, merged by a phi
+// of its own where there were several. The caller places the block.
+static BasicBlock redirectEdges(Module &module, Function &fn, int h, const std::vector<int> &from) {
+    BasicBlock added;
+    added.label = module.newLabel();
+    const std::string &target = fn.blocks[h].label;
+    std::vector<std::string> fromLabels;
+    for (int p : from) {
+        fromLabels.push_back(fn.blocks[p].label);
+        auto &code = fn.blocks[p].code;
+        for (size_t k = code.size() >= 2 ? code.size() - 2 : 0; k < code.size(); k++) {
+            forEachTarget(code[k], [&](std::string &t) {
+                if (t == target) t = added.label;
+            });
+        }
+    }
+
+    for (auto &tac : fn.blocks[h].code) {
+        if (tac.op != "phi") break;
+        std::vector<std::pair<std::string, std::string>> kept, entering;
+        for (auto &arg : tac.phiArgs) {
+            bool redirected = std::find(fromLabels.begin(), fromLabels.end(), arg.first) != fromLabels.end();
+            (redirected ? entering : kept).push_back(arg);
+        }
+        if (entering.size() == 1) {
+            kept.push_back({added.label, entering[0].second});
+        } else if (!entering.empty()) {
+            TAC phi("phi", "", "", module.newTemp());
+            phi.phiArgs = entering;
+            kept.push_back({added.label, phi.result});
+            added.code.push_back(phi);
+        }
+        tac.phiArgs = kept;
+    }
+    added.code.push_back(TAC("jmp", "", "", target));
+    return added;
+}
+
+// Places added[b] in front of block b for each b marked in `hasAdded`.
+static void placeBlocks(Function &fn, std::vector<BasicBlock> &added, const std::vector<char> &hasAdded, size_t count) {
+    size_t n = fn.blocks.size();
+    std::vector<BasicBlock> blocks;
+    blocks.reserve(n + count);
+    for (size_t b = 0; b < n; b++) {
+        if (hasAdded[b]) blocks.push_back(std::move(added[b]));
+        blocks.push_back(std::move(fn.blocks[b]));
+    }
+    fn.blocks = std::move(blocks);
+    fn.recomputeEdges();
+}
+
+size_t insertPreheaders(Module &module, Function &fn) {
+    DominatorTree dt = computeDominators(fn);
+    LoopInfo info = findLoops(fn, dt);
+    size_t n = fn.blocks.size();
+    std::vector<BasicBlock> added(n); // Block to place in front of each header
+    std::vector<char> hasAdded(n, 0);
+    size_t count = 0;
+    for (const auto &loop : info.loops) {
+        int h = loop.header;
+        // The entry block cannot be given a predecessor
+        if (h == 0 || hasAdded[h] || findPreheader(fn, loop) >= 0) continue;
+        std::vector<int> outside;
+        for (int p : fn.blocks[h].preds) {
+            if (!loop.contains(p)) outside.push_back(p);
+        }
+        if (outside.empty()) continue;
+        added[h] = redirectEdges(module, fn, h, outside);
+        hasAdded[h] = 1;
+        count++;
+    }
+    if (count) placeBlocks(fn, added, hasAdded, count);
+    return count;
+}
+
+size_t insertDedicatedExits(Module &module, Function &fn) {
+    size_t total = 0;
+    // An exit shared by loops with different blocks is split once per
+    // round, for one of them; the next round sees the new block
+    while (true) {
+        DominatorTree dt = computeDominators(fn);
+        LoopInfo info = findLoops(fn, dt);
+        size_t n = fn.blocks.size();
+        std::vector<BasicBlock> added(n);
+        std::vector<char> hasAdded(n, 0);
+        size_t count = 0;
+        for (const auto &loop : info.loops) {
+            for (int e : exitBlocks(fn, loop)) {
+                if (hasAdded[e]) continue;
+                std::vector<int> inside;
+                bool dedicated = true;
+                for (int p : fn.blocks[e].preds) {
+                    if (loop.contains(p)) inside.push_back(p);
+                    else if (dt.isReachable(p)) dedicated = false;
+                }
+                if (dedicated) continue;
+                added[e] = redirectEdges(module, fn, e, inside);
+                hasAdded[e] = 1;
+                count++;
+            }
+        }
+        if (!count) return total;
+        placeBlocks(fn, added, hasAdded, count);
+        total += count;
+    }
+}
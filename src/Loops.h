@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CFG.h"
+#include "Dominators.h"
+#include <algorithm>
+#include <vector>
+
+// Natural loops of a Function's CFG.
+//
+// A back edge is an edge into a block that dominates its source; the loop
+// of a header is the header plus every block that reaches one of its back
+// edges without passing through the header. Back edges sharing a header
+// form one loop. Edges into a block that does not dominate them (which the
+// front end never produces) form no loop.
+
+struct Loop {
+    int header;
+    std::vector<int> blocks;  // Sorted; includes the header
+    std::vector<int> latches; // Sources of the back edges
+    int parent = -1;          // Innermost enclosing loop, or -1
+    int depth = 1;            // 1 for outermost loops
+
+    bool contains(int b) const { return std::binary_search(blocks.begin(), blocks.end(), b); }
+};
+
+struct LoopInfo {
+    std::vector<Loop> loops;    // Enclosing loops come before the loops inside them
+    std::vector<int> innermost; // Per block: innermost loop containing it, or -1
+
+    int depth(int b) const { return innermost[b] < 0 ? 0 : loops[innermost[b]].depth; }
+};
+
+LoopInfo findLoops(const Function &fn, const DominatorTree &dt);
+
+// Blocks outside the loop that a block inside it branches to.
+std::vector<int> exitBlocks(const Function &fn, const Loop &loop);
+
+// The block every entry into the loop comes through: the header's only
+// predecessor outside the loop, provided the header is its only successor.
+// Returns -1 if the loop has none.
+int findPreheader(const Function &fn, const Loop &loop);
+
+// Gives every loop a preheader, adding an empty block in front of the
+// header where needed. Predecessors outside the loop are redirected to the
+// new block, which in SSA form also takes over merging their phi operands.
+// Block indices change, so dominators and loops must be recomputed; returns
+// the number of blocks added.
+size_t insertPreheaders(Module &module, Function &fn);
+
+// Makes every exit block of every loop dedicated: entered only from inside
+// that loop. Edges leaving a loop for a block with other predecessors go
+// through a new block instead, so code placed there runs exactly when the
+// loop is left that way. Like insertPreheaders(), changes block indices and
+// returns the number of blocks added.
+size_t insertDedicatedExits(Module &module, Function &fn);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cctype>
+#include <string>
+#include <vector>
+
+// RISC-V code between instruction selection and printing.
+//
+// Each instruction keeps its operands as they are printed: registers,
+// immediates, `offset(base)` addresses and labels. Labels are instructions
+// of their own, so passes over the list see where control may enter.
+struct MachineInstr {
+    std::string op;                    // Mnemonic, or "label"
+    std::vector<std::string> operands; // For a label, its name
+
+    MachineInstr(const std::string &op, std::vector<std::string> operands = {})
+        : op(op), operands(std::move(operands)) {}
+
+    bool isLabel() const { return op == "label"; }
+    bool isStore() const { return op == "sd"; }
+    bool isLoad() const { return op == "ld"; }
+    bool isCondBranch() const {
+        return op == "beqz" || op == "bnez" || op == "beq" || op == "bne" || op == "blt" || op == "bge";
+    }
+    // Control never falls through to the next instruction
+    bool isJump() const { return op == "j" || op == "jr" || op == "ret" || op == "tail"; }
+
+    // Label a branch or `j` goes to
+    const std::string &target() const { return operands.back(); }
+};
+
+struct MachineFunction {
+    std::string name;
+    std::vector<MachineInstr> code; // Starting with the function's label
+};
+
+// Base register of an `offset(base)` address.
+inline std::string addressBase(const std::string &address) {
+    size_t open = address.find('(');
+    return address.substr(open + 1, address.size() - open - 2);
+}
+
+// Register the instruction writes, or "" if none. Calls write a0 without
+// naming it, and are left out.
+inline std::string definedRegister(const MachineInstr &mi) {
+    if (mi.isLabel() || mi.isStore() || mi.isCondBranch() || mi.isJump() || mi.op == "call") return "";
+    return mi.operands.empty() ? "" : mi.operands[0];
+}
+
+// Calls f on each register the instruction reads among its operands.
+// Calls, tail calls and returns read argument registers without naming them.
+template <typename F>
+void forEachUsedRegister(const MachineInstr &mi, F f) {
+    if (mi.isLabel() || mi.op == "j" || mi.op == "call" || mi.op == "tail" || mi.op == "ret" || mi.op == "la") return;
+    size_t first = mi.isStore() || mi.isCondBranch() || mi.op == "jr" ? 0 : 1;
+    size_t last = mi.isCondBranch() ? mi.operands.size() - 1 : mi.operands.size();
+    for (size_t k = first; k < last; k++) {
+        const std::string &s = mi.operands[k];
+        if (s.empty() || s[0] == '-' || isdigit((unsigned char)s[0])) {
+            if (s.find('(') != std::string::npos) f(addressBase(s)); // offset(base)
+            continue;
+        }
+        f(s);
+    }
+}
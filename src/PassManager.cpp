@@ -0,0 +1,110 @@
+#include "PassManager.h"
+#include "Verifier.h"
+#include "ConstProp.h"
+#include "SSA.h"
+#include "SCCP.h"
+#include "DCE.h"
+#include "CopyProp.h"
+#include "GVN.h"
+#include "LICM.h"
+#include "StrengthReduce.h"
+#include "Promote.h"
+#include "Rotate.h"
+#include "IndVars.h"
+#include "LoopIdiom.h"
+#include "Unroll.h"
+#include "Unswitch.h"
+#include "Inline.h"
+#include "TailRecursion.h"
+#include "FrameSlots.h"
+#include <iostream>
+
+void PassManager::add(const std::string &name, FunctionPass pass, bool required) {
+    if (!required) {
+        optional.insert(name);
+        if (options.disabled.count(name)) return;
+    }
+    passes.push_back({name, pass, nullptr});
+}
+
+void PassManager::addOptIn(const std::string &name, FunctionPass pass, bool onByDefault) {
+    optional.insert(name);
+    if (options.disabled.count(name) || (!onByDefault && !options.enabled.count(name))) return;
+    passes.push_back({name, pass, nullptr});
+}
+
+void PassManager::addModule(const std::string &name, ModulePass pass) {
+    optional.insert(name);
+    if (options.disabled.count(name)) return;
+    passes.push_back({name, nullptr, pass});
+}
+
+bool PassManager::contains(const std::string &name) const {
+    for (const auto &pass : passes) {
+        if (pass.name == name) return true;
+    }
+    return false;
+}
+
+void PassManager::verify(const Module &module, const std::string &stage) const {
+    std::vector<std::string> errors;
+    if (verifyModule(module, errors)) return;
+
+    const size_t shown = 20;
+    std::cerr << "ERROR: IR verification failed after " << stage << std::endl;
+    for (size_t i = 0; i < errors.size() && i < shown; i++) {
+        std::cerr << "    " << errors[i] << std::endl;
+    }
+    if (errors.size() > shown) {
+        std::cerr << "    ... and " << errors.size() - shown << " more" << std::endl;
+    }
+    exit(1);
+}
+
+void PassManager::run(Module &module, Statistics &stats) const {
+    if (options.verifyEach) verify(module, "CFG construction");
+    for (const auto &pass : passes) {
+        if (pass.runModule) {
+            pass.runModule(module, stats);
+        } else {
+            for (auto &fn : module.functions) pass.run(module, fn, stats);
+        }
+        if (options.verifyEach) verify(module, pass.name);
+        if (pass.name == options.emitAfter) return;
+    }
+}
+
+void buildPipeline(PassManager &pm, const PassOptions &options) {
+    if (options.optLevel >= 1) {
+        pm.add("tailrec", eliminateTailRecursion);
+        int inlineLimit = options.inlineLimit;
+        bool report = options.inlineReport;
+        pm.addModule("inline", [inlineLimit, report](Module &module, Statistics &stats) {
+            inlineCalls(module, stats, inlineLimit, report ? &std::cerr : nullptr);
+        });
+        pm.add("constprop", propagateConstants);
+        pm.add("dce", eliminateDeadCode);
+        pm.add("slots", optimizeFrameSlots);
+        pm.add("promote", promoteVariables);
+        pm.add("rotate", rotateLoops);
+        pm.add("ssa", constructSSA, true);
+        pm.add("sccp", propagateConditionalConstants);
+        pm.add("copyprop", propagateCopies);
+        pm.add("gvn", numberGlobalValues);
+        pm.add("strength", reduceStrength);
+        pm.add("licm", hoistLoopInvariants);
+        int budget = options.unswitchLimit;
+        pm.addOptIn("unswitch", [budget](Module &module, Function &fn, Statistics &stats) {
+            unswitchLoops(module, fn, stats, budget);
+        }, options.optLevel >= 2);
+        pm.add("indvars", simplifyInductionVariables);
+        pm.add("idiom", replaceClosedFormLoops);
+        int factor = options.unrollFactor, limit = options.unrollLimit;
+        pm.addOptIn("unroll-loops", [factor, limit](Module &module, Function &fn, Statistics &stats) {
+            unrollLoops(module, fn, stats, factor, limit);
+        }, options.optLevel >= 2);
+        pm.add("dce", eliminateDeadCode);
+        pm.add("out-of-ssa", destructSSA, true);
+        pm.add("coalesce", coalesceCopies);
+    }
+}
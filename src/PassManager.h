@@ -0,0 +1,73 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+// Optimisation pipeline over a Module.
+//
+// Passes run one after another, each over every function. With
+// `--verify-each` the module is checked once after CFG construction and again
+// after every pass, so a pass that breaks an invariant is named immediately
+// instead of surfacing as wrong assembly much later. Passes count what they
+// change in a Statistics table, printed by `--stats`. `--emit-after=<pass>`
+// ends the pipeline after the first run of that pass, so the TAC can be
+// written out as it stood there.
+
+struct PassOptions {
+    int optLevel = 0;        // -O0 .. -O2
+    bool verifyEach = false; // --verify-each
+    bool stats = false;      // --stats
+    std::set<std::string> disabled; // -fno-<pass>
+    std::set<std::string> enabled;  // -f<pass>, for passes off by default
+    int unrollFactor = 4;           // -funroll-factor=N, rounded down to a power of two
+    int unrollLimit = 64;           // -funroll-limit=N: instructions of an unrolled loop
+    int unswitchLimit = 128;        // -funswitch-limit=N: instructions unswitching may add to a function
+    int inlineLimit = 30;           // -finline-limit=N: largest cost of a call inlined
+    bool inlineReport = false;      // --inline-report
+    std::string emitAfter;          // --emit-after=<pass>: last pass to run
+};
+
+// A transformation applied to one function at a time, recording what it did
+// in the statistics.
+typedef std::function<void(Module &, Function &, Statistics &)> FunctionPass;
+// A transformation over the whole module at once, for passes that look
+// across functions, like the inliner.
+typedef std::function<void(Module &, Statistics &)> ModulePass;
+
+class PassManager {
+    private:
+        struct Entry {
+            std::string name;
+            FunctionPass run;
+            ModulePass runModule; // Instead of run, for module passes
+        };
+
+        PassOptions options;
+        std::vector<Entry> passes;
+        std::set<std::string> optional; // Passes -fno-<pass> may turn off
+
+        void verify(const Module &module, const std::string &stage) const;
+
+    public:
+        PassManager(const PassOptions &options) : options(options) {}
+
+        // Registers a pass, unless it is optional and -fno-<name> disabled
+        // it. Required passes, like the SSA conversions, always run.
+        void add(const std::string &name, FunctionPass pass, bool required = false);
+        // Registers an optional pass that only runs when on by default or
+        // turned on by -f<name>; -fno-<name> still wins.
+        void addOptIn(const std::string &name, FunctionPass pass, bool onByDefault);
+        // Registers an optional module pass, which -fno-<name> may disable.
+        void addModule(const std::string &name, ModulePass pass);
+        bool isOptional(const std::string &name) const { return optional.count(name) > 0; }
+        // Whether a pass of that name is in the pipeline and enabled.
+        bool contains(const std::string &name) const;
+        void run(Module &module, Statistics &stats) const;
+};
+
+// Adds the passes enabled at options.optLevel, in pipeline order.
+void buildPipeline(PassManager &pm, const PassOptions &options);
@@ -0,0 +1,137 @@
+#include "Peephole.h"
+
+namespace {
+
+const size_t WINDOW = 8; // Instructions a stored value is forwarded across
+
+bool reads(const MachineInstr &mi, const std::string &reg) {
+    bool found = false;
+    forEachUsedRegister(mi, [&](const std::string &r) { found |= r == reg; });
+    return found;
+}
+
+// Temporaries and argument registers, the only ones selection moves values
+// between
+bool isScratch(const std::string &reg) {
+    return reg.size() == 2 && (reg[0] == 't' || reg[0] == 'a') && isdigit((unsigned char)reg[1]);
+}
+
+// Whether nothing reads the scratch register `reg` after code[i] before it
+// is written again.
+bool deadAfter(const std::vector<MachineInstr> &code, size_t i, const std::string &reg) {
+    bool arg = reg[0] == 'a';
+    for (size_t j = i + 1; j < code.size(); j++) {
+        const MachineInstr &mi = code[j];
+        if (mi.op == "ret") return reg != "a0";
+        // Calls read their arguments and clobber the t registers, which the
+        // register allocator never keeps values in across them
+        if (mi.op == "tail" || mi.op == "call") return !arg;
+        if (mi.isLabel() || mi.isCondBranch() || mi.isJump()) return false;
+        if (reads(mi, reg)) return false;
+        if (definedRegister(mi) == reg) return true;
+    }
+    return false;
+}
+
+// Whether one of the labels right after code[i] is `label`.
+bool labelFollows(const std::vector<MachineInstr> &code, size_t i, const std::string &label) {
+    for (size_t k = i + 1; k < code.size() && code[k].isLabel(); k++) {
+        if (code[k].operands[0] == label) return true;
+    }
+    return false;
+}
+
+const char *invertedBranch(const std::string &op) {
+    if (op == "beqz") return "bnez";
+    if (op == "bnez") return "beqz";
+    if (op == "beq") return "bne";
+    if (op == "bne") return "beq";
+    if (op == "blt") return "bge";
+    return "blt";
+}
+
+struct Peephole {
+    MachineFunction &fn;
+    Statistics &stats;
+    bool changed = false;
+
+    void hit(const char *rule) {
+        stats.add("peephole", fn.name, rule);
+        changed = true;
+    }
+
+    // sd rA, slot; ...; ld rB, slot  =>  sd rA, slot; ...; mv rB, rA
+    void forwardStore(size_t i) {
+        auto &code = fn.code;
+        std::string value = code[i].operands[0], slot = code[i].operands[1], base = addressBase(slot);
+        for (size_t j = i + 1; j < code.size() && j <= i + WINDOW; j++) {
+            MachineInstr &mi = code[j];
+            if (mi.isLabel() || mi.isCondBranch() || mi.isJump() || mi.op == "call") return;
+            if (mi.isLoad() && mi.operands[1] == slot) {
+                if (mi.operands[0] == value) {
+                    code.erase(code.begin() + j--);
+                } else {
+                    mi = MachineInstr("mv", {mi.operands[0], value});
+                }
+                hit("loads forwarded");
+                continue;
+            }
+            // Another base may name the same slot
+            if (mi.isStore() && (mi.operands[1] == slot || addressBase(mi.operands[1]) != base)) return;
+            std::string def = definedRegister(mi);
+            if (def == value || def == base) return;
+        }
+    }
+
+    // mv r, r  =>  (nothing);  op rT, ...; mv rD, rT  =>  op rD, ...
+    void removeMove(size_t i) {
+        auto &code = fn.code;
+        const std::string &dst = code[i].operands[0], src = code[i].operands[1];
+        if (dst == src) {
+            code.erase(code.begin() + i);
+            hit("moves removed");
+            return;
+        }
+        if (i == 0 || !isScratch(src) || definedRegister(code[i - 1]) != src || !deadAfter(code, i, src)) return;
+        code[i - 1].operands[0] = dst;
+        code.erase(code.begin() + i);
+        hit("moves removed");
+    }
+
+    // j L; L:  =>  L:
+    void removeJumpToNext(size_t i) {
+        auto &code = fn.code;
+        if (!labelFollows(code, i, code[i].target())) return;
+        code.erase(code.begin() + i);
+        hit("jumps removed");
+    }
+
+    // bcc L1; j L2; L1:  =>  b!cc L2; L1:
+    void invertBranch(size_t i) {
+        auto &code = fn.code;
+        if (i + 1 >= code.size() || code[i + 1].op != "j" || !labelFollows(code, i + 1, code[i].target())) return;
+        code[i].op = invertedBranch(code[i].op);
+        code[i].operands.back() = code[i + 1].target();
+        code.erase(code.begin() + i + 1);
+        hit("branches inverted");
+    }
+
+    void run() {
+        do {
+            changed = false;
+            for (size_t i = 0; i < fn.code.size(); i++) {
+                const MachineInstr &mi = fn.code[i];
+                if (mi.isStore()) forwardStore(i);
+                else if (mi.op == "mv") removeMove(i);
+                else if (mi.op == "j") removeJumpToNext(i);
+                else if (mi.isCondBranch()) invertBranch(i);
+            }
+        } while (changed);
+    }
+};
+
+} // namespace
+
+void optimizePeephole(MachineFunction &fn, Statistics &stats) {
+    Peephole{fn, stats}.run();
+}
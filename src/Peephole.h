@@ -0,0 +1,22 @@
+#pragma once
+
+#include "MachineInstr.h"
+#include "Statistics.h"
+
+// Peephole optimisation of selected RISC-V code, before it is printed.
+//
+// Instruction selection works one TAC instruction at a time, so its output
+// repeats itself across their boundaries. A window over the instruction list
+// rewrites:
+//
+// - `sd rA, slot` followed, in the same block and with rA unchanged, by
+//   `ld rB, slot`: the load becomes `mv rB, rA`, or goes if rB is rA;
+// - `mv r, r`, and an instruction defining rT followed by `mv rD, rT` when
+//   nothing reads rT afterwards: the instruction writes rD directly;
+// - `j L` where L is the next label;
+// - `bcc L1; j L2; L1:`, which becomes `b!cc L2; L1:`.
+//
+// Rules are applied until none matches, and each one's hits are counted
+// under "peephole" in the statistics. Liveness is only followed to the end
+// of the block, assuming registers are live beyond it.
+void optimizePeephole(MachineFunction &fn, Statistics &stats);
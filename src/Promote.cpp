@@ -0,0 +1,57 @@
+#include "Promote.h"
+#include "Dataflow.h"
+#include <unordered_map>
+
+void promoteVariables(Module &module, Function &fn, Statistics &stats) {
+    if (fn.ssa) return; // The promoted registers are written more than once
+    std::vector<std::string> zeroed = variablesReadBeforeWritten(fn);
+
+    std::unordered_map<std::string, std::string> regs;
+    auto promote = [&](const std::string &var) {
+        auto it = regs.try_emplace(var);
+        if (it.second) it.first->second = module.newTemp();
+        return it.first->second;
+    };
+    long params = 0, loads = 0, stores = 0;
+    for (auto &bb : fn.blocks) {
+        for (auto &tac : bb.code) {
+            if (tac.op == "param" && tac.result.empty()) {
+                tac.result = promote(tac.arg1);
+                params++;
+            } else if (tac.op == "load") {
+                tac = TAC("move", promote(tac.arg1), "", tac.result);
+                loads++;
+            } else if (tac.op == "store") {
+                tac = TAC("move", tac.arg1, "", promote(tac.result));
+                stores++;
+            }
+        }
+    }
+    if (!zeroed.empty()) {
+        // The registers are cleared once, so an entry block that heads a
+        // loop gets a block before it to do that in
+        if (!fn.blocks[0].preds.empty()) {
+            BasicBlock entry;
+            entry.label = module.newLabel();
+            auto &code = fn.blocks[0].code;
+            size_t n = 0;
+            while (n < code.size() && code[n].op == "param") n++;
+            entry.code.assign(code.begin(), code.begin() + n);
+            code.erase(code.begin(), code.begin() + n);
+            entry.code.push_back(TAC("jmp", "", "", fn.blocks[0].label));
+            fn.blocks.insert(fn.blocks.begin(), std::move(entry));
+            fn.recomputeEdges();
+        }
+        auto &code = fn.blocks[0].code;
+        size_t at = 0;
+        while (at < code.size() && code[at].op == "param") at++;
+        std::vector<TAC> clear;
+        for (const auto &var : zeroed) clear.push_back(TAC("li", "0", "", promote(var)));
+        code.insert(code.begin() + at, clear.begin(), clear.end());
+    }
+
+    stats.add("promote", fn.name, "variables promoted", regs.size());
+    stats.add("promote", fn.name, "params promoted", params);
+    stats.add("promote", fn.name, "loads replaced", loads);
+    stats.add("promote", fn.name, "stores replaced", stores);
+}
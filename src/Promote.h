@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Promotion of stack variables and parameters to registers, before SSA
+// construction (mem2reg).
+//
+// The front end keeps every local in memory: a param spills its argument to
+// the variable's frame slot and every read and write is a load or store.
+// Nothing but loads, stores and params can reach a slot (the language has
+// no address-of, and a callee cannot see its caller's locals), so every
+// variable can live in a register of its own for the whole function
+// instead. Its loads and stores become moves from and to that register, and
+// each param names the register, `param x . t`, so the argument never
+// touches the frame. constructSSA() then gives the register one name per
+// definition, with phis where they meet; that is what ScalarEvolution.h
+// recognises induction variables from.
+//
+// Variables some path reads before writing them start at zero, as they do
+// in a fresh frame, so their registers are cleared on entry. The frame is
+// left to the register allocator's spills.
+void promoteVariables(Module &module, Function &fn, Statistics &stats);
@@ -0,0 +1,702 @@
+#include "RegAlloc.h"
+#include "Dominators.h"
+#include "Loops.h"
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <unordered_set>
+
+namespace {
+
+const std::vector<std::string> ANYWHERE = {
+    "t0", "t1", "t2", "t3", "t4", "a0", "a1", "a2", "a3", "a4", "a5",
+    "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"};
+const std::vector<std::string> AWAY_FROM_ARGS = {
+    "t0", "t1", "t2", "t3", "t4",
+    "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"};
+const std::vector<std::string> ACROSS_CALLS = {
+    "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"};
+
+// Weight of an instruction at each loop depth; deeper loops count as the
+// deepest listed
+const double DEPTH_WEIGHT[] = {1, 10, 100, 1000, 10000};
+
+// Splits the code into blocks at labels and after branches, and links them
+// through their targets and fall-throughs.
+void buildBlocks(LiveRanges &r) {
+    Function &fn = r.cfg;
+    fn.name = r.code.empty() ? "" : r.code[0].arg1;
+    for (size_t i = 0; i < r.code.size(); i++) {
+        const TAC &tac = r.code[i];
+        const TAC *prev = i ? &r.code[i - 1] : nullptr;
+        if (!prev || tac.op == "label" || isCondBranch(prev->op) || isTerminator(*prev)) {
+            fn.blocks.emplace_back();
+            fn.blocks.back().label = tac.op == "label" ? tac.arg1 : "";
+            r.blockStart.push_back(i);
+        }
+        fn.blocks.back().code.push_back(tac);
+    }
+
+    std::unordered_map<std::string, int> byLabel;
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        if (!fn.blocks[b].label.empty()) byLabel[fn.blocks[b].label] = b;
+    }
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        auto &bb = fn.blocks[b];
+        auto addEdge = [&](int s) {
+            if (std::find(bb.succs.begin(), bb.succs.end(), s) == bb.succs.end()) bb.succs.push_back(s);
+        };
+        forEachTarget(bb.code.back(), [&](const std::string &label) {
+            auto it = byLabel.find(label);
+            if (it != byLabel.end()) addEdge(it->second);
+        });
+        if (!isTerminator(bb.code.back()) && b + 1 < fn.blocks.size()) addEdge(b + 1);
+    }
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        for (int s : fn.blocks[b].succs) fn.blocks[s].preds.push_back(b);
+    }
+}
+
+double blockWeight(const LiveRanges &r, int pos) {
+    int b = std::upper_bound(r.blockStart.begin(), r.blockStart.end(), pos) - r.blockStart.begin() - 1;
+    return DEPTH_WEIGHT[std::min(r.depth[b], 4)];
+}
+
+// Calls f(pos, live) for every instruction, each block from its end, with
+// the intervals live just after the instruction.
+template <class F>
+void walkLiveness(const LiveRanges &r, F f) {
+    for (size_t b = 0; b < r.cfg.blocks.size(); b++) {
+        BitVector live(r.intervals.size());
+        r.live.sets.out[b].forEach([&](size_t id) { live.set(r.index.at(r.live.names[id])); });
+        int first = r.blockStart[b];
+        for (int pos = first + r.cfg.blocks[b].code.size() - 1; pos >= first; pos--) {
+            const TAC &tac = r.code[pos];
+            f(pos, (const BitVector &)live);
+            std::string def = tacDef(tac);
+            if (!def.empty()) live.reset(r.index.at(def));
+            forEachUse(tac, [&](const std::string &reg) { live.set(r.index.at(reg)); });
+        }
+    }
+}
+
+} // namespace
+
+LiveRanges computeLiveRanges(const std::vector<TAC> &code) {
+    LiveRanges r;
+    r.code = code;
+    buildBlocks(r);
+    const Function &fn = r.cfg;
+    LoopInfo loops = findLoops(fn, computeDominators(fn));
+    for (size_t b = 0; b < fn.blocks.size(); b++) r.depth.push_back(loops.depth(b));
+    r.live = computeLiveness(fn);
+
+    // An interval is the hull of the positions its register is live at:
+    // block boundaries it is live across, and its uses and definitions
+    std::unordered_map<std::string, int> defs;
+    auto touch = [&](const std::string &reg, int pos) -> LiveInterval & {
+        auto it = r.index.emplace(reg, r.intervals.size());
+        if (it.second) {
+            r.intervals.emplace_back();
+            r.intervals.back().reg = reg;
+            r.intervals.back().start = r.intervals.back().end = pos;
+        }
+        LiveInterval &iv = r.intervals[it.first->second];
+        iv.start = std::min(iv.start, pos);
+        iv.end = std::max(iv.end, pos);
+        return iv;
+    };
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        int first = r.blockStart[b], last = first + fn.blocks[b].code.size() - 1;
+        r.live.sets.in[b].forEach([&](size_t id) { touch(r.live.names[id], first); });
+        r.live.sets.out[b].forEach([&](size_t id) { touch(r.live.names[id], last); });
+        double weight = blockWeight(r, first);
+        for (int pos = first; pos <= last; pos++) {
+            const TAC &tac = r.code[pos];
+            forEachUse(tac, [&](const std::string &reg) { touch(reg, pos).weight += weight; });
+            std::string def = tacDef(tac);
+            if (def.empty()) continue;
+            LiveInterval &iv = touch(def, pos);
+            iv.weight += weight;
+            iv.constant = ++defs[def] == 1 && tac.op == "li" ? tac.arg1 : "";
+        }
+    }
+
+    for (auto &iv : r.intervals) {
+        if (!iv.constant.empty()) iv.weight /= 2;
+    }
+    std::stable_sort(r.intervals.begin(), r.intervals.end(),
+                     [](const LiveInterval &a, const LiveInterval &b) { return a.start < b.start; });
+    for (size_t i = 0; i < r.intervals.size(); i++) r.index[r.intervals[i].reg] = i;
+
+    // Within a block a register is live from the block's start, if live into
+    // it, or from each definition up to the last use before the next one, or
+    // to the block's end if live out of it
+    std::vector<int> open(r.intervals.size(), -1), lastUse(r.intervals.size(), -1);
+    std::vector<int> opened, intervalOf; // By liveness id
+    for (const auto &name : r.live.names) intervalOf.push_back(r.index.at(name));
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        int first = r.blockStart[b], last = first + fn.blocks[b].code.size() - 1;
+        auto close = [&](int i, int to) {
+            auto &ranges = r.intervals[i].ranges;
+            if (!ranges.empty() && ranges.back().second + 1 >= open[i]) ranges.back().second = to;
+            else ranges.push_back({open[i], to});
+            open[i] = -1;
+        };
+        auto start = [&](int i, int from) {
+            open[i] = lastUse[i] = from;
+            opened.push_back(i);
+        };
+        opened.clear();
+        r.live.sets.in[b].forEach([&](size_t id) { start(intervalOf[id], 2 * first); });
+        for (int pos = first; pos <= last; pos++) {
+            const TAC &tac = r.code[pos];
+            forEachUse(tac, [&](const std::string &reg) {
+                int i = r.index.at(reg);
+                // `&&` and `||` write their result before reading arg2
+                int at = (tac.op == "&&" || tac.op == "||") && reg == tac.arg2 ? 2 * pos + 1 : 2 * pos;
+                if (open[i] < 0) start(i, at);
+                lastUse[i] = std::max(lastUse[i], at);
+            });
+            std::string def = tacDef(tac);
+            if (def.empty()) continue;
+            int i = r.index.at(def);
+            if (open[i] >= 0) close(i, lastUse[i]);
+            start(i, 2 * pos + 1);
+        }
+        r.live.sets.out[b].forEach([&](size_t id) {
+            if (open[intervalOf[id]] >= 0) close(intervalOf[id], 2 * last + 1);
+        });
+        for (int i : opened) {
+            if (open[i] >= 0) close(i, lastUse[i]);
+        }
+    }
+
+    // Calls clobber the caller-saved registers, and params and args read and
+    // write the a registers
+    walkLiveness(r, [&](int pos, const BitVector &live) {
+        const TAC &tac = r.code[pos];
+        std::string def = tacDef(tac);
+        int d = def.empty() ? -1 : r.index.at(def);
+        if (tac.op == "call") {
+            live.forEach([&](size_t i) {
+                if ((int)i != d) r.intervals[i].crossesCall = true;
+            });
+        } else if (tac.op == "param" || tac.op == "arg") {
+            live.forEach([&](size_t i) { r.intervals[i].nearArgs = true; });
+            if (d >= 0) r.intervals[d].nearArgs = true;
+            forEachUse(tac, [&](const std::string &reg) { r.intervals[r.index.at(reg)].nearArgs = true; });
+        }
+    });
+    return r;
+}
+
+bool LiveInterval::overlaps(const LiveInterval &other) const {
+    // Looks each span of the one with fewer up in the other
+    const auto &few = ranges.size() <= other.ranges.size() ? ranges : other.ranges;
+    const auto &many = &few == &ranges ? other.ranges : ranges;
+    for (const auto &[first, last] : few) {
+        auto it = std::lower_bound(many.begin(), many.end(), first,
+                                   [](const std::pair<int, int> &span, int h) { return span.second < h; });
+        if (it != many.end() && it->first <= last) return true;
+    }
+    return false;
+}
+
+std::vector<std::vector<TAC>> splitFunctions(const std::vector<TAC> &code) {
+    std::vector<std::vector<TAC>> functions;
+    for (const auto &tac : code) {
+        if (tac.op == "function" || functions.empty()) functions.emplace_back();
+        functions.back().push_back(tac);
+    }
+    return functions;
+}
+
+InterferenceGraph buildInterference(const LiveRanges &ranges) {
+    InterferenceGraph g;
+    g.adj.resize(ranges.intervals.size());
+    std::unordered_set<uint64_t> seen;
+    auto addEdge = [&](int a, int b) {
+        if (a == b || !seen.insert((uint64_t)std::min(a, b) << 32 | std::max(a, b)).second) return;
+        g.adj[a].push_back(b);
+        g.adj[b].push_back(a);
+        g.edges++;
+    };
+    walkLiveness(ranges, [&](int pos, const BitVector &live) {
+        const TAC &tac = ranges.code[pos];
+        std::string def = tacDef(tac);
+        if (def.empty()) return;
+        int d = ranges.index.at(def);
+        int src = -1;
+        if (tac.op == "move" && !isImmediate(tac.arg1)) {
+            src = ranges.index.at(tac.arg1);
+            if (src != d) {
+                g.moves.push_back({d, src});
+                g.moveWeight.push_back(blockWeight(ranges, pos));
+            }
+        }
+        live.forEach([&](size_t i) {
+            if ((int)i != src) addEdge(d, i);
+        });
+        if ((tac.op == "&&" || tac.op == "||") && !isImmediate(tac.arg2)) addEdge(d, ranges.index.at(tac.arg2));
+    });
+    return g;
+}
+
+const std::vector<std::string> &allowedRegisters(const LiveInterval &interval) {
+    if (interval.crossesCall) return ACROSS_CALLS;
+    return interval.nearArgs ? AWAY_FROM_ARGS : ANYWHERE;
+}
+
+void assignSpillSlots(const LiveRanges &ranges, const std::vector<int> &spilled, Allocation &alloc) {
+    std::vector<int> order = spilled;
+    std::sort(order.begin(), order.end());
+    std::vector<int> slotEnd; // Last position each slot is in use
+    for (int i : order) {
+        const LiveInterval &iv = ranges.intervals[i];
+        if (!iv.constant.empty()) {
+            alloc.remat[iv.reg] = iv.constant;
+            continue;
+        }
+        size_t s = 0;
+        while (s < slotEnd.size() && slotEnd[s] >= iv.start) s++;
+        if (s == slotEnd.size()) slotEnd.push_back(0);
+        slotEnd[s] = iv.end;
+        alloc.slot[iv.reg] = s;
+    }
+    alloc.slots = slotEnd.size();
+
+    std::set<std::string> used;
+    for (const auto &[vreg, reg] : alloc.reg) used.insert(reg);
+    for (const auto &reg : ACROSS_CALLS) {
+        if (used.count(reg)) alloc.calleeSaved.push_back(reg);
+    }
+}
+
+Allocation allocateLinearScan(const LiveRanges &ranges) {
+    const auto &intervals = ranges.intervals;
+    Allocation alloc;
+    // Physical register -> the intervals given it that have not ended, all
+    // but one of them in holes at any point
+    std::unordered_map<std::string, std::vector<int>> holders;
+    std::vector<int> spilled;
+
+    // Cost of spilling per position live, so long intervals that are
+    // rarely used go before short busy ones
+    auto length = [&](int i) { return intervals[i].end - intervals[i].start + 1; };
+    auto density = [&](int i) { return intervals[i].weight / length(i); };
+    std::vector<int> conflicts, victims;
+    for (int i = 0; i < (int)intervals.size(); i++) {
+        const LiveInterval &cur = intervals[i];
+        std::string reg, victimReg;
+        double victimDensity = 0;
+        int victimEnd = 0;
+        for (const auto &r : allowedRegisters(cur)) {
+            // Intervals that ended before this one starts let go
+            auto &held = holders[r];
+            held.erase(std::remove_if(held.begin(), held.end(),
+                                      [&](int j) { return intervals[j].end < cur.start; }),
+                       held.end());
+            conflicts.clear();
+            double weight = 0;
+            int positions = 0, end = 0;
+            for (int j : held) {
+                if (!intervals[j].overlaps(cur)) continue;
+                conflicts.push_back(j);
+                weight += intervals[j].weight;
+                positions += length(j);
+                end = std::max(end, intervals[j].end);
+            }
+            if (conflicts.empty()) {
+                reg = r;
+                break;
+            }
+            // Never spill more than this one would cost: a value used all
+            // through a loop keeps its register and a short one inside goes
+            if (weight >= cur.weight) continue;
+            double d = weight / positions;
+            if (victimReg.empty() || d < victimDensity || (d == victimDensity && end > victimEnd)) {
+                victimReg = r;
+                victimDensity = d;
+                victimEnd = end;
+                victims = conflicts;
+            }
+        }
+        if (reg.empty()) {
+            if (victimReg.empty() || victimDensity >= density(i)) {
+                spilled.push_back(i);
+                continue;
+            }
+            reg = victimReg;
+            auto &held = holders[reg];
+            for (int j : victims) {
+                held.erase(std::find(held.begin(), held.end(), j));
+                alloc.reg.erase(intervals[j].reg);
+                spilled.push_back(j);
+            }
+        }
+        alloc.reg[cur.reg] = reg;
+        holders[reg].push_back(i);
+    }
+    assignSpillSlots(ranges, spilled, alloc);
+    return alloc;
+}
+
+namespace {
+
+// State of the iterated register coalescing allocator. Nodes 0..K-1 are the
+// physical registers of ANYWHERE, precoloured; node K + i is interval i.
+struct Coalescer {
+    enum NodeState { Precolored, Initial, Simplify, Freeze, Spill, Spilled, Coalesced, Colored, Selected };
+    enum MoveState { WorklistMove, ActiveMove, CoalescedMove, ConstrainedMove, FrozenMove };
+
+    const LiveRanges &ranges;
+    const InterferenceGraph &graph;
+    int K;
+    size_t nodes;
+    std::vector<std::vector<int>> adjList; // Not kept for precoloured nodes
+    std::unordered_set<uint64_t> adjSet;
+    std::vector<int> degree;
+    std::vector<double> weight;
+    std::vector<std::vector<int>> moveList; // Moves each node takes part in
+    std::vector<int> alias, color;
+    std::vector<NodeState> state;
+    std::vector<MoveState> moveState;
+    std::set<int> simplifyWorklist, freezeWorklist, spillWorklist;
+    std::set<int> worklistMoves; // By index, which is by weight, heaviest first
+    std::vector<int> selectStack;
+    std::vector<int> moveOrder; // Moves of the graph, heaviest first
+
+    Coalescer(const LiveRanges &r, const InterferenceGraph &g) : ranges(r), graph(g) {
+        K = ANYWHERE.size();
+        nodes = K + r.intervals.size();
+        adjList.resize(nodes);
+        degree.assign(nodes, 0);
+        weight.assign(nodes, 0);
+        moveList.resize(nodes);
+        alias.resize(nodes);
+        color.assign(nodes, -1);
+        state.assign(nodes, Initial);
+        for (int n = 0; n < K; n++) {
+            state[n] = Precolored;
+            color[n] = n;
+            degree[n] = 1 << 30;
+        }
+        for (size_t n = 0; n < nodes; n++) alias[n] = n;
+    }
+
+    bool precolored(int n) const { return n < K; }
+
+    bool adjacentTo(int u, int v) const {
+        return adjSet.count((uint64_t)std::min(u, v) << 32 | std::max(u, v));
+    }
+
+    void addEdge(int u, int v) {
+        if (u == v || !adjSet.insert((uint64_t)std::min(u, v) << 32 | std::max(u, v)).second) return;
+        if (!precolored(u)) {
+            adjList[u].push_back(v);
+            degree[u]++;
+        }
+        if (!precolored(v)) {
+            adjList[v].push_back(u);
+            degree[v]++;
+        }
+    }
+
+    void build() {
+        for (size_t i = 0; i < ranges.intervals.size(); i++) {
+            int n = K + i;
+            weight[n] = ranges.intervals[i].weight;
+            for (int j : graph.adj[i]) addEdge(n, K + j);
+            // Registers the interval may not have interfere with it
+            const auto &allowed = allowedRegisters(ranges.intervals[i]);
+            for (int r = 0; r < K; r++) {
+                if (std::find(allowed.begin(), allowed.end(), ANYWHERE[r]) == allowed.end()) addEdge(n, r);
+            }
+        }
+        moveOrder.resize(graph.moves.size());
+        for (size_t m = 0; m < moveOrder.size(); m++) moveOrder[m] = m;
+        std::stable_sort(moveOrder.begin(), moveOrder.end(),
+                         [&](int a, int b) { return graph.moveWeight[a] > graph.moveWeight[b]; });
+        moveState.assign(graph.moves.size(), WorklistMove);
+        for (size_t k = 0; k < moveOrder.size(); k++) {
+            const auto &move = graph.moves[moveOrder[k]];
+            moveList[K + move.first].push_back(k);
+            moveList[K + move.second].push_back(k);
+            worklistMoves.insert(k);
+        }
+    }
+
+    std::pair<int, int> moveNodes(int k) const {
+        const auto &move = graph.moves[moveOrder[k]];
+        return {K + move.first, K + move.second};
+    }
+
+    template <class F>
+    void forEachAdjacent(int n, F f) const {
+        for (int m : adjList[n]) {
+            if (state[m] != Selected && state[m] != Coalesced) f(m);
+        }
+    }
+
+    template <class F>
+    void forEachNodeMove(int n, F f) const {
+        for (int k : moveList[n]) {
+            if (moveState[k] == ActiveMove || moveState[k] == WorklistMove) f(k);
+        }
+    }
+
+    bool moveRelated(int n) const {
+        bool related = false;
+        forEachNodeMove(n, [&](int) { related = true; });
+        return related;
+    }
+
+    void setState(int n, NodeState s) {
+        if (state[n] == Simplify) simplifyWorklist.erase(n);
+        if (state[n] == Freeze) freezeWorklist.erase(n);
+        if (state[n] == Spill) spillWorklist.erase(n);
+        state[n] = s;
+        if (s == Simplify) simplifyWorklist.insert(n);
+        if (s == Freeze) freezeWorklist.insert(n);
+        if (s == Spill) spillWorklist.insert(n);
+    }
+
+    void makeWorklist() {
+        for (size_t n = K; n < nodes; n++) {
+            if (degree[n] >= K) setState(n, Spill);
+            else if (moveRelated(n)) setState(n, Freeze);
+            else setState(n, Simplify);
+        }
+    }
+
+    void enableMoves(int n) {
+        forEachNodeMove(n, [&](int k) {
+            if (moveState[k] != ActiveMove) return;
+            moveState[k] = WorklistMove;
+            worklistMoves.insert(k);
+        });
+    }
+
+    void decrementDegree(int m) {
+        if (precolored(m)) return;
+        if (degree[m]-- != K) return;
+        enableMoves(m);
+        forEachAdjacent(m, [&](int n) { enableMoves(n); });
+        setState(m, moveRelated(m) ? Freeze : Simplify);
+    }
+
+    void simplify() {
+        int n = *simplifyWorklist.begin();
+        setState(n, Selected);
+        selectStack.push_back(n);
+        forEachAdjacent(n, [&](int m) { decrementDegree(m); });
+    }
+
+    int getAlias(int n) const {
+        while (state[n] == Coalesced) n = alias[n];
+        return n;
+    }
+
+    void addWorklist(int u) {
+        if (!precolored(u) && !moveRelated(u) && degree[u] < K) setState(u, Simplify);
+    }
+
+    // George: every neighbour of v is insignificant or already interferes with u
+    bool george(int u, int v) const {
+        bool ok = true;
+        forEachAdjacent(v, [&](int t) {
+            ok = ok && (degree[t] < K || precolored(t) || adjacentTo(t, u));
+        });
+        return ok;
+    }
+
+    // Briggs: the combined node has fewer than K significant neighbours
+    bool briggs(int u, int v) const {
+        std::unordered_set<int> significant;
+        auto count = [&](int t) {
+            if (degree[t] >= K) significant.insert(t);
+        };
+        forEachAdjacent(u, count);
+        forEachAdjacent(v, count);
+        return (int)significant.size() < K;
+    }
+
+    void combine(int u, int v) {
+        setState(v, Coalesced);
+        alias[v] = u;
+        weight[u] += weight[v];
+        moveList[u].insert(moveList[u].end(), moveList[v].begin(), moveList[v].end());
+        enableMoves(v);
+        forEachAdjacent(v, [&](int t) {
+            addEdge(t, u);
+            decrementDegree(t);
+        });
+        if (degree[u] >= K && state[u] == Freeze) setState(u, Spill);
+    }
+
+    void coalesce() {
+        int k = *worklistMoves.begin();
+        worklistMoves.erase(k);
+        auto [x, y] = moveNodes(k);
+        x = getAlias(x);
+        y = getAlias(y);
+        int u = precolored(y) ? y : x, v = precolored(y) ? x : y;
+        if (u == v) {
+            moveState[k] = CoalescedMove;
+            addWorklist(u);
+        } else if (precolored(v) || adjacentTo(u, v)) {
+            moveState[k] = ConstrainedMove;
+            addWorklist(u);
+            addWorklist(v);
+        } else if (precolored(u) ? george(u, v) : briggs(u, v)) {
+            moveState[k] = CoalescedMove;
+            combine(u, v);
+            addWorklist(u);
+        } else {
+            moveState[k] = ActiveMove;
+        }
+    }
+
+    void freezeMoves(int u) {
+        forEachNodeMove(u, [&](int k) {
+            auto [x, y] = moveNodes(k);
+            int v = getAlias(y) == getAlias(u) ? getAlias(x) : getAlias(y);
+            if (moveState[k] == WorklistMove) worklistMoves.erase(k);
+            moveState[k] = FrozenMove;
+            if (!precolored(v) && state[v] == Freeze && !moveRelated(v) && degree[v] < K) setState(v, Simplify);
+        });
+    }
+
+    void freeze() {
+        int u = *freezeWorklist.begin();
+        setState(u, Simplify);
+        freezeMoves(u);
+    }
+
+    // The cheapest node per neighbour it would take pressure off
+    void selectSpill() {
+        int best = -1;
+        for (int n : spillWorklist) {
+            if (best < 0 || weight[n] / degree[n] < weight[best] / degree[best]) best = n;
+        }
+        setState(best, Simplify);
+        freezeMoves(best);
+    }
+
+    void assignColors(std::vector<int> &spilled) {
+        while (!selectStack.empty()) {
+            int n = selectStack.back();
+            selectStack.pop_back();
+            std::vector<char> ok(K, 1);
+            for (int w : adjList[n]) {
+                int a = getAlias(w);
+                if (state[a] == Colored || state[a] == Precolored) ok[color[a]] = 0;
+            }
+            // Biased colouring: a register a move partner already has
+            int pick = -1;
+            for (int k : moveList[n]) {
+                auto [x, y] = moveNodes(k);
+                int partner = getAlias(x) == n ? getAlias(y) : getAlias(x);
+                if (partner != n && color[partner] >= 0 && ok[color[partner]]) {
+                    pick = color[partner];
+                    break;
+                }
+            }
+            for (int c = 0; pick < 0 && c < K; c++) {
+                if (ok[c]) pick = c;
+            }
+            if (pick < 0) {
+                state[n] = Spilled;
+                spilled.push_back(n - K);
+            } else {
+                state[n] = Colored;
+                color[n] = pick;
+            }
+        }
+        for (size_t n = K; n < nodes; n++) {
+            if (state[n] != Coalesced) continue;
+            int a = getAlias(n);
+            if (state[a] == Spilled) spilled.push_back(n - K);
+            else color[n] = color[a];
+        }
+    }
+
+    Allocation run() {
+        build();
+        makeWorklist();
+        while (true) {
+            if (!simplifyWorklist.empty()) simplify();
+            else if (!worklistMoves.empty()) coalesce();
+            else if (!freezeWorklist.empty()) freeze();
+            else if (!spillWorklist.empty()) selectSpill();
+            else break;
+        }
+        std::vector<int> spilled;
+        assignColors(spilled);
+        Allocation alloc;
+        for (size_t i = 0; i < ranges.intervals.size(); i++) {
+            if (color[K + i] >= 0) alloc.reg[ranges.intervals[i].reg] = ANYWHERE[color[K + i]];
+        }
+        assignSpillSlots(ranges, spilled, alloc);
+        return alloc;
+    }
+};
+
+} // namespace
+
+Allocation allocateIteratedCoalescing(const LiveRanges &ranges) {
+    InterferenceGraph graph = buildInterference(ranges);
+    return Coalescer(ranges, graph).run();
+}
+
+Allocation allocateRegisters(const LiveRanges &ranges, RegisterAllocator allocator) {
+    if (allocator == RegisterAllocator::IteratedCoalescing) return allocateIteratedCoalescing(ranges);
+    return allocateLinearScan(ranges);
+}
+
+AllocationSummary summarizeAllocation(const LiveRanges &ranges, const Allocation &alloc) {
+    AllocationSummary sum;
+    for (const auto &tac : ranges.code) {
+        if (tac.op != "move" || isImmediate(tac.arg1)) continue;
+        sum.moves++;
+        auto src = alloc.reg.find(tac.arg1), dst = alloc.reg.find(tac.result);
+        if (src == alloc.reg.end() || dst == alloc.reg.end() || src->second != dst->second) sum.movesLeft++;
+    }
+    for (const auto &iv : ranges.intervals) {
+        if (alloc.slot.count(iv.reg) || alloc.remat.count(iv.reg)) sum.spillCost += iv.weight;
+    }
+    std::set<std::string> used;
+    for (const auto &[vreg, reg] : alloc.reg) used.insert(reg);
+    sum.spilled = alloc.slot.size();
+    sum.rematerialised = alloc.remat.size();
+    sum.registers = used.size();
+    return sum;
+}
+
+void reportAllocation(const std::string &function, const LiveRanges &ranges, const Allocation &alloc,
+                      Statistics &stats, std::ostream *report) {
+    AllocationSummary sum = summarizeAllocation(ranges, alloc);
+    stats.add("regalloc", function, "intervals", ranges.intervals.size());
+    stats.add("regalloc", function, "registers used", sum.registers);
+    stats.add("regalloc", function, "intervals spilled", sum.spilled);
+    stats.add("regalloc", function, "constants rematerialised", sum.rematerialised);
+    stats.add("regalloc", function, "spill slots", alloc.slots);
+    stats.add("regalloc", function, "callee-saved registers", alloc.calleeSaved.size());
+    stats.add("regalloc", function, "moves coalesced", sum.moves - sum.movesLeft);
+    if (!report) return;
+
+    *report << "    " << function << ": " << ranges.intervals.size() << " intervals in " << sum.registers
+            << " registers, " << sum.spilled << " spilled to " << alloc.slots << " slots, "
+            << sum.rematerialised << " rematerialised, " << sum.movesLeft << " of " << sum.moves
+            << " moves left" << std::endl;
+    for (const auto &iv : ranges.intervals) {
+        auto slot = alloc.slot.find(iv.reg);
+        auto remat = alloc.remat.find(iv.reg);
+        if (slot == alloc.slot.end() && remat == alloc.remat.end()) continue;
+        *report << "        " << iv.reg << ": "
+                << (slot != alloc.slot.end() ? "slot " + std::to_string(slot->second) : "li " + remat->second)
+                << ", cost " << iv.weight << ", live " << iv.start << "-" << iv.end
+                << (iv.crossesCall ? ", across calls" : "") << std::endl;
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "CFG.h"
+#include "Dataflow.h"
+#include "Statistics.h"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Register allocation for the RISC-V backend.
+//
+// The TAC temporaries of a function are virtual registers; the allocator
+// maps each to one of the integer registers below, or spills it to a frame
+// slot. Liveness is solved over the function's flat TAC, numbered from 0,
+// and each temporary gets a single live interval from the first to the last
+// position it is live at, with holes where it is dead (but no splitting):
+//
+// - t0-t4 and a0-a5 are caller-saved, so they only hold intervals that do
+//   not cross a call. a-registers are also kept from intervals overlapping
+//   the incoming `param`s or the outgoing `arg`s, which read and write them;
+// - s1-s11 are callee-saved and can hold anything, at the price of saving
+//   and restoring the ones used in the prologue and epilogue;
+// - t5 and t6 are left for reloading spilled operands and a6 and a7 for
+//   instruction selection's own scratch (jump tables, `&&`, the seventh
+//   argument); zero, ra, sp, gp, tp and s0 are never allocated.
+//
+// A spilled temporary lives in memory for its whole interval: every
+// definition stores it and every use reloads it into a scratch register.
+// One whose only definition is an `li` is rematerialised instead: each use
+// loads the constant again and the definition goes away, so it needs no
+// slot. Spilled intervals that do not overlap share slots.
+//
+// The spill cost of an interval is its uses and definitions, each weighted
+// by 10^(loop depth) of its block, so values used in inner loops keep their
+// registers; rematerialisable ones cost half.
+//
+// Two allocators share this: linear scan over the intervals, fast enough for
+// any build, and iterated register coalescing over the exact interference
+// graph, which -O2 uses to also remove moves.
+
+// Registers scratch code may use around a spilled operand: the first and
+// second source, and the result.
+const char *const SPILL_SCRATCH_1 = "t5";
+const char *const SPILL_SCRATCH_2 = "t6";
+
+struct LiveInterval {
+    std::string reg;          // Virtual register
+    int start = -1, end = -1; // First and last position it is live at
+    double weight = 0;        // Spill cost
+    bool crossesCall = false; // Live across a call, which clobbers t and a registers
+    bool nearArgs = false;    // Live at or written by a param or arg, which use the a registers
+    std::string constant;     // Immediate of its only definition, if that is an `li`
+    // Where it is live, as sorted disjoint [first, last] spans of half
+    // positions: position p reads its operands at 2p and writes its result
+    // at 2p + 1, so a result may take the register of an operand dying there
+    std::vector<std::pair<int, int>> ranges;
+
+    // Whether both are live at the same half position.
+    bool overlaps(const LiveInterval &other) const;
+};
+
+// Liveness of a function's code, shared by the allocators. The CFG copies
+// the code into blocks (labels included, so positions are block start plus
+// index) with edges for the fall-throughs the flat code leaves implicit.
+struct LiveRanges {
+    std::vector<TAC> code;
+    Function cfg;
+    std::vector<int> blockStart;         // Position of each block's first instruction
+    std::vector<int> depth;              // Per block: loop nesting depth
+    Liveness live;                       // At block boundaries
+    std::vector<LiveInterval> intervals; // In order of start
+    std::unordered_map<std::string, int> index; // Virtual register -> interval
+};
+
+// Each function's TAC, from its `function` up to the next one.
+std::vector<std::vector<TAC>> splitFunctions(const std::vector<TAC> &code);
+
+LiveRanges computeLiveRanges(const std::vector<TAC> &code);
+
+// Pairs of virtual registers (by interval) that cannot share a register:
+// each definition interferes with everything live after it but, for a
+// `move`, its source. The result of `&&` and `||` is written before their
+// second operand is read, so it interferes with that too.
+struct InterferenceGraph {
+    std::vector<std::vector<int>> adj;
+    std::vector<std::pair<int, int>> moves; // (destination, source) of each `move` between registers
+    std::vector<double> moveWeight;         // 10^(loop depth) of each move
+    size_t edges = 0;
+};
+
+InterferenceGraph buildInterference(const LiveRanges &ranges);
+
+// Physical registers an interval may be given, in order of preference.
+const std::vector<std::string> &allowedRegisters(const LiveInterval &interval);
+
+// Where the allocator put each virtual register.
+struct Allocation {
+    std::unordered_map<std::string, std::string> reg;   // -> physical register
+    std::unordered_map<std::string, int> slot;          // Spilled -> spill slot
+    std::unordered_map<std::string, std::string> remat; // Spilled -> constant to reload
+    std::vector<std::string> calleeSaved;               // s registers to save, in order
+    int slots = 0;                                      // Spill slots used
+};
+
+// Completes an allocation once every interval not in `spilled` has a
+// register: rematerialises or gives slots to the spilled ones and collects
+// the callee-saved registers used.
+void assignSpillSlots(const LiveRanges &ranges, const std::vector<int> &spilled, Allocation &alloc);
+
+// Poletto and Sarkar's linear scan over the intervals in order of start,
+// with Traub's lifetime holes: a register is free for an interval if those
+// holding it are in holes wherever the interval is live. When no allowed
+// register is free, the ones holding the register cheapest to free are
+// spilled if their total cost is below the interval's; otherwise the
+// interval itself is.
+Allocation allocateLinearScan(const LiveRanges &ranges);
+
+// Appel and George's iterated register coalescing: simplify, coalesce
+// (Briggs' test between virtual registers, George's against physical ones),
+// freeze and spill over the interference graph, then colour in reverse,
+// preferring a register a move partner already has. Physical registers are
+// precoloured nodes that intervals crossing calls or near args interfere
+// with. Spilled nodes keep no register, so there is nothing to rewrite and
+// no second round.
+Allocation allocateIteratedCoalescing(const LiveRanges &ranges);
+
+enum class RegisterAllocator { LinearScan, IteratedCoalescing };
+
+Allocation allocateRegisters(const LiveRanges &ranges, RegisterAllocator allocator);
+
+// What an allocation left behind, for reports and comparisons.
+struct AllocationSummary {
+    long moves = 0;         // `move`s between registers
+    long movesLeft = 0;     // ... whose ends did not get the same register
+    long spilled = 0;       // Intervals given a slot
+    long rematerialised = 0;
+    long registers = 0;     // Physical registers used
+    double spillCost = 0;   // Of the spilled and rematerialised intervals
+};
+
+AllocationSummary summarizeAllocation(const LiveRanges &ranges, const Allocation &alloc);
+
+// Records the allocation under "regalloc" in the statistics and, with a
+// report stream, lists the function's spills there.
+void reportAllocation(const std::string &function, const LiveRanges &ranges, const Allocation &alloc,
+                      Statistics &stats, std::ostream *report);
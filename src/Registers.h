@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CFG.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Dense numbering of a function's registers, for passes that keep
+// per-register arrays. Temporaries tN whose N falls in the window spanned by
+// the function's own temporaries are looked up through a table instead of
+// being hashed; the window is only used when it is no larger than a small
+// multiple of the function, so numbering stays linear in its size. Names
+// created after construction are simply hashed.
+class RegisterNumbering {
+    private:
+        long base = 0;
+        std::vector<int> window; // N - base -> id, or -1
+        std::unordered_map<std::string, int> others;
+        std::vector<std::string> names;
+
+    public:
+        RegisterNumbering(const Function &fn) {
+            long lo = -1, hi = -1;
+            size_t instrs = 0;
+            for (const auto &bb : fn.blocks) {
+                for (const auto &tac : bb.code) {
+                    instrs++;
+                    for (const std::string *s : {&tac.arg1, &tac.arg2, &tac.result}) {
+                        long t = tempNumber(*s);
+                        if (t < 0) continue;
+                        if (lo < 0 || t < lo) lo = t;
+                        if (t > hi) hi = t;
+                    }
+                }
+            }
+            if (lo >= 0 && (size_t)(hi - lo) < 4 * instrs + 64) {
+                base = lo;
+                window.assign(hi - lo + 1, -1);
+            }
+        }
+
+        // Id of `name`, numbering it if it is new.
+        int id(const std::string &name) {
+            long t = tempNumber(name) - base;
+            if (t >= 0 && t < (long)window.size()) {
+                if (window[t] < 0) {
+                    window[t] = names.size();
+                    names.push_back(name);
+                }
+                return window[t];
+            }
+            auto it = others.emplace(name, names.size());
+            if (it.second) names.push_back(name);
+            return it.first->second;
+        }
+
+        // Id of `name`, or -1 if it has not been numbered.
+        int find(const std::string &name) const {
+            long t = tempNumber(name) - base;
+            if (t >= 0 && t < (long)window.size()) return window[t];
+            auto it = others.find(name);
+            return it == others.end() ? -1 : it->second;
+        }
+
+        const std::string &name(int id) const { return names[id]; }
+        size_t size() const { return names.size(); }
+};
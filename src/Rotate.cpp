@@ -0,0 +1,63 @@
+#include "Rotate.h"
+#include "Loops.h"
+
+// Largest header copied, in instructions.
+static const size_t MAX_HEADER = 16;
+
+void rotateLoops(Module &module, Function &fn, Statistics &stats) {
+    if (fn.ssa) return; // The copied header defines its registers again
+    DominatorTree dt = computeDominators(fn);
+    if (findLoops(fn, dt).loops.empty()) return;
+    insertPreheaders(module, fn);
+    dt = computeDominators(fn);
+    LoopInfo info = findLoops(fn, dt);
+
+    // A header is never the preheader or a latch of another loop, as those
+    // end in a plain jump, so each rotation only edits blocks no other one
+    // reads
+    long rotated = 0, copied = 0;
+    for (const auto &loop : info.loops) {
+        int pre = findPreheader(fn, loop);
+        const auto &header = fn.blocks[loop.header].code;
+        size_t size = header.size();
+        if (pre < 0 || size < 2 || size > MAX_HEADER || !isCondBranch(header[size - 2].op) ||
+            header.back().op != "jmp") {
+            continue;
+        }
+        bool exitOnTrue = !loop.contains(fn.findBlock(branchTarget(header[size - 2])));
+        if (exitOnTrue == !loop.contains(fn.findBlock(header.back().result))) continue;
+        bool plain = true;
+        for (int l : loop.latches) {
+            const auto &code = fn.blocks[l].code;
+            plain &= l != loop.header && code.back().op == "jmp" && (code.size() < 2 || !isCondBranch(code[code.size() - 2].op));
+        }
+        if (!plain) continue;
+
+        auto &preCode = fn.blocks[pre].code;
+        preCode.pop_back();
+        preCode.insert(preCode.end(), header.begin(), header.end());
+
+        // At the bottom the conditional branch is the back edge
+        std::vector<TAC> bottom = header;
+        if (exitOnTrue) {
+            TAC &branch = bottom[size - 2];
+            std::string out = branchTarget(branch);
+            branch.op = invertBranch(branch.op);
+            setBranchTarget(branch, bottom.back().result);
+            bottom.back().result = out;
+        }
+        for (int l : loop.latches) {
+            auto &code = fn.blocks[l].code;
+            code.pop_back();
+            code.insert(code.end(), bottom.begin(), bottom.end());
+        }
+        rotated++;
+        copied += size * loop.latches.size();
+    }
+    if (!rotated) return;
+    fn.recomputeEdges();
+    removeUnreachableBlocks(fn);
+
+    stats.add("rotate", fn.name, "loops rotated", rotated);
+    stats.add("rotate", fn.name, "instructions copied", copied);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Loop rotation, before SSA construction: a loop testing its condition in
+// the header,
+//
+//     header: cond; beqz exit; jmp body   ...   latch: jmp header
+//
+// becomes a guard in the preheader and a test at the bottom,
+//
+//     preheader: cond; beqz exit; jmp body   ...   latch: cond; bnez body; jmp exit
+//
+// so each iteration runs one conditional branch, the back edge, instead of
+// a jump back and a branch out. The header is copied into the preheader and
+// into every latch, with the latch copies inverted to branch back; the
+// original header is then unreachable. The copies run exactly as often, in
+// the same order, as the header did, so calls in the condition are fine.
+// Registers the header defines get several definitions, which SSA
+// construction merges.
+//
+// Loops are rotated when the header leaves the loop on one edge and stays on
+// the other, every latch ends in a plain jump back, and the header holds at
+// most 16 instructions, bounding the code copied.
+void rotateLoops(Module &module, Function &fn, Statistics &stats);
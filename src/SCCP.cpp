@@ -0,0 +1,215 @@
+#include "SCCP.h"
+#include "ConstLattice.h"
+#include <algorithm>
+
+namespace {
+
+size_t countInstructions(const Function &fn) {
+    size_t count = 0;
+    for (const auto &bb : fn.blocks) count += bb.code.size();
+    return count;
+}
+
+} // namespace
+
+void propagateConditionalConstants(Module &module, Function &fn, Statistics &stats) {
+    (void)module;
+    size_t n = fn.blocks.size();
+    size_t instrsBefore = countInstructions(fn);
+    ConstCode cc(fn);
+    const auto &code = cc.code;
+    size_t nregs = cc.regs.size(), nphis = cc.phis.size();
+
+    std::vector<ConstValue> regVal(nregs), phiVal(nphis);
+    auto value = [&](int src) {
+        if (src >= 0) return regVal[src];
+        if (src == ConstInstr::ZERO) return ConstValue::constant(0);
+        if (src == ConstInstr::VARYING) return ConstValue::varying();
+        return phiVal[ConstInstr::VAR_PHI - src];
+    };
+
+    // The SSA edges: what reads each register and variable phi. Readers are
+    // instructions, numbered block by block, then variable phis
+    std::vector<size_t> first(n + 1, 0); // Number of each block's first instruction
+    for (size_t b = 0; b < n; b++) first[b + 1] = first[b] + code[b].size();
+    size_t ninstrs = first[n];
+    std::vector<int> blockOf(ninstrs);
+    std::vector<std::vector<int>> users(nregs + nphis);
+    auto addUse = [&](int src, int user) {
+        if (src >= 0) users[src].push_back(user);
+        else if (src <= ConstInstr::VAR_PHI) users[nregs + ConstInstr::VAR_PHI - src].push_back(user);
+    };
+    for (size_t b = 0; b < n; b++) {
+        for (size_t i = 0; i < code[b].size(); i++) {
+            const auto &d = code[b][i];
+            int id = first[b] + i;
+            blockOf[id] = b;
+            if (d.kind == ConstInstr::Load) {
+                addUse(d.src, id);
+            } else if (d.kind == ConstInstr::Phi) {
+                for (const auto &[k, r] : d.incoming) addUse(r, id);
+            } else if (d.kind == ConstInstr::Compute || d.kind == ConstInstr::Branch || d.kind == ConstInstr::Table) {
+                addUse(d.a, id);
+                addUse(d.b, id);
+            }
+        }
+    }
+    for (size_t k = 0; k < nphis; k++) {
+        for (const auto &[pred, src] : cc.phis[k].incoming) addUse(src, ninstrs + k);
+    }
+
+    // The CFG edges: executable ones, kept per block parallel to its preds.
+    // A block is evaluated in full the first time an edge reaches it, and
+    // only its phis when another edge does
+    std::vector<std::vector<char>> execIn(n);
+    for (size_t b = 0; b < n; b++) execIn[b].assign(fn.blocks[b].preds.size(), 0);
+    std::vector<char> reached(n, 0);
+    std::vector<int> flowWork = {0}; // Blocks entered by a newly executable edge
+    std::vector<int> ssaWork;        // Registers and variable phis whose value dropped
+    auto markEdge = [&](int p, int s) {
+        int k = s < 0 ? -1 : cc.edgeIndex(p, s);
+        if (k < 0 || execIn[s][k]) return;
+        execIn[s][k] = 1;
+        flowWork.push_back(s);
+    };
+    auto lower = [&](size_t node, const ConstValue &v) {
+        ConstValue &val = node < nregs ? regVal[node] : phiVal[node - nregs];
+        if (val.meet(v)) ssaWork.push_back(node);
+    };
+
+    auto visitPhi = [&](int k) {
+        const auto &phi = cc.phis[k];
+        ConstValue result;
+        for (const auto &[pred, src] : phi.incoming) {
+            if (execIn[phi.block][pred]) result.meet(value(src));
+        }
+        lower(nregs + k, result);
+    };
+    auto visit = [&](int b, size_t i) {
+        const auto &instrs = code[b];
+        const auto &d = instrs[i];
+        ConstValue result = ConstValue::varying();
+        switch (d.kind) {
+            case ConstInstr::Li: result = ConstValue::constant(d.imm); break;
+            case ConstInstr::Load: result = value(d.src); break;
+            case ConstInstr::Compute:
+                result = foldConstants(d.eval, value(d.a), d.b == -1 ? ConstValue() : value(d.b));
+                break;
+            case ConstInstr::Phi:
+                result = ConstValue();
+                for (const auto &[k, r] : d.incoming) {
+                    if (execIn[b][k]) result.meet(value(r));
+                }
+                break;
+            case ConstInstr::Branch: {
+                // A conditional branch is always followed by the jmp to its
+                // other successor
+                ConstValue cond = foldConstants(d.eval, value(d.a), d.b == -1 ? ConstValue::constant(0) : value(d.b));
+                int fallthrough = i + 1 < instrs.size() ? instrs[i + 1].target : -1;
+                if (!cond.isConst() || cond.value) markEdge(b, d.target);
+                if (!cond.isConst() || !cond.value) markEdge(b, fallthrough);
+                break;
+            }
+            case ConstInstr::Jmp: markEdge(b, d.target); break;
+            case ConstInstr::Table: {
+                ConstValue index = value(d.a);
+                for (size_t k = 0; k < d.targets.size(); k++) {
+                    if (!index.isConst() || index.value == (int64_t)k) markEdge(b, d.targets[k]);
+                }
+                break;
+            }
+            default: break;
+        }
+        if (d.def < 0) return;
+        if (cc.defCount[d.def] > 1) result = ConstValue::varying();
+        lower(d.def, result);
+    };
+
+    while (!flowWork.empty() || !ssaWork.empty()) {
+        if (!flowWork.empty()) {
+            int b = flowWork.back();
+            flowWork.pop_back();
+            bool entered = reached[b];
+            reached[b] = 1;
+            for (int k : cc.phisAt[b]) visitPhi(k);
+            const auto &instrs = code[b];
+            for (size_t i = 0; i < instrs.size(); i++) {
+                if (entered && instrs[i].kind != ConstInstr::Phi) break;
+                visit(b, i);
+                if (instrs[i].kind == ConstInstr::Branch) i++;
+            }
+            continue;
+        }
+        size_t x = ssaWork.back();
+        ssaWork.pop_back();
+        for (int u : users[x]) {
+            if ((size_t)u >= ninstrs) {
+                if (reached[cc.phis[u - ninstrs].block]) visitPhi(u - ninstrs);
+            } else if (reached[blockOf[u]]) {
+                visit(blockOf[u], u - first[blockOf[u]]);
+            }
+        }
+    }
+
+    // Constant values become `li` and constant branches a `jmp`
+    long branches = 0;
+    for (size_t b = 0; b < n; b++) {
+        if (!reached[b]) continue;
+        auto &body = fn.blocks[b].code;
+        std::vector<TAC> out;
+        for (size_t i = 0; i < body.size(); i++) {
+            const auto &d = code[b][i];
+            if (d.def >= 0 && regVal[d.def].isConst() &&
+                (d.kind == ConstInstr::Compute || d.kind == ConstInstr::Load || d.kind == ConstInstr::Phi)) {
+                out.push_back(TAC("li", std::to_string(regVal[d.def].value), "", body[i].result));
+                continue;
+            }
+            if (d.kind == ConstInstr::Table && value(d.a).isConst()) {
+                int64_t index = value(d.a).value;
+                if (index >= 0 && index < (int64_t)body[i].targets.size()) {
+                    out.push_back(TAC("jmp", "", "", body[i].targets[index]));
+                    branches++;
+                    continue;
+                }
+            }
+            if (d.kind == ConstInstr::Branch && i + 1 < body.size()) {
+                ConstValue cond = foldConstants(d.eval, value(d.a), d.b == -1 ? ConstValue::constant(0) : value(d.b));
+                if (cond.isConst()) {
+                    std::string taken = cond.value ? branchTarget(body[i]) : body[i + 1].result;
+                    out.push_back(TAC("jmp", "", "", taken));
+                    branches++;
+                    i++;
+                    continue;
+                }
+            }
+            out.push_back(std::move(body[i]));
+        }
+        body = std::move(out);
+    }
+
+    fn.recomputeEdges();
+    long blocks = removeUnreachableBlocks(fn);
+
+    // Phis lose the operands of edges that are gone; one left means a copy
+    for (auto &bb : fn.blocks) {
+        for (auto &tac : bb.code) {
+            if (tac.op != "phi") continue;
+            auto &args = tac.phiArgs;
+            args.erase(std::remove_if(args.begin(), args.end(), [&](const auto &arg) {
+                           return std::none_of(bb.preds.begin(), bb.preds.end(),
+                                               [&](int p) { return fn.blocks[p].label == arg.first; });
+                       }),
+                       args.end());
+            if (args.size() == 1) {
+                std::string v = args[0].second;
+                tac = TAC(isImmediate(v) ? "li" : "move", v, "", tac.result);
+            }
+        }
+        std::stable_partition(bb.code.begin(), bb.code.end(), [](const TAC &tac) { return tac.op == "phi"; });
+    }
+    removeDeadConstants(fn);
+
+    stats.add("sccp", fn.name, "branches folded", branches);
+    stats.add("sccp", fn.name, "blocks removed", blocks);
+    stats.add("sccp", fn.name, "instructions removed", (long)instrsBefore - (long)countInstructions(fn));
+}
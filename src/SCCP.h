@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Sparse conditional constant propagation (Wegman and Zadeck) over a
+// function in SSA form.
+//
+// Values and control flow are solved together: a block is only evaluated
+// once an executable edge reaches it, a branch whose condition is constant
+// only makes its taken edge executable, and phis and stack variables merge
+// over executable edges alone. Constants that only hold because some path
+// is never taken, like `a > 2 ? 1 : 0` with `a` known, are found this way
+// where propagateConstants() must give up.
+//
+// Two worklists drive it: CFG edges newly found executable, whose target is
+// evaluated in full the first time and only for its phis after that, and
+// SSA edges from a register or variable phi whose value dropped to the
+// instructions reading it. Each instruction is revisited only when one of
+// its inputs changes. Variables are linked from loads to stores as
+// described in ConstLattice.h.
+//
+// Afterwards constant values become `li`, constant branches become `jmp`,
+// and the blocks no executable edge reaches are deleted.
+void propagateConditionalConstants(Module &module, Function &fn, Statistics &stats);
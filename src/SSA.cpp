@@ -0,0 +1,202 @@
+#include "SSA.h"
+#include "Dominators.h"
+#include "Registers.h"
+#include <unordered_map>
+
+void constructSSA(Module &module, Function &fn, Statistics &stats) {
+    removeUnreachableBlocks(fn);
+    fn.ssa = true;
+    size_t n = fn.blocks.size();
+    RegisterNumbering regs(fn);
+
+    // Registers written more than once, numbered densely, and the blocks
+    // writing them
+    std::vector<int> defCount, multiIndex;
+    std::vector<std::vector<int>> defBlocks;
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &tac : fn.blocks[b].code) {
+            if (tacDef(tac).empty()) continue;
+            size_t r = regs.id(tac.result);
+            if (r >= defCount.size()) {
+                defCount.resize(r + 1, 0);
+                defBlocks.resize(r + 1);
+            }
+            defCount[r]++;
+            if (defBlocks[r].empty() || defBlocks[r].back() != (int)b) defBlocks[r].push_back(b);
+        }
+    }
+    std::vector<int> multi;
+    multiIndex.assign(defCount.size(), -1);
+    for (size_t r = 0; r < defCount.size(); r++) {
+        if (defCount[r] > 1) {
+            multiIndex[r] = multi.size();
+            multi.push_back(r);
+        }
+    }
+    auto multiOf = [&](const std::string &name) {
+        int r = regs.find(name);
+        return r >= 0 && (size_t)r < multiIndex.size() ? multiIndex[r] : -1;
+    };
+    if (multi.empty()) {
+        stats.add("ssa", fn.name, "phis inserted", 0);
+        return;
+    }
+
+    // Blocks reading each renamed register before writing it
+    std::vector<std::vector<int>> exposedIn(multi.size());
+    std::vector<int> definedIn(multi.size(), -1), exposedMark(multi.size(), -1);
+    for (size_t b = 0; b < n; b++) {
+        for (const auto &tac : fn.blocks[b].code) {
+            forEachUse(tac, [&](const std::string &u) {
+                int m = multiOf(u);
+                if (m < 0 || definedIn[m] == (int)b || exposedMark[m] == (int)b) return;
+                exposedMark[m] = b;
+                exposedIn[m].push_back(b);
+            });
+            int m = tacDef(tac).empty() ? -1 : multiOf(tac.result);
+            if (m >= 0) definedIn[m] = b;
+        }
+    }
+
+    // Phis at the iterated dominance frontier of the definitions, restricted
+    // to the blocks where the register is live on entry
+    DominatorTree dt = computeDominators(fn);
+    auto df = dominanceFrontiers(fn, dt);
+    std::vector<std::vector<int>> phisAt(n); // Renamed register of each phi, in block order
+    std::vector<int> liveMark(n, -1), defMark(n, -1), phiMark(n, -1), queued(n, -1);
+    std::vector<int> work;
+    size_t inserted = 0;
+    for (size_t m = 0; m < multi.size(); m++) {
+        const auto &defs = defBlocks[multi[m]];
+        for (int b : defs) defMark[b] = m;
+
+        work.clear();
+        for (int b : exposedIn[m]) {
+            liveMark[b] = m;
+            work.push_back(b);
+        }
+        while (!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            for (int p : fn.blocks[b].preds) {
+                if (liveMark[p] == (int)m || defMark[p] == (int)m) continue;
+                liveMark[p] = m;
+                work.push_back(p);
+            }
+        }
+
+        work.assign(defs.begin(), defs.end());
+        for (int b : defs) queued[b] = m;
+        while (!work.empty()) {
+            int x = work.back();
+            work.pop_back();
+            for (int y : df[x]) {
+                if (phiMark[y] == (int)m || liveMark[y] != (int)m) continue;
+                phiMark[y] = m;
+                phisAt[y].push_back(m);
+                inserted++;
+                if (queued[y] != (int)m) {
+                    queued[y] = m;
+                    work.push_back(y);
+                }
+            }
+        }
+    }
+    for (size_t b = 0; b < n; b++) {
+        auto &code = fn.blocks[b].code;
+        code.insert(code.begin(), phisAt[b].size(), TAC("phi", "", "", ""));
+    }
+
+    // Rename along the dominator tree: each definition pushes its new name,
+    // which the uses it dominates and the phi operands on its outgoing edges
+    // read, and is popped again on the way back up
+    std::vector<std::vector<std::string>> names(multi.size());
+    std::vector<char> keptOriginal(multi.size(), 0);
+    std::vector<int> pushed;
+    auto define = [&](int m, std::string &result) {
+        // The first definition reached keeps the register's own name
+        if (keptOriginal[m]) result = module.newTemp();
+        keptOriginal[m] = 1;
+        names[m].push_back(result);
+        pushed.push_back(m);
+    };
+
+    struct Frame {
+        int block;
+        size_t child;
+        size_t mark; // Size of `pushed` on entry
+    };
+    std::vector<Frame> stack;
+    auto enter = [&](int b) {
+        stack.push_back({b, 0, pushed.size()});
+        auto &code = fn.blocks[b].code;
+        size_t phis = phisAt[b].size();
+        for (size_t k = 0; k < phis; k++) {
+            int m = phisAt[b][k];
+            code[k].result = regs.name(multi[m]);
+            define(m, code[k].result);
+        }
+        for (size_t i = phis; i < code.size(); i++) {
+            forEachUse(code[i], [&](std::string &u) {
+                int m = multiOf(u);
+                if (m >= 0 && !names[m].empty()) u = names[m].back();
+            });
+            int m = tacDef(code[i]).empty() ? -1 : multiOf(code[i].result);
+            if (m >= 0) define(m, code[i].result);
+        }
+        for (int s : fn.blocks[b].succs) {
+            auto &succCode = fn.blocks[s].code;
+            for (size_t k = 0; k < phisAt[s].size(); k++) {
+                const auto &top = names[phisAt[s][k]];
+                succCode[k].phiArgs.push_back({fn.blocks[b].label, top.empty() ? "0" : top.back()});
+            }
+        }
+    };
+    enter(0);
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        if (top.child < dt.children[top.block].size()) {
+            enter(dt.children[top.block][top.child++]);
+            continue;
+        }
+        while (pushed.size() > top.mark) {
+            names[pushed.back()].pop_back();
+            pushed.pop_back();
+        }
+        stack.pop_back();
+    }
+
+    stats.add("ssa", fn.name, "phis inserted", inserted);
+}
+
+void destructSSA(Module &module, Function &fn, Statistics &stats) {
+    fn.ssa = false;
+    std::unordered_map<std::string, int> index;
+    for (size_t b = 0; b < fn.blocks.size(); b++) index[fn.blocks[b].label] = b;
+
+    std::vector<std::vector<TAC>> copies(fn.blocks.size()); // To append to each block
+    size_t inserted = 0;
+    for (auto &bb : fn.blocks) {
+        for (auto &tac : bb.code) {
+            if (tac.op != "phi") break;
+            std::string incoming = module.newTemp();
+            for (const auto &[label, value] : tac.phiArgs) {
+                copies[index.at(label)].push_back(TAC(isImmediate(value) ? "li" : "move", value, "", incoming));
+                inserted++;
+            }
+            tac = TAC("move", incoming, "", tac.result);
+        }
+    }
+
+    // Copies go before the block's closing branches
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        if (copies[b].empty()) continue;
+        auto &code = fn.blocks[b].code;
+        size_t at = code.size();
+        if (at && isTerminator(code[at - 1])) at--;
+        if (at && isCondBranch(code[at - 1].op)) at--;
+        code.insert(code.begin() + at, copies[b].begin(), copies[b].end());
+    }
+
+    stats.add("out-of-ssa", fn.name, "copies inserted", inserted);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Conversion of a function's registers into and out of SSA form.
+//
+// Every register defined more than once is renamed: the registers
+// promoteVariables() gave the function's variables and parameters, and the
+// join values of `?:` and `&&`/`||`, written on both arms. Phis go at the
+// iterated dominance frontier of their definitions, pruned to the blocks
+// where the register is live, and every definition after the first gets a
+// fresh temporary. Only with -fno-promote do variables stay in memory, out
+// of SSA's reach.
+//
+// destructSSA() replaces each phi `x = phi [P: v] ...` with a copy `x = x'`
+// and a `x' = v` at the end of every predecessor P. The fresh x' is only
+// read by that copy, so copies on critical edges are harmless and parallel
+// phis cannot overwrite each other's operands.
+
+void constructSSA(Module &module, Function &fn, Statistics &stats);
+void destructSSA(Module &module, Function &fn, Statistics &stats);
@@ -0,0 +1,419 @@
+#include "ScalarEvolution.h"
+#include <algorithm>
+
+static int64_t wrapAdd(int64_t a, int64_t b) { return (int64_t)((uint64_t)a + (uint64_t)b); }
+static int64_t wrapMul(int64_t a, int64_t b) { return (int64_t)((uint64_t)a * (uint64_t)b); }
+
+bool addLinear(const LinearValue &a, const LinearValue &b, int64_t k, LinearValue &out) {
+    if (!a.isConstant() && !b.isConstant() && a.base != b.base) return false;
+    out.base = a.isConstant() ? b.base : a.base;
+    out.scale = wrapAdd(a.scale, wrapMul(k, b.scale));
+    out.offset = wrapAdd(a.offset, wrapMul(k, b.offset));
+    if (out.scale == 0) out.base.clear();
+    return true;
+}
+
+std::string materialize(Module &module, const LinearValue &v, std::vector<TAC> &code) {
+    auto constant = [&](int64_t c) {
+        std::string t = module.newTemp();
+        code.push_back(TAC("li", std::to_string(c), "", t));
+        return t;
+    };
+    if (v.isConstant()) return constant(v.offset);
+    std::string r = v.base;
+    if (v.scale != 1) {
+        std::string t = module.newTemp();
+        code.push_back(TAC("*", r, constant(v.scale), t));
+        r = t;
+    }
+    if (v.offset) {
+        std::string t = module.newTemp();
+        code.push_back(TAC("+", r, constant(v.offset), t));
+        r = t;
+    }
+    return r;
+}
+
+static LinearValue scaleLinear(const LinearValue &a, int64_t k) {
+    LinearValue out{a.base, wrapMul(a.scale, k), wrapMul(a.offset, k)};
+    if (out.scale == 0) out.base.clear();
+    return out;
+}
+
+ScalarEvolution::ScalarEvolution(const Function &fn, const LoopInfo &info) : fn(fn), info(info), cache(info.loops.size()) {
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        labels[fn.blocks[b].label] = b;
+        const auto &code = fn.blocks[b].code;
+        for (size_t i = 0; i < code.size(); i++) {
+            if (!tacDef(code[i]).empty()) defs[code[i].result] = {(int)b, (int)i};
+        }
+    }
+}
+
+const TAC *ScalarEvolution::definition(const std::string &reg) const {
+    auto it = defs.find(reg);
+    return it == defs.end() ? nullptr : &fn.blocks[it->second.first].code[it->second.second];
+}
+
+int ScalarEvolution::block(const std::string &label) const {
+    auto it = labels.find(label);
+    return it == labels.end() ? -1 : it->second;
+}
+
+int ScalarEvolution::definingBlock(const std::string &reg) const {
+    auto it = defs.find(reg);
+    return it == defs.end() ? -1 : it->second.first;
+}
+
+// Evaluation recurses through operands; past this depth a value counts as
+// unknown rather than risk the stack on long dependence chains.
+static const int MAX_DEPTH = 64;
+// Recurrences of higher order count as unknown.
+static const int MAX_ORDER = 3;
+
+static bool isZero(const LinearValue &v) { return v.isConstant() && v.offset == 0; }
+
+static void trim(Chrec &rec) {
+    while (rec.coeffs.size() > 1 && isZero(rec.coeffs.back())) rec.coeffs.pop_back();
+}
+
+static bool allConstant(const Chrec &rec) {
+    for (const auto &c : rec.coeffs) {
+        if (!c.isConstant()) return false;
+    }
+    return true;
+}
+
+// a + k*b, coefficient by coefficient.
+static bool addChrec(const Chrec &a, const Chrec &b, int64_t k, Chrec &out) {
+    Chrec sum;
+    sum.coeffs.resize(std::max(a.coeffs.size(), b.coeffs.size()), LinearValue::constant(0));
+    for (size_t j = 0; j < sum.coeffs.size(); j++) {
+        LinearValue x = j < a.coeffs.size() ? a.coeffs[j] : LinearValue::constant(0);
+        LinearValue y = j < b.coeffs.size() ? b.coeffs[j] : LinearValue::constant(0);
+        if (!addLinear(x, y, k, sum.coeffs[j])) return false;
+    }
+    trim(sum);
+    out = std::move(sum);
+    return true;
+}
+
+// The value on iteration n of a recurrence with constant coefficients, for
+// small n, where the binomials stay exact.
+static int64_t valueAt(const Chrec &rec, int n) {
+    int64_t v = 0, binomial = 1;
+    for (int j = 0; j < (int)rec.coeffs.size() && j <= n; j++) {
+        v = wrapAdd(v, wrapMul(rec.coeffs[j].offset, binomial));
+        binomial = binomial * (n - j) / (j + 1);
+    }
+    return v;
+}
+
+// a*b when one is an invariant and the other's coefficients are constant,
+// or both recurrences have constant coefficients. A product of order m and
+// n recurrences has order m + n; its coefficients are the forward
+// differences of its first m + n + 1 values.
+static bool multiplyChrec(const Chrec &a, const Chrec &b, Chrec &out) {
+    Chrec product;
+    if (a.order() == 0 || b.order() == 0) {
+        const Chrec &inv = a.order() == 0 ? a : b, &other = a.order() == 0 ? b : a;
+        const LinearValue &k = inv.coeffs[0];
+        if (!k.isConstant() && !allConstant(other)) return false;
+        for (const auto &c : other.coeffs) {
+            product.coeffs.push_back(k.isConstant() ? scaleLinear(c, k.offset) : scaleLinear(k, c.offset));
+        }
+    } else {
+        int order = a.order() + b.order();
+        if (order > MAX_ORDER || !allConstant(a) || !allConstant(b)) return false;
+        std::vector<int64_t> values;
+        for (int n = 0; n <= order; n++) values.push_back(wrapMul(valueAt(a, n), valueAt(b, n)));
+        for (int j = 0; j <= order; j++) {
+            product.coeffs.push_back(LinearValue::constant(values[0]));
+            for (size_t n = 0; n + 1 < values.size(); n++) values[n] = wrapAdd(values[n + 1], wrapMul(-1, values[n]));
+            values.pop_back();
+        }
+    }
+    trim(product);
+    out = std::move(product);
+    return true;
+}
+
+ScalarEvolution::Value ScalarEvolution::evaluate(const std::string &reg, int loop, int depth) {
+    Value v;
+    if (isImmediate(reg)) {
+        v.known = true;
+        v.rec.coeffs = {LinearValue::constant(std::stoll(reg))};
+        return v;
+    }
+    auto cached = cache[loop].find(reg);
+    if (cached != cache[loop].end()) return cached->second;
+    auto def = defs.find(reg);
+    if (def == defs.end() || depth > MAX_DEPTH) return v;
+    const TAC &tac = fn.blocks[def->second.first].code[def->second.second];
+
+    if (tac.op == "li") {
+        v.known = true;
+        v.rec.coeffs = {LinearValue::constant(std::stoll(tac.arg1))};
+    } else if (!info.loops[loop].contains(def->second.first)) {
+        v.known = true;
+        v.rec.coeffs = {LinearValue{reg, 1, 0}};
+    } else if (tac.op == "move") {
+        v = evaluate(tac.arg1, loop, depth + 1);
+    } else if (tac.op == "phi") {
+        if (def->second.first == info.loops[loop].header) {
+            // The phi stands for itself while its own operands are examined
+            Value self;
+            self.known = true;
+            self.self = reg;
+            self.rec.coeffs = {LinearValue::constant(0)};
+            cache[loop][reg] = self;
+            size_t mark = provisional.size();
+            analysing++;
+            v = evaluatePhi(tac, loop, depth);
+            analysing--;
+            for (size_t i = mark; i < provisional.size(); i++) cache[provisional[i].first].erase(provisional[i].second);
+            provisional.resize(mark);
+        }
+    } else if (tac.op == "+" || tac.op == "-") {
+        Value a = evaluate(tac.arg1, loop, depth + 1), b = evaluate(tac.arg2, loop, depth + 1);
+        int64_t sign = tac.op == "+" ? 1 : -1;
+        // The phi under analysis may appear once, positively
+        bool selfOk = b.self.empty() || (sign == 1 && a.self.empty()) || (sign == -1 && a.self == b.self);
+        if (a.known && b.known && selfOk && addChrec(a.rec, b.rec, sign, v.rec)) {
+            v.known = true;
+            v.self = b.self.empty() ? a.self : sign == 1 ? b.self : "";
+        }
+    } else if (tac.op == "*" || tac.op == "<<" || tac.op == "NEG") {
+        Value a = evaluate(tac.arg1, loop, depth + 1), b;
+        b.known = true;
+        b.rec.coeffs = {LinearValue::constant(-1)};
+        if (tac.op != "NEG") b = evaluate(tac.arg2, loop, depth + 1);
+        if (tac.op == "*" && !b.self.empty()) std::swap(a, b);
+        bool constant = b.known && b.rec.order() == 0 && b.rec.coeffs[0].isConstant();
+        if (tac.op == "<<") {
+            if (constant) b.rec.coeffs[0].offset = (int64_t)((uint64_t)1 << (b.rec.coeffs[0].offset & 63));
+            b.known = constant;
+        }
+        // The phi under analysis is only kept multiplied by 1
+        bool selfOk = b.self.empty() && (a.self.empty() || (constant && b.rec.coeffs[0].offset == 1));
+        if (a.known && b.known && selfOk && multiplyChrec(a.rec, b.rec, v.rec)) {
+            v.known = true;
+            v.self = a.self;
+        }
+    }
+    if (v.rec.order() > MAX_ORDER) v = Value();
+    cache[loop][reg] = v;
+    if (analysing) provisional.push_back({loop, reg});
+    return v;
+}
+
+ScalarEvolution::Value ScalarEvolution::evaluatePhi(const TAC &phi, int loop, int depth) {
+    const Loop &l = info.loops[loop];
+    Value v;
+    std::string initial;
+    bool stepped = false;
+    Chrec step;
+    for (const auto &[label, value] : phi.phiArgs) {
+        int pred = block(label);
+        if (pred < 0) return v;
+        if (!l.contains(pred)) {
+            if (!initial.empty() && initial != value) return v;
+            initial = value;
+            continue;
+        }
+        // Each latch must feed the phi plus the same step
+        Value next = evaluate(value, loop, depth + 1);
+        if (!next.known || next.self != phi.result) return v;
+        Chrec diff;
+        if (stepped && (!addChrec(next.rec, step, -1, diff) || diff.order() != 0 || !isZero(diff.coeffs[0]))) return v;
+        step = next.rec;
+        stepped = true;
+    }
+    if (initial.empty() || !stepped) return v;
+    Value start = evaluate(initial, loop, depth + 1);
+    if (!start.known || !start.self.empty() || start.rec.order() != 0) return v;
+    v.known = true;
+    v.rec.coeffs = {start.rec.coeffs[0]};
+    v.rec.coeffs.insert(v.rec.coeffs.end(), step.coeffs.begin(), step.coeffs.end());
+    trim(v.rec);
+    return v;
+}
+
+bool ScalarEvolution::invariant(const std::string &reg, int loop, LinearValue &value) {
+    Value v = evaluate(reg, loop, 0);
+    if (!v.known || !v.self.empty() || v.rec.order() != 0) return false;
+    value = v.rec.coeffs[0];
+    return true;
+}
+
+bool ScalarEvolution::recurrence(const std::string &reg, int loop, Recurrence &rec) {
+    Value v = evaluate(reg, loop, 0);
+    if (!v.known || !v.self.empty() || v.rec.order() != 1 || !v.rec.coeffs[1].isConstant()) return false;
+    rec.start = v.rec.coeffs[0];
+    rec.step = v.rec.coeffs[1].offset;
+    return true;
+}
+
+bool ScalarEvolution::chrec(const std::string &reg, int loop, Chrec &rec) {
+    Value v = evaluate(reg, loop, 0);
+    if (!v.known || !v.self.empty()) return false;
+    rec = v.rec;
+    return true;
+}
+
+static const char *negated(const std::string &pred) {
+    if (pred == "<") return ">=";
+    if (pred == ">=") return "<";
+    if (pred == ">") return "<=";
+    if (pred == "<=") return ">";
+    if (pred == "==") return "!=";
+    if (pred == "!=") return "==";
+    return nullptr;
+}
+
+// The same comparison with its operands swapped.
+static const char *swapped(const std::string &pred) {
+    if (pred == "<") return ">";
+    if (pred == ">") return "<";
+    if (pred == "<=") return ">=";
+    if (pred == ">=") return "<=";
+    if (pred == "==") return "==";
+    if (pred == "!=") return "!=";
+    return nullptr;
+}
+
+bool ScalarEvolution::exitTest(int loop, ExitTest &test) {
+    const Loop &l = info.loops[loop];
+    if (l.latches.size() != 1) return false;
+    test.exiting = -1;
+    for (int b : l.blocks) {
+        for (int s : fn.blocks[b].succs) {
+            if (l.contains(s)) continue;
+            if (test.exiting >= 0) return false;
+            test.exiting = b;
+            test.exit = s;
+        }
+    }
+    if (test.exiting < 0 || (test.exiting != l.header && test.exiting != l.latches[0])) return false;
+
+    const auto &code = fn.blocks[test.exiting].code;
+    if (code.size() < 2 || !isCondBranch(code[code.size() - 2].op)) return false;
+    const TAC &branch = code[code.size() - 2];
+    bool leavesOnTrue = !l.contains(block(branchTarget(branch)));
+
+    std::string pred, a, b;
+    if (branch.op == "beqz" || branch.op == "bnez") {
+        const TAC *cond = definition(branch.arg1);
+        if (!cond || !swapped(cond->op)) return false;
+        pred = cond->op;
+        a = cond->arg1;
+        b = cond->arg2;
+        // beqz branches when the comparison is false
+        if (branch.op == "beqz") leavesOnTrue = !leavesOnTrue;
+    } else {
+        static const std::pair<const char *, const char *> conditions[] = {
+            {"beq", "=="}, {"bne", "!="}, {"blt", "<"}, {"bgt", ">"}, {"bge", ">="}, {"ble", "<="}};
+        for (const auto &c : conditions) {
+            if (branch.op == c.first) pred = c.second;
+        }
+        a = branch.arg1;
+        b = branch.arg2;
+    }
+    if (leavesOnTrue) pred = negated(pred);
+
+    if (!recurrence(a, loop, test.iv)) {
+        std::swap(a, b);
+        pred = swapped(pred);
+        if (!recurrence(a, loop, test.iv)) return false;
+    }
+    if (!invariant(b, loop, test.bound)) return false;
+    test.value = a;
+    test.pred = pred;
+    return true;
+}
+
+bool ScalarEvolution::constantTripCount(const ExitTest &test, int64_t &count) {
+    if (!test.iv.start.isConstant() || !test.bound.isConstant()) return false;
+    int64_t s = test.iv.start.offset, c = test.iv.step, bound = test.bound.offset;
+    const std::string &p = test.pred;
+    bool holds = p == "<" ? s < bound : p == "<=" ? s <= bound : p == ">" ? s > bound :
+                 p == ">=" ? s >= bound : p == "==" ? s == bound : s != bound;
+    if (!holds) {
+        count = 0;
+        return true;
+    }
+    if (c == 0) return false;
+    if (p == "==") {
+        count = 1; // The next value differs, wrapped or not
+        return true;
+    }
+
+    // Distance to cover and the step covering it, both towards the bound;
+    // values up to and including the first failing one must not wrap
+    uint64_t distance, stride;
+    if (p == "<" || p == "<=" || (p == "!=" && c > 0 && bound > s)) {
+        if (c < 0) return false;
+        if (p == "<=") {
+            if (bound == INT64_MAX) return false;
+            bound++;
+        }
+        distance = (uint64_t)bound - (uint64_t)s;
+        stride = c;
+        if (p == "!=" ? distance % stride : stride - 1 > (uint64_t)INT64_MAX - (uint64_t)bound) return false;
+    } else if (p == ">" || p == ">=" || (p == "!=" && c < 0 && bound < s)) {
+        if (c > 0) return false;
+        if (p == ">=") {
+            if (bound == INT64_MIN) return false;
+            bound--;
+        }
+        distance = (uint64_t)s - (uint64_t)bound;
+        stride = 0 - (uint64_t)c;
+        if (p == "!=" ? distance % stride : stride - 1 > (uint64_t)bound - (uint64_t)INT64_MIN) return false;
+    } else {
+        return false; // `!=` stepping away from the bound wraps before reaching it
+    }
+    uint64_t n = distance / stride + (distance % stride != 0);
+    if (n > (uint64_t)INT64_MAX) return false;
+    count = n;
+    return true;
+}
+
+std::string runtimeTripCount(Module &module, const ExitTest &test, std::vector<TAC> &code) {
+    auto binary = [&](const std::string &op, const std::string &a, const std::string &b) {
+        std::string t = module.newTemp();
+        code.push_back(TAC(op, a, b, t));
+        return t;
+    };
+    std::string pred = test.pred;
+    LinearValue start = test.iv.start, bound = test.bound;
+    int64_t step = test.iv.step;
+    if (pred == "<=" && step == 1 && bound.isConstant() && bound.offset != INT64_MAX) {
+        pred = "<";
+        bound.offset++;
+    } else if (pred == ">=" && step == -1 && bound.isConstant() && bound.offset != INT64_MIN) {
+        pred = ">";
+        bound.offset--;
+    }
+    bool up = step == 1 && (pred == "<" || pred == "!=");
+    bool down = step == -1 && (pred == ">" || pred == "!=");
+    if (!up && !down) return "";
+
+    // The distance to the bound, exact as an unsigned count
+    const LinearValue &high = up ? bound : start, &low = up ? start : bound;
+    LinearValue distance;
+    std::string d = addLinear(high, low, -1, distance)
+                        ? materialize(module, distance, code)
+                        : binary("-", materialize(module, high, code), materialize(module, low, code));
+    if (pred == "!=") return d;
+
+    // Masked to zero when the test fails at once
+    std::string holds = binary(pred, materialize(module, start, code), materialize(module, bound, code));
+    std::string mask = module.newTemp();
+    code.push_back(TAC("NEG", holds, "", mask));
+    return binary("&", d, mask);
+}
+
+bool ScalarEvolution::tripCount(int loop, int64_t &count) {
+    ExitTest test;
+    return exitTest(loop, test) && constantTripCount(test, count);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "CFG.h"
+#include "Loops.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Scalar evolution over SSA form: which registers of a loop step by a fixed
+// amount each iteration, and how many iterations the loop runs.
+//
+// A value invariant in a loop is tracked as scale*base + offset, with base a
+// register defined outside the loop (or none, for constants). A register
+// varying in the loop is a polynomial recurrence {c0, +, c1, +, ..., +, ck}
+// when it holds c0 on the first iteration and each coefficient grows by the
+// next one per iteration: a header phi fed from the latches by itself plus
+// another recurrence or invariant, and sums, differences, negations and
+// products of such phis and invariants. Affine recurrences {start, +, step}
+// have k = 1; `s += i` over an affine i gives k = 2. Everything else is
+// unknown. Arithmetic wraps, as in Eval.h.
+//
+// A loop's trip count is worked out from its exit test when the loop has
+// one latch and leaves from one block, the header or the latch, on a
+// comparison between a recurrence and an invariant. It counts how often that
+// test lets the loop continue, which is also how often the back edge is
+// taken; the header runs once more.
+
+struct LinearValue {
+    std::string base; // Register, or "" for a constant
+    int64_t scale = 0;
+    int64_t offset = 0;
+
+    bool isConstant() const { return base.empty(); }
+    static LinearValue constant(int64_t v) { return {"", 0, v}; }
+};
+
+// a + k*b, if a and b are both constants or share their base register.
+bool addLinear(const LinearValue &a, const LinearValue &b, int64_t k, LinearValue &out);
+
+// Appends code computing v and returns the register holding it.
+std::string materialize(Module &module, const LinearValue &v, std::vector<TAC> &code);
+
+// {c0, +, ..., +, ck}; invariant when only c0 is given. The value on
+// iteration n (from 0) is the sum of cj * binomial(n, j).
+struct Chrec {
+    std::vector<LinearValue> coeffs;
+
+    int order() const { return (int)coeffs.size() - 1; }
+};
+
+// An affine recurrence stepping by a constant.
+struct Recurrence {
+    LinearValue start;
+    int64_t step = 0;
+};
+
+// The exit test, normalised to `iv pred bound` holding while the loop goes on.
+struct ExitTest {
+    int exiting = -1;  // Block holding the test
+    int exit = -1;     // Block it leaves for
+    std::string value; // Register compared
+    Recurrence iv;     // Its evolution at the test
+    std::string pred;  // "<", "<=", ">", ">=", "==" or "!="
+    LinearValue bound;
+};
+
+// Appends code computing how often a test passes when its start or bound is
+// only known at run time, and returns the register holding the count, exact
+// as an unsigned value; or "" when the test is not one of the shapes
+// handled: `iv < bound` or `iv > bound` stepping by 1 towards the bound (0
+// when the test fails at once), or `iv != bound` stepping by 1 either way,
+// which under wrapping always ends. A test that may never fail, such as
+// `iv <= bound` for a bound that could be the largest value, is not handled.
+std::string runtimeTripCount(Module &module, const ExitTest &test, std::vector<TAC> &code);
+
+class ScalarEvolution {
+    private:
+        struct Value {
+            bool known = false;
+            std::string self; // Header phi under analysis, which the value adds once
+            Chrec rec;
+        };
+
+        const Function &fn;
+        const LoopInfo &info;
+        std::unordered_map<std::string, int> labels;
+        std::unordered_map<std::string, std::pair<int, int>> defs; // Register -> (block, index)
+        std::vector<std::unordered_map<std::string, Value>> cache;   // Per loop
+        // Values cached while a phi is analysed hold it unresolved, and
+        // are dropped once it is
+        std::vector<std::pair<int, std::string>> provisional;
+        int analysing = 0;
+
+        int block(const std::string &label) const;
+        Value evaluate(const std::string &reg, int loop, int depth);
+        Value evaluatePhi(const TAC &phi, int loop, int depth);
+
+    public:
+        ScalarEvolution(const Function &fn, const LoopInfo &info);
+
+        const TAC *definition(const std::string &reg) const;
+        int definingBlock(const std::string &reg) const;
+
+        // Whether reg is invariant in the loop, and its value if so.
+        bool invariant(const std::string &reg, int loop, LinearValue &value);
+        // Whether reg is an affine recurrence of the loop, and which.
+        bool recurrence(const std::string &reg, int loop, Recurrence &rec);
+        // Whether reg is a polynomial recurrence (or invariant) of the loop.
+        bool chrec(const std::string &reg, int loop, Chrec &rec);
+        // The loop's exit test, if it has the shape trip counts need.
+        bool exitTest(int loop, ExitTest &test);
+        // How often the test of a constant start and bound passes, if the
+        // iteration provably stops without wrapping around.
+        static bool constantTripCount(const ExitTest &test, int64_t &count);
+        bool tripCount(int loop, int64_t &count);
+};
@@ -0,0 +1,262 @@
+#include "Serialize.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+static const char *TEXT_HEADER = "# x_compiler TAC v1";
+static const char BINARY_MAGIC[4] = {'X', 'T', 'A', 'C'};
+static const unsigned char BINARY_VERSION = 1;
+
+static const std::unordered_set<std::string> knownOps = {
+    "function", "param", "label", "li", "load", "store", "move", "call", "arg",
+    "RETURN", "EXPR", "jmp", "jtab", "beqz", "bnez", "beq", "bne", "blt", "bgt", "bge",
+    "ble", "NEG", "~", "seq", "+", "-", "*", "/", "%", "&", "|", "^", "<<",
+    ">>", "&&", "||", "==", "!=", "<", ">", "<=", ">=", "mulh", "phi"};
+
+//////////////////////////////////////////////////////////////////////////
+
+static const std::string &field(const std::string &s) {
+    static const std::string empty = ".";
+    return s.empty() ? empty : s;
+}
+
+// Both formats keep four fields per instruction: a `jtab`'s targets travel
+// comma-separated in its result field, and a `phi`'s incoming pairs as
+// `label:value` items in its first operand.
+static TAC packed(const TAC &tac) {
+    if (tac.op == "jtab") {
+        TAC out(tac.op, tac.arg1, tac.arg2, "");
+        for (size_t i = 0; i < tac.targets.size(); i++) out.result += (i ? "," : "") + tac.targets[i];
+        return out;
+    }
+    if (tac.op == "phi") {
+        TAC out(tac.op, "", "", tac.result);
+        for (size_t i = 0; i < tac.phiArgs.size(); i++) {
+            out.arg1 += (i ? "," : "") + tac.phiArgs[i].first + ":" + tac.phiArgs[i].second;
+        }
+        return out;
+    }
+    return tac;
+}
+
+static std::vector<std::string> splitList(const std::string &list) {
+    std::vector<std::string> items;
+    for (size_t start = 0; start <= list.size();) {
+        size_t comma = std::min(list.find(',', start), list.size());
+        items.push_back(list.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return items;
+}
+
+static TAC unpacked(TAC tac) {
+    if (tac.op == "jtab") {
+        tac.targets = splitList(tac.result);
+        tac.result.clear();
+    } else if (tac.op == "phi") {
+        for (const auto &item : splitList(tac.arg1)) {
+            size_t colon = item.find(':');
+            if (colon == std::string::npos) continue;
+            tac.phiArgs.push_back({item.substr(0, colon), item.substr(colon + 1)});
+        }
+        tac.arg1.clear();
+    }
+    return tac;
+}
+
+void writeTextTAC(std::ostream &out, const std::vector<TAC> &code) {
+    out << TEXT_HEADER << "\n";
+    for (const auto &instr : code) {
+        TAC tac = packed(instr);
+        if (tac.op != "function" && tac.op != "label") out << "    ";
+        out << tac.op;
+
+        // Leave out trailing empty fields
+        const std::string *fields[] = {&tac.arg1, &tac.arg2, &tac.result};
+        int last = 2;
+        while (last >= 0 && fields[last]->empty()) last--;
+        for (int i = 0; i <= last; i++) out << " " << field(*fields[i]);
+        out << "\n";
+    }
+}
+
+bool readTextTAC(std::istream &in, std::vector<TAC> &code, std::string &error) {
+    std::string line;
+    int lineNo = 0;
+    bool sawHeader = false;
+    while (std::getline(in, line)) {
+        lineNo++;
+        if (!sawHeader) {
+            if (line.rfind("# x_compiler TAC v", 0) == 0 && line != TEXT_HEADER) {
+                error = "line 1: unsupported TAC version";
+                return false;
+            }
+            sawHeader = true;
+        }
+
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+
+        std::istringstream fields(line);
+        std::vector<std::string> tokens;
+        std::string tok;
+        while (fields >> tok) tokens.push_back(tok);
+        if (tokens.empty()) continue;
+
+        if (!knownOps.count(tokens[0])) {
+            error = "line " + std::to_string(lineNo) + ": unknown op '" + tokens[0] + "'";
+            return false;
+        }
+        if (tokens.size() > 4) {
+            error = "line " + std::to_string(lineNo) + ": too many operands";
+            return false;
+        }
+        tokens.resize(4);
+        for (auto &t : tokens) {
+            if (t == ".") t.clear();
+        }
+        code.push_back(unpacked(TAC(tokens[0], tokens[1], tokens[2], tokens[3])));
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void writeVarint(std::ostream &out, uint64_t v) {
+    do {
+        unsigned char byte = v & 0x7f;
+        v >>= 7;
+        if (v) byte |= 0x80;
+        out.put(byte);
+    } while (v);
+}
+
+static bool readVarint(std::istream &in, uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = in.get();
+        if (c == EOF) return false;
+        v |= uint64_t(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+void writeBinaryTAC(std::ostream &out, const std::vector<TAC> &code) {
+    std::vector<std::string> strings = {""};
+    std::unordered_map<std::string, uint64_t> index = {{"", 0}};
+    auto intern = [&](const std::string &s) {
+        auto it = index.find(s);
+        if (it != index.end()) return it->second;
+        index[s] = strings.size();
+        strings.push_back(s);
+        return (uint64_t)strings.size() - 1;
+    };
+
+    std::vector<uint64_t> ids;
+    ids.reserve(code.size() * 4);
+    for (const auto &instr : code) {
+        TAC tac = packed(instr);
+        ids.push_back(intern(tac.op));
+        ids.push_back(intern(tac.arg1));
+        ids.push_back(intern(tac.arg2));
+        ids.push_back(intern(tac.result));
+    }
+
+    out.write(BINARY_MAGIC, 4);
+    out.put(BINARY_VERSION);
+    writeVarint(out, strings.size() - 1);
+    for (size_t i = 1; i < strings.size(); i++) {
+        writeVarint(out, strings[i].size());
+        out.write(strings[i].data(), strings[i].size());
+    }
+    writeVarint(out, code.size());
+    for (uint64_t id : ids) writeVarint(out, id);
+}
+
+// Bytes left in the stream. A stream that cannot seek gets a bound no name
+// or jump table list comes near.
+static uint64_t remaining(std::istream &in) {
+    std::streampos here = in.tellg();
+    if (here == std::streampos(-1)) return 1 << 24;
+    in.seekg(0, std::ios::end);
+    std::streampos end = in.tellg();
+    in.seekg(here);
+    return end == std::streampos(-1) || end < here ? 0 : uint64_t(end - here);
+}
+
+bool readBinaryTAC(std::istream &in, std::vector<TAC> &code, std::string &error) {
+    char magic[4];
+    if (!in.read(magic, 4) || std::string(magic, 4) != std::string(BINARY_MAGIC, 4)) {
+        error = "not a binary TAC file";
+        return false;
+    }
+    if (in.get() != BINARY_VERSION) {
+        error = "unsupported binary TAC version";
+        return false;
+    }
+
+    uint64_t count;
+    if (!readVarint(in, count)) {
+        error = "truncated string table";
+        return false;
+    }
+    std::vector<std::string> strings = {""};
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t len;
+        if (!readVarint(in, len)) {
+            error = "truncated string table";
+            return false;
+        }
+        // A corrupt length must not size the allocation
+        if (len > remaining(in)) {
+            error = "truncated string table";
+            return false;
+        }
+        std::string s(len, '\0');
+        if (!in.read(&s[0], len)) {
+            error = "truncated string table";
+            return false;
+        }
+        strings.push_back(std::move(s));
+    }
+
+    if (!readVarint(in, count)) {
+        error = "truncated instruction count";
+        return false;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t f[4];
+        for (auto &id : f) {
+            if (!readVarint(in, id) || id >= strings.size()) {
+                error = "bad operand in instruction " + std::to_string(i);
+                return false;
+            }
+        }
+        if (!knownOps.count(strings[f[0]])) {
+            error = "unknown op '" + strings[f[0]] + "' in instruction " + std::to_string(i);
+            return false;
+        }
+        code.push_back(unpacked(TAC(strings[f[0]], strings[f[1]], strings[f[2]], strings[f[3]])));
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool readTACFile(const std::string &path, std::vector<TAC> &code, std::string &error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    char magic[4] = {0};
+    in.read(magic, 4);
+    bool binary = in.gcount() == 4 && std::string(magic, 4) == std::string(BINARY_MAGIC, 4);
+    in.clear();
+    in.seekg(0);
+    return binary ? readBinaryTAC(in, code, error) : readTextTAC(in, code, error);
+}
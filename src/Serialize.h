@@ -0,0 +1,35 @@
+#pragma once
+
+#include "TAC.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Stable on-disk forms of a TAC program, so IR can be saved after the middle
+// end and fed back into the pipeline with --from-tac.
+//
+// Text (.tac): one instruction per line, `op arg1 arg2 result`, with `.` for
+// an empty field; trailing empty fields may be left out. `#` starts a
+// comment. The first line is a version header:
+//
+//     # x_compiler TAC v1
+//     function main
+//         li 10 . t3
+//         store t3 . x
+//
+// Binary: "XTAC", a version byte, a string table and then every instruction
+// as four LEB128 string indices (0 is the empty string).
+//
+// In both, a `jtab` lists its targets in the result field, `L1,L2`, and a
+// `phi` its incoming pairs in the first operand, `P1:v1,P2:v2`, so TAC
+// written in the middle of the SSA passes reads back whole.
+
+void writeTextTAC(std::ostream &out, const std::vector<TAC> &code);
+void writeBinaryTAC(std::ostream &out, const std::vector<TAC> &code);
+
+// Both readers return false and set `error` on malformed input.
+bool readTextTAC(std::istream &in, std::vector<TAC> &code, std::string &error);
+bool readBinaryTAC(std::istream &in, std::vector<TAC> &code, std::string &error);
+
+// Reads either form, telling them apart by the binary magic.
+bool readTACFile(const std::string &path, std::vector<TAC> &code, std::string &error);
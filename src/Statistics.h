@@ -0,0 +1,42 @@
+#pragma once
+
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Per-pass, per-function counters (instructions folded, blocks removed, ...)
+// collected while optimising and printed by `--stats` in the order they were
+// first recorded, which follows the pipeline.
+class Statistics {
+    private:
+        typedef std::tuple<std::string, std::string, std::string> Key; // (pass, function, counter)
+
+        std::map<Key, size_t> index;
+        std::vector<std::pair<Key, long>> rows;
+
+    public:
+        void add(const std::string &pass, const std::string &function, const std::string &counter, long n = 1) {
+            if (!n) return;
+            auto it = index.emplace(Key(pass, function, counter), rows.size());
+            if (it.second) rows.push_back({it.first->first, 0});
+            rows[it.first->second].second += n;
+        }
+
+        long get(const std::string &pass, const std::string &function, const std::string &counter) const {
+            auto it = index.find(Key(pass, function, counter));
+            return it == index.end() ? 0 : rows[it->second].second;
+        }
+
+        void print(std::ostream &out) const {
+            out << "pass statistics:" << std::endl;
+            if (rows.empty()) out << "    (none)" << std::endl;
+            for (const auto &[key, value] : rows) {
+                out << "    " << std::left << std::setw(12) << std::get<0>(key) << " "
+                    << std::setw(16) << std::get<1>(key) << " " << std::setw(24) << std::get<2>(key)
+                    << std::right << std::setw(8) << value << std::endl;
+            }
+        }
+};
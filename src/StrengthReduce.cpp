@@ -0,0 +1,199 @@
+#include "StrengthReduce.h"
+#include "Registers.h"
+
+namespace {
+
+bool isPowerOfTwo(uint64_t v) { return v && !(v & (v - 1)); }
+
+int log2Exact(uint64_t v) {
+    int k = 0;
+    while (v >>= 1) k++;
+    return k;
+}
+
+// Appends the replacement sequence of one instruction, writing fresh
+// registers; the value computed last is renamed to the original result.
+struct Emitter {
+    Module &module;
+    std::vector<TAC> &out;
+
+    std::string constant(int64_t v) {
+        std::string t = module.newTemp();
+        out.push_back(TAC("li", std::to_string(v), "", t));
+        return t;
+    }
+    std::string unary(const std::string &op, const std::string &a) {
+        std::string t = module.newTemp();
+        out.push_back(TAC(op, a, "", t));
+        return t;
+    }
+    std::string binary(const std::string &op, const std::string &a, const std::string &b) {
+        std::string t = module.newTemp();
+        out.push_back(TAC(op, a, b, t));
+        return t;
+    }
+    std::string shift(const std::string &op, const std::string &a, int k) { return binary(op, a, constant(k)); }
+};
+
+// Multiplier and shift for signed division by d, |d| >= 2 and not a power
+// of two (Hacker's Delight, figure 10-1, widened to 64 bits).
+struct Magic {
+    int64_t multiplier;
+    int shift;
+};
+
+Magic signedMagic(int64_t d) {
+    const uint64_t two63 = 1ULL << 63;
+    uint64_t ad = d < 0 ? 0 - (uint64_t)d : (uint64_t)d;
+    uint64_t t = two63 + ((uint64_t)d >> 63);
+    uint64_t anc = t - 1 - t % ad; // Largest dividend with remainder |d| - 1
+    int p = 63;
+    uint64_t q1 = two63 / anc, r1 = two63 - q1 * anc;
+    uint64_t q2 = two63 / ad, r2 = two63 - q2 * ad;
+    uint64_t delta;
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    uint64_t m = q2 + 1;
+    return {(int64_t)(d < 0 ? 0 - m : m), p - 64};
+}
+
+// x*c in at most two shifts and adds, or "" (emitting nothing) if that
+// takes more.
+std::string multiply(Emitter &e, const std::string &x, int64_t c) {
+    if (c == 0) return e.constant(0);
+    if (c == 1) return x;
+    if (c == -1) return e.unary("NEG", x);
+    bool negative = c < 0;
+    uint64_t m = negative ? 0 - (uint64_t)c : (uint64_t)c;
+    if (isPowerOfTwo(m)) {
+        std::string s = e.shift("<<", x, log2Exact(m));
+        return negative ? e.unary("NEG", s) : s;
+    }
+    if (!negative && isPowerOfTwo(m - 1)) return e.binary("+", e.shift("<<", x, log2Exact(m - 1)), x);
+    if (isPowerOfTwo(m + 1)) {
+        std::string s = e.shift("<<", x, log2Exact(m + 1));
+        return negative ? e.binary("-", x, s) : e.binary("-", s, x);
+    }
+    return "";
+}
+
+// x + (2^k - 1) if x is negative, else x: the dividend that makes an
+// arithmetic shift by k round towards zero.
+std::string biased(Emitter &e, const std::string &x, uint64_t powerOfTwo) {
+    std::string sign = e.shift(">>", x, 63);
+    std::string bias = e.binary("&", sign, e.constant((int64_t)(powerOfTwo - 1)));
+    return e.binary("+", x, bias);
+}
+
+// x/d for d other than 0
+std::string divide(Emitter &e, const std::string &x, int64_t d) {
+    if (d == 1) return x;
+    if (d == -1) return e.unary("NEG", x);
+    uint64_t ad = d < 0 ? 0 - (uint64_t)d : (uint64_t)d;
+    if (isPowerOfTwo(ad)) {
+        std::string q = e.shift(">>", biased(e, x, ad), log2Exact(ad));
+        return d < 0 ? e.unary("NEG", q) : q;
+    }
+    Magic magic = signedMagic(d);
+    std::string q = e.binary("mulh", x, e.constant(magic.multiplier));
+    if (d > 0 && magic.multiplier < 0) q = e.binary("+", q, x);
+    if (d < 0 && magic.multiplier > 0) q = e.binary("-", q, x);
+    if (magic.shift > 0) q = e.shift(">>", q, magic.shift);
+    // Round towards zero: add one to negative quotients
+    return e.binary("-", q, e.shift(">>", q, 63));
+}
+
+// x%d for d other than 0
+std::string remainder(Emitter &e, const std::string &x, int64_t d) {
+    if (d == 1 || d == -1) return e.constant(0);
+    uint64_t ad = d < 0 ? 0 - (uint64_t)d : (uint64_t)d;
+    if (isPowerOfTwo(ad)) {
+        std::string truncated = e.binary("&", biased(e, x, ad), e.constant((int64_t)(0 - ad)));
+        return e.binary("-", x, truncated);
+    }
+    std::string q = divide(e, x, d);
+    std::string product = multiply(e, q, d);
+    if (product.empty()) product = e.binary("*", q, e.constant(d));
+    return e.binary("-", x, product);
+}
+
+} // namespace
+
+void reduceStrength(Module &module, Function &fn, Statistics &stats) {
+    RegisterNumbering regs(fn);
+    std::vector<int> defCount;
+    std::vector<char> known;
+    std::vector<int64_t> value;
+    for (const auto &bb : fn.blocks) {
+        for (const auto &tac : bb.code) {
+            if (tacDef(tac).empty()) continue;
+            size_t r = regs.id(tac.result);
+            if (r >= defCount.size()) {
+                defCount.resize(r + 1, 0);
+                known.resize(r + 1, 0);
+                value.resize(r + 1, 0);
+            }
+            defCount[r]++;
+            if (tac.op == "li") {
+                known[r] = 1;
+                value[r] = std::stoll(tac.arg1);
+            }
+        }
+    }
+    auto constant = [&](const std::string &s, int64_t &v) {
+        int r = regs.find(s);
+        if (r < 0 || (size_t)r >= known.size() || !known[r] || defCount[r] != 1) return false;
+        v = value[r];
+        return true;
+    };
+
+    long multiplies = 0, divisions = 0, remainders = 0;
+    std::vector<TAC> sequence;
+    for (auto &bb : fn.blocks) {
+        std::vector<TAC> code;
+        code.reserve(bb.code.size());
+        for (auto &tac : bb.code) {
+            sequence.clear();
+            Emitter e{module, sequence};
+            std::string v;
+            int64_t c;
+            if (tac.op == "*") {
+                if (constant(tac.arg2, c)) v = multiply(e, tac.arg1, c);
+                else if (constant(tac.arg1, c)) v = multiply(e, tac.arg2, c);
+                multiplies += !v.empty();
+            } else if (tac.op == "/" && constant(tac.arg2, c) && c != 0) {
+                v = divide(e, tac.arg1, c);
+                divisions++;
+            } else if (tac.op == "%" && constant(tac.arg2, c) && c != 0) {
+                v = remainder(e, tac.arg1, c);
+                remainders++;
+            }
+            if (v.empty()) {
+                code.push_back(std::move(tac));
+                continue;
+            }
+            if (!sequence.empty() && sequence.back().result == v) sequence.back().result = tac.result;
+            else sequence.push_back(TAC("move", v, "", tac.result));
+            code.insert(code.end(), sequence.begin(), sequence.end());
+        }
+        bb.code = std::move(code);
+    }
+
+    stats.add("strength", fn.name, "multiplies reduced", multiplies);
+    stats.add("strength", fn.name, "divisions reduced", divisions);
+    stats.add("strength", fn.name, "remainders reduced", remainders);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Strength reduction of `*`, `/` and `%` by constants.
+//
+// `mul` takes several cycles on the in-order cores the backend targets and
+// `div`/`rem` dozens, while shifts and adds take one. An operand is a
+// constant when its only definition is an `li`.
+//
+// A multiplication becomes a shift/add sequence when that needs at most two
+// operations: x*2^k is x << k, x*(2^k + 1) is (x << k) + x, and likewise for
+// 2^k - 1 and the negatives. Anything longer keeps its `mul`.
+//
+// A division by 2^k shifts after adding 2^k - 1 to negative dividends, so
+// the quotient rounds towards zero as C requires. Any other divisor uses the
+// multiply-high "magic number" method of Granlund and Montgomery (as given
+// in Hacker's Delight, 10-1): the quotient is the high half of x times a
+// precomputed reciprocal, shifted and corrected by one when negative. The
+// `mulh` opcode this introduces exists only for that. A remainder is
+// x - (x/d)*d, with the multiplication by d reduced in turn.
+//
+// Results agree with the RISC-V semantics in Eval.h for every dividend,
+// INT64_MIN included. Division by 0 is left for the hardware.
+void reduceStrength(Module &module, Function &fn, Statistics &stats);
@@ -0,0 +1,228 @@
+#include "SwitchLowering.h"
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+const uint64_t MIN_TABLE_CASES = 4;
+const uint64_t BIT_TEST_WIDTH = 64;  // Values a register's bits can cover
+const size_t MAX_BIT_TEST_LABELS = 3;
+const size_t LEAF_SIZE = 3;          // Pieces tested in a row at a leaf of the search
+
+// Consecutive case values going to the same label
+struct Cluster {
+    int64_t lo, hi;
+    std::string label;
+};
+
+// A piece of the dispatch, handling clusters [first, last]
+struct Piece {
+    enum Kind { Range, Table, BitTest } kind;
+    size_t first, last;
+};
+
+// Number of values from lo to hi; saturates rather than wrapping.
+uint64_t span(int64_t lo, int64_t hi) {
+    uint64_t n = (uint64_t)hi - (uint64_t)lo;
+    return n == UINT64_MAX ? n : n + 1;
+}
+
+// Bit tests pay off with enough cases per label to test (as in LLVM).
+bool worthBitTest(size_t labels, uint64_t cases) {
+    return (labels == 1 && cases >= 3) || (labels == 2 && cases >= 5) || (labels == 3 && cases >= 6);
+}
+
+struct SwitchLowering {
+    const std::string &value;
+    const std::string &defaultLabel;
+    int &counter;
+    std::vector<Cluster> clusters;
+    std::vector<Piece> pieces;
+    std::vector<TAC> code;
+
+    std::string newLabel() { return "L" + std::to_string(counter++); }
+
+    // A register holding v; the literal "0" needs none
+    std::string constant(int64_t v) {
+        if (v == 0) return "0";
+        std::string t = "t" + std::to_string(counter++);
+        code.push_back(TAC("li", std::to_string(v), "", t));
+        return t;
+    }
+
+    int64_t lo(const Piece &p) const { return clusters[p.first].lo; }
+    int64_t hi(const Piece &p) const { return clusters[p.last].hi; }
+
+    // Fewest pieces covering the clusters, where [i, j] may become a piece
+    // of kind `kind` if `fits(i, j)`; the rest stay as they are.
+    void partition(Piece::Kind kind, const std::function<bool(size_t, size_t)> &fits) {
+        std::vector<Piece> out;
+        size_t start = 0;
+        while (start < pieces.size()) {
+            // A run of single ranges to split up
+            size_t end = start;
+            while (end < pieces.size() && pieces[end].kind == Piece::Range) end++;
+            if (end == start) {
+                out.push_back(pieces[start++]);
+                continue;
+            }
+            size_t n = end - start;
+            std::vector<size_t> best(n + 1, 0), next(n + 1, 0);
+            for (size_t i = n; i-- > 0;) {
+                best[i] = best[i + 1] + 1;
+                next[i] = i + 1;
+                for (size_t j = i + 1; j < n; j++) {
+                    if (best[j + 1] + 1 < best[i] && fits(pieces[start + i].first, pieces[start + j].last)) {
+                        best[i] = best[j + 1] + 1;
+                        next[i] = j + 1;
+                    }
+                }
+            }
+            for (size_t i = 0; i < n; i = next[i]) {
+                if (next[i] == i + 1) {
+                    out.push_back(pieces[start + i]);
+                } else {
+                    out.push_back({kind, pieces[start + i].first, pieces[start + next[i] - 1].last});
+                }
+            }
+            start = end;
+        }
+        pieces = std::move(out);
+    }
+
+    // Jumps to `miss` unless the value is in [from, to], given that it is
+    // known to be in [lo, hi].
+    void checkRange(int64_t from, int64_t to, int64_t lo, int64_t hi, const std::string &miss) {
+        if (lo < from) code.push_back(TAC("blt", value, constant(from), miss));
+        if (hi > to) code.push_back(TAC("bgt", value, constant(to), miss));
+    }
+
+    // The value less the piece's lowest case
+    std::string offset(int64_t from) {
+        if (from == 0) return value;
+        std::string base = constant(from);
+        std::string t = "t" + std::to_string(counter++);
+        code.push_back(TAC("-", value, base, t));
+        return t;
+    }
+
+    void emitPiece(const Piece &p, int64_t lo, int64_t hi, const std::string &miss) {
+        int64_t from = this->lo(p), to = this->hi(p);
+        if (p.kind == Piece::Range) {
+            const std::string &label = clusters[p.first].label;
+            if (from == to && (lo < from || hi > to)) {
+                code.push_back(TAC("beq", value, constant(from), label));
+                code.push_back(TAC("jmp", "", "", miss));
+                return;
+            }
+            checkRange(from, to, lo, hi, miss);
+            code.push_back(TAC("jmp", "", "", label));
+            return;
+        }
+
+        checkRange(from, to, lo, hi, miss);
+        std::string index = offset(from);
+        if (p.kind == Piece::Table) {
+            TAC table("jtab", index, "", "");
+            size_t c = p.first;
+            for (uint64_t k = 0; k < span(from, to); k++) {
+                int64_t v = (int64_t)((uint64_t)from + k);
+                while (clusters[c].hi < v) c++;
+                table.targets.push_back(clusters[c].lo <= v ? clusters[c].label : defaultLabel);
+            }
+            code.push_back(table);
+            return;
+        }
+
+        // One mask of the offsets going to each label
+        std::vector<std::pair<std::string, uint64_t>> masks;
+        uint64_t cases = 0;
+        for (size_t c = p.first; c <= p.last; c++) {
+            auto it = std::find_if(masks.begin(), masks.end(), [&](const auto &m) { return m.first == clusters[c].label; });
+            if (it == masks.end()) it = masks.insert(masks.end(), {clusters[c].label, 0});
+            for (uint64_t k = (uint64_t)clusters[c].lo - (uint64_t)from; k <= (uint64_t)clusters[c].hi - (uint64_t)from; k++) {
+                it->second |= uint64_t(1) << k;
+            }
+            cases += span(clusters[c].lo, clusters[c].hi);
+        }
+        std::string one = "t" + std::to_string(counter++), bit = "t" + std::to_string(counter++);
+        code.push_back(TAC("li", "1", "", one));
+        code.push_back(TAC("<<", one, index, bit));
+        for (size_t m = 0; m < masks.size(); m++) {
+            // Without holes, the last label takes whatever is left
+            if (m + 1 == masks.size() && cases == span(from, to)) {
+                code.push_back(TAC("jmp", "", "", masks[m].first));
+                return;
+            }
+            std::string mask = constant((int64_t)masks[m].second);
+            std::string t = "t" + std::to_string(counter++);
+            code.push_back(TAC("&", bit, mask, t));
+            code.push_back(TAC("bnez", t, masks[m].first, ""));
+        }
+        code.push_back(TAC("jmp", "", "", defaultLabel));
+    }
+
+    // Dispatch among pieces [a, b), for a value known to be in [lo, hi]
+    void emitTree(size_t a, size_t b, int64_t lo, int64_t hi) {
+        if (b - a <= LEAF_SIZE) {
+            for (size_t k = a; k < b; k++) {
+                std::string miss = k + 1 < b ? newLabel() : defaultLabel;
+                emitPiece(pieces[k], lo, hi, miss);
+                if (k + 1 == b) continue;
+                // The next piece follows anyway
+                if (code.back().op == "jmp" && code.back().result == miss) code.pop_back();
+                code.push_back(TAC("label", miss, "", ""));
+            }
+            return;
+        }
+        size_t mid = a + (b - a) / 2;
+        int64_t pivot = this->lo(pieces[mid]);
+        std::string right = newLabel();
+        code.push_back(TAC("bge", value, constant(pivot), right));
+        emitTree(a, mid, lo, pivot - 1);
+        code.push_back(TAC("label", right, "", ""));
+        emitTree(mid, b, pivot, hi);
+    }
+};
+
+} // namespace
+
+std::vector<TAC> lowerSwitch(const std::string &value, std::vector<SwitchCase> cases,
+                             const std::string &defaultLabel, int minDensity, int &counter) {
+    SwitchLowering lowering{value, defaultLabel, counter, {}, {}, {}};
+    if (cases.empty()) {
+        lowering.code.push_back(TAC("jmp", "", "", defaultLabel));
+        return lowering.code;
+    }
+
+    std::sort(cases.begin(), cases.end(), [](const SwitchCase &x, const SwitchCase &y) { return x.value < y.value; });
+    auto &clusters = lowering.clusters;
+    for (const auto &c : cases) {
+        if (!clusters.empty() && clusters.back().label == c.label && clusters.back().hi + 1 == c.value) {
+            clusters.back().hi = c.value;
+        } else {
+            clusters.push_back({c.value, c.value, c.label});
+        }
+    }
+    for (size_t c = 0; c < clusters.size(); c++) lowering.pieces.push_back({Piece::Range, c, c});
+
+    // Cases in clusters [0, i), for densities
+    std::vector<uint64_t> before(clusters.size() + 1, 0);
+    for (size_t c = 0; c < clusters.size(); c++) before[c + 1] = before[c] + span(clusters[c].lo, clusters[c].hi);
+
+    lowering.partition(Piece::Table, [&](size_t i, size_t j) {
+        uint64_t n = before[j + 1] - before[i], range = span(clusters[i].lo, clusters[j].hi);
+        return n >= MIN_TABLE_CASES && range <= n * 100 / minDensity;
+    });
+    lowering.partition(Piece::BitTest, [&](size_t i, size_t j) {
+        if (span(clusters[i].lo, clusters[j].hi) > BIT_TEST_WIDTH) return false;
+        std::vector<std::string> labels;
+        for (size_t c = i; c <= j; c++) {
+            if (std::find(labels.begin(), labels.end(), clusters[c].label) == labels.end()) labels.push_back(clusters[c].label);
+        }
+        return labels.size() <= MAX_BIT_TEST_LABELS && worthBitTest(labels.size(), before[j + 1] - before[i]);
+    });
+
+    lowering.emitTree(0, lowering.pieces.size(), INT64_MIN, INT64_MAX);
+    return lowering.code;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "TAC.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Dispatch of a switch statement whose case values are known at compile
+// time.
+//
+// The cases are sorted and consecutive values going to the same label are
+// merged into ranges. Runs of ranges that fill at least `minDensity`
+// percent of the values they span, with four or more cases, become jump
+// tables: a `jtab` whose targets are emitted to .rodata, with holes going to
+// the default. Among what is left, runs spanning at most 64 values with up
+// to three destinations become bit tests: `1 << (value - low)` tested
+// against one mask per destination. Both are chosen to need the fewest
+// pieces, jump tables first.
+//
+// The pieces are then searched with a balanced binary tree of comparisons,
+// testing up to three of them in a row at its leaves. Each comparison
+// narrows the values known to reach a subtree, and the range checks of a
+// piece are only emitted for bounds the tree has not already established.
+struct SwitchCase {
+    int64_t value;
+    std::string label; // Where control goes for this value
+};
+
+// Code jumping from the register `value` to the label of the case equal to
+// it, or to defaultLabel. Case values must be distinct. New temporaries and
+// labels are numbered from `counter`, as in the front end.
+std::vector<TAC> lowerSwitch(const std::string &value, std::vector<SwitchCase> cases,
+                             const std::string &defaultLabel, int minDensity, int &counter);
@@ -4,23 +4,147 @@
 #include <vector>
 #include <memory>
 #include <fstream>
-#include "AST.h"
+#include <cctype>
+#include <string>
 
 struct TAC {
     std::string op;
     std::string arg1;
     std::string arg2;
     std::string result;
+    // Incoming (predecessor label, value) pairs of a `phi`; empty otherwise
+    std::vector<std::pair<std::string, std::string>> phiArgs;
+    // Destination labels of a `jtab`, by index; empty otherwise
+    std::vector<std::string> targets;
 
 TAC(std::string op, std::string arg1, std::string arg2, std::string result)
     : op(op), arg1(arg1), arg2(arg2), result(result) {}
 
 void print() {
-    if(arg2.empty()){
+    if(op == "phi"){
+        std::cout << result << " = phi";
+        for (const auto &[label, value] : phiArgs) std::cout << " [" << label << ": " << value << "]";
+        std::cout << std::endl;
+    }else if(arg2.empty()){
         std::cout << result << " = " << op << " " << arg1 << std::endl;
     }else{
         std::cout << result << " = " << arg1 << " " << op << " " << arg2 << std::endl;
     }
 }
 
-};
\ No newline at end of file
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Operand roles. TAC keeps everything in strings, so the passes need to know
+// which fields of an instruction name registers (temporaries), which name
+// stack variables and which hold labels or immediates.
+
+// Immediates only appear in `li` and as the literal "0" operand that the
+// short-circuit lowering compares against.
+inline bool isImmediate(const std::string &s) {
+    return !s.empty() && (isdigit((unsigned char)s[0]) || s[0] == '-');
+}
+
+inline bool isBinaryOpcode(const std::string &op) {
+    return op == "+" || op == "-" || op == "*" || op == "/" || op == "%" ||
+           op == "&" || op == "|" || op == "^" || op == "<<" || op == ">>" ||
+           op == "&&" || op == "||" || op == "==" || op == "!=" ||
+           op == "<" || op == ">" || op == "<=" || op == ">=" || op == "mulh";
+}
+
+inline bool isUnaryOpcode(const std::string &op) {
+    return op == "NEG" || op == "~" || op == "seq" || op == "move";
+}
+
+// Branches with a fall-through successor.
+inline bool isCondBranch(const std::string &op) {
+    return op == "beqz" || op == "bnez" || op == "beq" || op == "bne" ||
+           op == "blt" || op == "bgt" || op == "bge" || op == "ble";
+}
+
+// Instructions after which control never falls through. `jtab t` jumps to
+// targets[t], with t already checked to be in range.
+inline bool isTerminator(const TAC &tac) {
+    return tac.op == "jmp" || tac.op == "RETURN" || tac.op == "jtab";
+}
+
+// Label a branch transfers to, or "" for non-branches.
+inline std::string branchTarget(const TAC &tac) {
+    if (tac.op == "beqz" || tac.op == "bnez") return tac.arg2;
+    if (isCondBranch(tac.op) || tac.op == "jmp") return tac.result;
+    return "";
+}
+
+inline void setBranchTarget(TAC &tac, const std::string &label) {
+    if (tac.op == "beqz" || tac.op == "bnez") tac.arg2 = label;
+    else tac.result = label;
+}
+
+// Calls f on each label the instruction may transfer to, so passes can
+// inspect or rewrite them in place. Unlike branchTarget this covers the
+// many targets of a `jtab`.
+template <class T, class F>
+inline void forEachTarget(T &tac, F f) {
+    if (tac.op == "jtab") {
+        for (auto &target : tac.targets) f(target);
+    } else if (tac.op == "beqz" || tac.op == "bnez") {
+        f(tac.arg2);
+    } else if (isCondBranch(tac.op) || tac.op == "jmp") {
+        f(tac.result);
+    }
+}
+
+// N for a front-end temporary `tN`, or -1 for any other name, so hot loops
+// can index temporaries densely instead of hashing their names.
+inline long tempNumber(const std::string &s) {
+    if (s.size() < 2 || s.size() > 10 || s[0] != 't') return -1;
+    long n = 0;
+    for (size_t i = 1; i < s.size(); i++) {
+        if (!isdigit((unsigned char)s[i])) return -1;
+        n = n * 10 + (s[i] - '0');
+    }
+    return n;
+}
+
+// Register defined by the instruction, or "" if none. A `param` names a
+// register when its argument is kept in one rather than in the variable.
+inline std::string tacDef(const TAC &tac) {
+    if (tac.op == "li" || tac.op == "load" || tac.op == "call" || tac.op == "phi" || tac.op == "param" ||
+        isBinaryOpcode(tac.op) || isUnaryOpcode(tac.op)) {
+        return tac.result;
+    }
+    return "";
+}
+
+// Calls f on each register operand the instruction reads, in operand order,
+// so passes can inspect or rewrite them in place. A phi's operands are read
+// on the incoming edges rather than in its own block.
+template <class T, class F>
+inline void forEachUse(T &tac, F f) {
+    auto visit = [&](auto &s) {
+        if (!s.empty() && !isImmediate(s)) f(s);
+    };
+    if (isBinaryOpcode(tac.op) || tac.op == "beq" || tac.op == "bne" ||
+        tac.op == "blt" || tac.op == "bgt" || tac.op == "bge" || tac.op == "ble") {
+        visit(tac.arg1);
+        visit(tac.arg2);
+    } else if (isUnaryOpcode(tac.op) || tac.op == "store" || tac.op == "beqz" ||
+               tac.op == "bnez" || tac.op == "arg" || tac.op == "RETURN" ||
+               tac.op == "EXPR" || tac.op == "jtab") {
+        visit(tac.arg1);
+    } else if (tac.op == "phi") {
+        for (auto &arg : tac.phiArgs) visit(arg.second);
+    }
+}
+
+// Registers read by the instruction, in operand order.
+inline void tacUses(const TAC &tac, std::vector<std::string> &uses) {
+    forEachUse(tac, [&](const std::string &s) { uses.push_back(s); });
+}
+
+// Instructions that may be deleted when their result is unused.
+inline bool isPure(const TAC &tac) {
+    return tac.op == "li" || tac.op == "load" || tac.op == "EXPR" || tac.op == "phi" ||
+           isBinaryOpcode(tac.op) || isUnaryOpcode(tac.op);
+}
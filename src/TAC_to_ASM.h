@@ -1,252 +1,377 @@
 #pragma once
 
 #include "TAC.h"
+#include "MachineInstr.h"
+#include "Peephole.h"
+#include "RegAlloc.h"
 #include <fstream>
+#include <algorithm>
 #include <map>
+#include <ostream>
+
+// How the backend selects, allocates and tidies up instructions.
+struct BackendOptions {
+    RegisterAllocator allocator = RegisterAllocator::LinearScan;
+    bool peephole = false;               // Run optimizePeephole() over each function
+    std::ostream *spillReport = nullptr; // Where to list each function's spills, if anywhere
+};
 
 class TACtoASM {
     private:
         std::ofstream &outfile;
-        int tempVarCounter = 0; // Track temporary registers (t0, t1, ...)
         int argVarCounter = 0; // Track argument registers (a0, a1, ...)
-        int stackOffset = 0;    // Track stack memory offset
-        int stackSize = 64;     // Stack size for function prologue/epilogue
+        int stackSize = 64;     // Frame size of the current function
+        int spillBase = 0;      // Offset below which the callee-saved registers and spill slots go
+        int pendingSpill = -1;  // Spill slot to store the current instruction's result to
     
         std::map<std::string, int> varMap; // Maps variables to stack offsets
-        std::map<std::string, std::string> registerMap; // Maps temp vars to RISC-V registers
-    
-        std::string getTempReg() {
-            return "t" + std::to_string(tempVarCounter++ % 7); // Reuse t0-t6
+        Allocation alloc; // Registers of the current function's temporaries
+        std::vector<std::vector<std::string>> jumpTables; // Targets of each `jtab`, for .rodata
+        std::vector<MachineFunction> functions; // Selected code, printed once complete
+
+        void emit(const std::string &op, std::vector<std::string> operands = {}) {
+            functions.back().code.push_back(MachineInstr(op, std::move(operands)));
+        }
+
+        static std::string frameSlot(int offset) {
+            return std::to_string(offset) + "(s0)";
+        }
+
+        // Callee-saved registers go below the variables, spill slots below them
+        std::string savedSlot(size_t k) const {
+            return frameSlot(spillBase - 8 * (int)(k + 1));
+        }
+
+        std::string spillSlot(int slot) const {
+            return frameSlot(spillBase - 8 * (int)(alloc.calleeSaved.size() + slot + 1));
         }
     
         std::string getArgReg() {
             return "a" + std::to_string(argVarCounter++ % 7); // Reuse a0-a6
         }
-    
-        std::string mapToRegister(const std::string &tempVar) {
-            if (registerMap.find(tempVar) == registerMap.end()) {
-                registerMap[tempVar] = getTempReg();
+
+        // Register an instruction reads `tempVar` from: its own, or `scratch`
+        // with the value reloaded or rematerialised into it
+        std::string use(const std::string &tempVar, const char *scratch = SPILL_SCRATCH_1) {
+            if (tempVar == "0") return "zero"; // Literal operand of short-circuit branches
+            auto slot = alloc.slot.find(tempVar);
+            if (slot != alloc.slot.end()) {
+                emit("ld", {scratch, spillSlot(slot->second)});
+                return scratch;
             }
-            return registerMap[tempVar];
-        }
-    
-        std::string mapToArgRegister(const std::string &tempVar) {
-            if (registerMap.find(tempVar) == registerMap.end()) {
-                registerMap[tempVar] = getArgReg();
+            auto constant = alloc.remat.find(tempVar);
+            if (constant != alloc.remat.end()) {
+                emit("li", {scratch, constant->second});
+                return scratch;
             }
-            return registerMap[tempVar];
+            return alloc.reg.at(tempVar);
+        }
+
+        // Register an instruction writes `tempVar` to. A spilled one is
+        // written to scratch and stored once the instruction is selected
+        std::string def(const std::string &tempVar) {
+            auto slot = alloc.slot.find(tempVar);
+            if (slot == alloc.slot.end()) return alloc.reg.at(tempVar);
+            pendingSpill = slot->second;
+            return SPILL_SCRATCH_1;
         }
     
         void emitPrologue(int stackSize = 64) {
-            outfile << "    addi sp, sp, -" << stackSize << "\n";
-            outfile << "    sd ra, " << (stackSize - 8) << "(sp)\n";
-            outfile << "    sd s0, " << (stackSize - 16) << "(sp)\n";
-            outfile << "    addi s0, sp, " << stackSize << "\n";
-            stackOffset = -16; // Reset stack allocation
+            emit("addi", {"sp", "sp", std::to_string(-stackSize)});
+            emit("sd", {"ra", std::to_string(stackSize - 8) + "(sp)"});
+            emit("sd", {"s0", std::to_string(stackSize - 16) + "(sp)"});
+            emit("addi", {"s0", "sp", std::to_string(stackSize)});
+            for (size_t k = 0; k < alloc.calleeSaved.size(); k++) emit("sd", {alloc.calleeSaved[k], savedSlot(k)});
         }
     
+        void emitFrameRelease() {
+            for (size_t k = 0; k < alloc.calleeSaved.size(); k++) emit("ld", {alloc.calleeSaved[k], savedSlot(k)});
+            emit("ld", {"ra", std::to_string(stackSize - 8) + "(sp)"});
+            emit("ld", {"s0", std::to_string(stackSize - 16) + "(sp)"});
+            emit("addi", {"sp", "sp", std::to_string(stackSize)});
+        }
+
         void emitEpilogue() {
-            outfile << "    ld ra, " << (stackSize - 8) << "(sp)\n";
-            outfile << "    ld s0, " << (stackSize - 16) << "(sp)\n";
-            outfile << "    addi sp, sp, " << stackSize << "\n";
-            outfile << "    ret\n";
+            emitFrameRelease();
+            emit("ret");
         }
-    
-    public:
-        TACtoASM(std::ofstream &file) : outfile(file) {}
-    
-        void generateAssembly(const std::vector<TAC>& tacCode) {
-            outfile << ".text\n";
-            outfile << ".globl main\n";
-            outfile << ".type main, @function\n";
-    
+
+        // Allocates registers for one function's TAC, from its `function`
+        // up to the next, and selects its instructions.
+        void selectFunction(const std::vector<TAC> &tacCode, const BackendOptions &options, Statistics &stats) {
+            LiveRanges ranges = computeLiveRanges(tacCode);
+            alloc = allocateRegisters(ranges, options.allocator);
+            reportAllocation(tacCode[0].arg1, ranges, alloc, stats, options.spillReport);
+
             // Iterate over the TAC code
-            for (const auto& tac : tacCode) {
+            std::string prevOp;
+            for (size_t i = 0; i < tacCode.size(); i++) {
+                const auto &tac = tacCode[i];
+                if (prevOp == "param" && tac.op != "param") {
+                    argVarCounter = 0; // Outgoing arguments start at a0 again
+                }
+                prevOp = tac.op;
                 if (tac.op == "function") {
                     // Each function call starts with its own stack and register space
-                    outfile << tac.arg1 << ":\n"; // Function label
-                    tempVarCounter = 0; // Reset temp registers for each function
+                    functions.push_back({tac.arg1, {}});
+                    emit("label", {tac.arg1}); // Function label
                     argVarCounter = 0; // Reset argument registers for each function
                     varMap.clear(); // Clear the variable map for new function scope
-                    registerMap.clear(); // Clear the register map for new function scope
-    
-                    emitPrologue(); // Emit prologue for each function
+
+                    // A slot for every variable below the saved ra and s0,
+                    // which inlined callees add to, in order of first write
+                    for (size_t j = i + 1; j < tacCode.size(); j++) {
+                        std::string var = tacCode[j].op == "store" ? tacCode[j].result
+                                          : tacCode[j].op == "param" && tacCode[j].result.empty() ? tacCode[j].arg1 : "";
+                        if (!var.empty() && !varMap.count(var)) varMap[var] = -16 - 8 * (int)(varMap.size() + 1);
+                    }
+                    spillBase = -16 - 8 * (int)varMap.size();
+                    int slots = varMap.size() + alloc.calleeSaved.size() + alloc.slots;
+                    stackSize = std::max(64, (16 + 8 * slots + 15) / 16 * 16);
+                    emitPrologue(stackSize); // Emit prologue for each function
                 } 
                 else if (tac.op == "RETURN") {
                     // Handle return with a specific epilogue
-                    outfile << "    mv a0, " << mapToRegister(tac.arg1) << "\n";
+                    emit("mv", {"a0", use(tac.arg1)});
                     emitEpilogue();
                 }
                 else if (tac.op == "store") {
                     // Store value to local stack space
-                    if (varMap.find(tac.result) == varMap.end()) {
-                        stackOffset -= 8;  // Allocate if not already allocated
-                        varMap[tac.result] = stackOffset;
-                    }
-                    outfile << "    sd " << mapToRegister(tac.arg1) << ", "
-                            << varMap[tac.result] << "(s0)\n";
+                    emit("sd", {use(tac.arg1), frameSlot(varMap[tac.result])});
                 }
                 else if (tac.op == "load") {
-                    // Load value from local stack space
+                    // Load value from local stack space; a variable nothing
+                    // writes reads as zero
                     if (varMap.find(tac.arg1) != varMap.end()) {
-                        int offset = varMap[tac.arg1];
-                        outfile << "    ld " << mapToRegister(tac.result) << ", " << offset << "(s0)\n";
+                        emit("ld", {def(tac.result), frameSlot(varMap[tac.arg1])});
+                    } else {
+                        emit("li", {def(tac.result), "0"});
                     }
                 }
                 else if (tac.op == "li") {
-                    // Load immediate
-                    outfile << "    li " << mapToRegister(tac.result) << ", " << tac.arg1 << "\n";
+                    // Load immediate, unless the register was spilled and
+                    // every use loads it instead
+                    if (!alloc.remat.count(tac.result)) emit("li", {def(tac.result), tac.arg1});
                 }
                 else if (tac.op == "+") {
                     // Addition
-                    outfile << "    add " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("add", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
                 else if (tac.op == "-") {
                     // Subtraction
-                    outfile << "    sub " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("sub", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
                 else if (tac.op == "*") {
                     // Multiplication
-                    outfile << "    mul " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("mul", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
+                }
+                else if (tac.op == "mulh") {
+                    // High half of the signed product
+                    emit("mulh", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
                 else if (tac.op == "/") {
                     // Division
-                    outfile << "    div " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("div", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
                 else if (tac.op == "%") {
                     // Division
-                    outfile << "    rem " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("rem", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
                 else if (tac.op == "&") {
                     // Division
-                    outfile << "    and " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("and", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
                 else if (tac.op == "|") {
                     // Division
-                    outfile << "    or " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("or", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
                 else if (tac.op == "^") {
                     // Division
-                    outfile << "    xor " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("xor", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
                 else if (tac.op == "<<") {
                     // Division
-                    outfile << "    sll " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("sll", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
                 else if (tac.op == ">>") {
                     // Division
-                    outfile << "    srl " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("sra", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
-                else if (tac.op == "&&") {
-                    // Division
-                    outfile << "    and " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
-                }
-                else if (tac.op == "||") {
-                    // Division
-                    outfile << "    or " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                else if (tac.op == "&&" || tac.op == "||") {
+                    // Logical and/or of the operands' truth values
+                    std::string rd = def(tac.result);
+                    emit("snez", {rd, use(tac.arg1)});
+                    emit("snez", {"a7", use(tac.arg2, SPILL_SCRATCH_2)});
+                    emit(tac.op == "&&" ? "and" : "or", {rd, rd, "a7"});
                 }
                 else if (tac.op == "==") {
-                    // Division
-                    outfile << "    seqz " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    // Equal: difference is zero
+                    emit("sub", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
+                    emit("seqz", {def(tac.result), def(tac.result)});
                 }
                 else if (tac.op == "!=") {
-                    // Division
-                    outfile << "    snez " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    // Not equal: difference is non-zero
+                    emit("sub", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
+                    emit("snez", {def(tac.result), def(tac.result)});
                 }
                 else if (tac.op == "<") {
                     // Division
-                    outfile << "    slt " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
+                    emit("slt", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
                 }
                 else if (tac.op == ">") {
                     // Division
-                    outfile << "    slt " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg2) << ", " << mapToRegister(tac.arg1) << "\n";
+                    emit("slt", {def(tac.result), use(tac.arg2, SPILL_SCRATCH_2), use(tac.arg1)});
                 }
                 else if (tac.op == "<=") {
                     // Division
-                    outfile << "    slt " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg2) << ", " << mapToRegister(tac.arg1) << "\n";
-                    outfile << "    xori " << mapToRegister(tac.result) << ", " << mapToRegister(tac.result) << ", 1\n";
+                    emit("slt", {def(tac.result), use(tac.arg2, SPILL_SCRATCH_2), use(tac.arg1)});
+                    emit("xori", {def(tac.result), def(tac.result), "1"});
                 }
                 else if (tac.op == ">=") {
                     // Division
-                    outfile << "    slt " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << "\n";
-                    outfile << "    xori " << mapToRegister(tac.result) << ", " << mapToRegister(tac.result) << ", 1\n";
+                    emit("slt", {def(tac.result), use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2)});
+                    emit("xori", {def(tac.result), def(tac.result), "1"});
                 }
                 else if (tac.op == "move") {
-                    // Move value
-                    outfile << "    mv " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << "\n";
+                    // Move value, unless the allocator coalesced the two
+                    std::string src = use(tac.arg1), dst = def(tac.result);
+                    if (dst != src) emit("mv", {dst, src});
                 }
                 else if (tac.op == "~") {
                     // Move value
-                    outfile << "    not " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << "\n";
+                    emit("not", {def(tac.result), use(tac.arg1)});
                 }
                 else if (tac.op == "seq") {
                     // Move value
-                    outfile << "    seqz " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << "\n";
+                    emit("seqz", {def(tac.result), use(tac.arg1)});
                 }
                 else if (tac.op == "NEG") {
                     // Move value
-                    outfile << "    neg " << mapToRegister(tac.result) << ", " << mapToRegister(tac.arg1) << "\n";
+                    emit("neg", {def(tac.result), use(tac.arg1)});
                 }
                 else if (tac.op == "beqz") {
                     // Move value
-                    outfile << "    beqz " << mapToRegister(tac.arg1) << ", " << tac.arg2 << "\n";
+                    emit("beqz", {use(tac.arg1), tac.arg2});
                 }
                 else if (tac.op == "bnez") {
                     // Move value
-                    outfile << "    bnez " << mapToRegister(tac.arg1) << ", " << tac.arg2 << "\n";
+                    emit("bnez", {use(tac.arg1), tac.arg2});
                 }
                 else if (tac.op == "beq") {
                     // Move value
-                    outfile << "    beq " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << ", " << tac.result << "\n";
+                    emit("beq", {use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2), tac.result});
                 }
                 else if (tac.op == "bne") {
                     // Move value
-                    outfile << "    bne " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << ", " << tac.result << "\n";
+                    emit("bne", {use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2), tac.result});
                 }
                 else if (tac.op == "blt"){
-                    outfile << "    blt " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << ", " << tac.result << "\n";
+                    emit("blt", {use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2), tac.result});
                     
                 }
                 else if (tac.op == "bgt"){
-                    outfile << "    blt " << mapToRegister(tac.arg2) << ", " << mapToRegister(tac.arg1) << ", " << tac.result << "\n";
+                    emit("blt", {use(tac.arg2, SPILL_SCRATCH_2), use(tac.arg1), tac.result});
                     
                 }
                 else if (tac.op == "bge"){
-                    outfile << "    bge " << mapToRegister(tac.arg1) << ", " << mapToRegister(tac.arg2) << ", " << tac.result << "\n";
+                    emit("bge", {use(tac.arg1), use(tac.arg2, SPILL_SCRATCH_2), tac.result});
                     
                 }
                 else if (tac.op == "ble"){
-                    outfile << "    bge " << mapToRegister(tac.arg2) << ", " << mapToRegister(tac.arg1) << ", " << tac.result << "\n";
+                    emit("bge", {use(tac.arg2, SPILL_SCRATCH_2), use(tac.arg1), tac.result});
                     
                 }
                 else if (tac.op == "jmp") {
                     // Move value
-                    outfile << "    j " << tac.result << "\n";
+                    emit("j", {tac.result});
+                }
+                else if (tac.op == "jtab") {
+                    // Jump through the table's entry for the index. a6 and a7
+                    // only carry arguments between an `arg` and its call
+                    std::string table = ".LJT" + std::to_string(jumpTables.size());
+                    jumpTables.push_back(tac.targets);
+                    emit("la", {"a7", table});
+                    emit("slli", {"a6", use(tac.arg1), "3"});
+                    emit("add", {"a7", "a7", "a6"});
+                    emit("ld", {"a7", "0(a7)"});
+                    emit("jr", {"a7"});
                 }
                 else if (tac.op == "label") {
                     // Move value
-                    outfile << tac.arg1 << ":\n";
+                    emit("label", {tac.arg1});
+                }
+                else if (tac.op == "call" && !tac.result.empty() && argVarCounter <= 7 && i + 1 < tacCode.size() &&
+                         tacCode[i + 1].op == "RETURN" && tacCode[i + 1].arg1 == tac.result) {
+                    // Sibling call: the callee returns straight to our caller,
+                    // in the frame ours leaves, with the arguments in registers
+                    emitFrameRelease();
+                    emit("tail", {tac.arg1});
+                    argVarCounter = 0;
+                    i++;
                 }
                 else if (tac.op == "call") {
                     // Call function
-                    outfile << "    call " << tac.arg1 << "\n";
+                    emit("call", {tac.arg1});
+                    argVarCounter = 0; // The next call's arguments start at a0 again
                     
                     if (!tac.result.empty()) {
-                        outfile << "    mv " << mapToRegister(tac.result) << ", a0\n";  // Store return value
+                        emit("mv", {def(tac.result), "a0"});  // Store return value
                     }
                 }
                 else if (tac.op == "arg") {
                     // Call function
-                    outfile << "    mv " << getArgReg() << ", " << mapToRegister(tac.arg1) << "\n";
+                    emit("mv", {getArgReg(), use(tac.arg1)});
+                }
+                else if (tac.op == "param" && !tac.result.empty()) {
+                    // Parameter kept in a register
+                    emit("mv", {def(tac.result), getArgReg()});
                 }
                 else if (tac.op == "param") {
                     // Store value from register into memory
-                    if (varMap.find(tac.result) == varMap.end()) {
-                        stackOffset -= 8;  // Allocate if not already allocated
-                        varMap[tac.arg1] = stackOffset;
+                    emit("sd", {getArgReg(), frameSlot(varMap[tac.arg1])});
+                }
+
+                if (pendingSpill >= 0) {
+                    // The result goes to its spill slot
+                    emit("sd", {SPILL_SCRATCH_1, spillSlot(pendingSpill)});
+                    pendingSpill = -1;
+                }
+            }
+        }
+    
+    public:
+        TACtoASM(std::ofstream &file) : outfile(file) {}
+    
+        // Selects instructions for the whole program a function at a time,
+        // allocating registers for each, runs the peephole optimiser over
+        // them if asked to, and prints them.
+        void generateAssembly(const std::vector<TAC>& tacCode, const BackendOptions &options, Statistics &stats) {
+            if (options.spillReport) *options.spillReport << "register allocation:" << std::endl;
+            for (const auto &code : splitFunctions(tacCode)) selectFunction(code, options, stats);
+
+            outfile << ".text\n";
+            outfile << ".globl main\n";
+            outfile << ".type main, @function\n";
+            for (auto &fn : functions) {
+                if (options.peephole) optimizePeephole(fn, stats);
+                for (const auto &mi : fn.code) {
+                    if (mi.isLabel()) {
+                        outfile << mi.operands[0] << ":\n";
+                        continue;
                     }
-                    outfile << "    sd " << mapToArgRegister(tac.arg1) << ", " 
-                            << varMap[tac.arg1] << "(s0)\n";
+                    outfile << "    " << mi.op;
+                    for (size_t k = 0; k < mi.operands.size(); k++) outfile << (k ? ", " : " ") << mi.operands[k];
+                    outfile << "\n";
+                }
+            }
+
+            // Jump tables hold the addresses of their targets
+            if (!jumpTables.empty()) {
+                outfile << ".section .rodata\n";
+                outfile << ".align 3\n";
+                for (size_t t = 0; t < jumpTables.size(); t++) {
+                    outfile << ".LJT" << t << ":\n";
+                    for (const auto &target : jumpTables[t]) outfile << "    .dword " << target << "\n";
                 }
             }
         }
@@ -0,0 +1,65 @@
+#include "TailRecursion.h"
+#include "Dataflow.h"
+
+// Whether the block returns the result of calling `name` with `params`
+// arguments, as its last two instructions.
+static bool endsInTailCall(const std::vector<TAC> &code, const std::string &name, size_t params) {
+    size_t n = code.size();
+    if (n < 2 || code[n - 1].op != "RETURN" || code[n - 2].op != "call") return false;
+    const TAC &call = code[n - 2];
+    if (call.arg1 != name || call.result.empty() || code[n - 1].arg1 != call.result) return false;
+    size_t args = 0;
+    while (args < n - 2 && code[n - 3 - args].op == "arg") args++;
+    return args == params;
+}
+
+void eliminateTailRecursion(Module &module, Function &fn, Statistics &stats) {
+    if (fn.ssa) return; // Each iteration assigns the parameters again
+    std::vector<TAC> params;
+    for (const auto &tac : fn.blocks[0].code) {
+        if (tac.op != "param") break;
+        params.push_back(tac);
+    }
+    bool any = false;
+    for (const auto &bb : fn.blocks) any |= endsInTailCall(bb.code, fn.name, params.size());
+    if (!any) return;
+    std::vector<std::string> reset = variablesReadBeforeWritten(fn);
+
+    // The loop starts after the params
+    BasicBlock body;
+    body.label = module.newLabel();
+    auto &entry = fn.blocks[0].code;
+    body.code.assign(entry.begin() + params.size(), entry.end());
+    entry.erase(entry.begin() + params.size(), entry.end());
+    entry.push_back(TAC("jmp", "", "", body.label));
+    fn.blocks.insert(fn.blocks.begin() + 1, std::move(body));
+
+    long calls = 0;
+    for (auto &bb : fn.blocks) {
+        auto &code = bb.code;
+        if (!endsInTailCall(code, fn.name, params.size())) continue;
+        size_t first = code.size() - 2 - params.size();
+        // Parameters kept in registers are assigned all at once, as the
+        // arguments may read them
+        std::vector<TAC> jump, assign;
+        for (size_t k = 0; k < params.size(); k++) {
+            const std::string &arg = code[first + k].arg1;
+            if (params[k].result.empty()) {
+                jump.push_back(TAC("store", arg, "", params[k].arg1));
+                continue;
+            }
+            std::string staged = module.newTemp();
+            jump.push_back(TAC("move", arg, "", staged));
+            assign.push_back(TAC("move", staged, "", params[k].result));
+        }
+        jump.insert(jump.end(), assign.begin(), assign.end());
+        for (const auto &v : reset) jump.push_back(TAC("store", "0", "", v));
+        jump.push_back(TAC("jmp", "", "", fn.blocks[1].label));
+        code.erase(code.begin() + first, code.end());
+        code.insert(code.end(), jump.begin(), jump.end());
+        calls++;
+    }
+    fn.recomputeEdges();
+
+    stats.add("tailrec", fn.name, "tail calls eliminated", calls);
+}
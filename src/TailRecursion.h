@@ -0,0 +1,19 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Tail recursion elimination, before SSA construction: a function returning
+// the result of calling itself,
+//
+//     arg a; arg b; call f t; RETURN t
+//
+// stores the arguments to its parameters and jumps back to the start of its
+// body instead, so the recursion runs as a loop in one frame. The entry
+// block is split after the `param`s to give the jump a target. Variables
+// the body may read before writing are reset to zero at each jump, as a
+// fresh frame would have them.
+//
+// Tail calls to other functions are left to the backend, which turns a
+// call whose result is returned at once into a `tail` jump.
+void eliminateTailRecursion(Module &module, Function &fn, Statistics &stats);
@@ -0,0 +1,282 @@
+#include "Unroll.h"
+#include "ScalarEvolution.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+typedef std::unordered_map<std::string, std::string> Renaming;
+
+std::string renamed(const Renaming &names, const std::string &s) {
+    auto it = names.find(s);
+    return it == names.end() ? s : it->second;
+}
+
+// One copy of a loop's blocks, the header first. The caller fills in the
+// labels of all the blocks and the names of the header phis, which the copy
+// does not repeat; the other registers the loop defines get fresh names.
+// The back edge goes to `next`. The exiting block drops its test and goes on
+// inside the loop, or to `leave` when that is given.
+std::vector<BasicBlock> cloneIteration(Module &module, const Function &fn, const Loop &loop, const ExitTest &test,
+                                       const Renaming &labels, Renaming &names, const std::string &next,
+                                       const std::string &leave) {
+    const std::string &header = fn.blocks[loop.header].label;
+    for (int b : loop.blocks) {
+        for (const auto &tac : fn.blocks[b].code) {
+            if (b != loop.header || tac.op != "phi") {
+                if (!tacDef(tac).empty()) names[tac.result] = module.newTemp();
+            }
+        }
+    }
+    auto target = [&](const std::string &label) { return label == header ? next : renamed(labels, label); };
+
+    std::vector<int> order = {loop.header};
+    for (int b : loop.blocks) {
+        if (b != loop.header) order.push_back(b);
+    }
+    std::vector<BasicBlock> copy;
+    for (int b : order) {
+        const auto &code = fn.blocks[b].code;
+        BasicBlock bb;
+        bb.label = labels.at(fn.blocks[b].label);
+        for (const auto &tac : code) {
+            if (tac.op == "phi" && b == loop.header) continue;
+            if (b == test.exiting && (isCondBranch(tac.op) || tac.op == "jmp")) continue;
+            TAC c = tac;
+            if (c.op == "phi") {
+                for (auto &[label, value] : c.phiArgs) {
+                    label = labels.at(label);
+                    value = renamed(names, value);
+                }
+            } else {
+                forEachUse(c, [&](std::string &u) { u = renamed(names, u); });
+            }
+            forEachTarget(c, [&](std::string &t) { t = target(t); });
+            if (!tacDef(c).empty()) {
+                c.result = names.at(c.result);
+            }
+            bb.code.push_back(c);
+        }
+        if (b == test.exiting) {
+            const TAC &branch = code[code.size() - 2];
+            std::string stay = loop.contains(fn.findBlock(branchTarget(branch))) ? branchTarget(branch) : code.back().result;
+            bb.code.push_back(TAC("jmp", "", "", leave.empty() ? target(stay) : leave));
+        }
+        copy.push_back(std::move(bb));
+    }
+    return copy;
+}
+
+Renaming freshLabels(Module &module, const Function &fn, const Loop &loop) {
+    Renaming labels;
+    for (int b : loop.blocks) labels[fn.blocks[b].label] = module.newLabel();
+    return labels;
+}
+
+int loopSize(const Function &fn, const Loop &loop) {
+    int size = 0;
+    for (int b : loop.blocks) {
+        for (const auto &tac : fn.blocks[b].code) size += tac.op != "phi";
+    }
+    return size;
+}
+
+} // namespace
+
+void unrollLoops(Module &module, Function &fn, Statistics &stats, int factor, int sizeLimit) {
+    if (!fn.ssa) return;
+    DominatorTree dt = computeDominators(fn);
+    if (findLoops(fn, dt).loops.empty()) return;
+    insertPreheaders(module, fn);
+    insertDedicatedExits(module, fn);
+    dt = computeDominators(fn);
+    LoopInfo info = findLoops(fn, dt);
+    ScalarEvolution se(fn, info);
+    size_t n = fn.blocks.size();
+
+    std::vector<char> innermost(info.loops.size(), 1);
+    for (const auto &loop : info.loops) {
+        if (loop.parent >= 0) innermost[loop.parent] = 0;
+    }
+
+    // New blocks go after the preheaders, once every loop is done, so the
+    // indices the analysis holds stay valid
+    std::vector<std::vector<BasicBlock>> added(n);
+    Renaming final; // Register read after a fully unrolled loop -> its last copy
+    std::vector<int> removed;
+    long full = 0, partial = 0, runtime = 0;
+    for (size_t l = 0; l < info.loops.size(); l++) {
+        const Loop &loop = info.loops[l];
+        int pre = findPreheader(fn, loop);
+        ExitTest test;
+        if (!innermost[l] || pre < 0 || fn.blocks[pre].code.back().op != "jmp" || !se.exitTest(l, test) ||
+            fn.blocks[test.exit].preds.size() != 1) {
+            continue;
+        }
+        int size = loopSize(fn, loop);
+        int64_t count = 0;
+        bool constant = ScalarEvolution::constantTripCount(test, count);
+        const BasicBlock &header = fn.blocks[loop.header];
+        const std::string &latch = fn.blocks[loop.latches[0]].label;
+        auto phiArg = [&](const TAC &phi, const std::string &label) {
+            for (const auto &[from, value] : phi.phiArgs) {
+                if (from == label) return value;
+            }
+            return std::string("0");
+        };
+
+        if (constant && count < sizeLimit && (count + 1) * size <= sizeLimit) {
+            std::vector<Renaming> labels;
+            for (int64_t k = 0; k <= count; k++) labels.push_back(freshLabels(module, fn, loop));
+            Renaming names;
+            for (const auto &tac : header.code) {
+                if (tac.op == "phi") names[tac.result] = phiArg(tac, fn.blocks[pre].label);
+            }
+            for (int64_t k = 0; k <= count; k++) {
+                bool last = k == count;
+                std::string next = labels[last ? k : k + 1].at(header.label);
+                auto copy = cloneIteration(module, fn, loop, test, labels[k], names, next,
+                                           last ? fn.blocks[test.exit].label : "");
+                for (auto &bb : copy) added[pre].push_back(std::move(bb));
+                if (last) break;
+                Renaming following;
+                for (const auto &tac : header.code) {
+                    if (tac.op == "phi") following[tac.result] = renamed(names, phiArg(tac, latch));
+                }
+                names = std::move(following);
+            }
+
+            // The last copy's values are the ones leaving the loop
+            for (int b : loop.blocks) {
+                for (const auto &tac : fn.blocks[b].code) {
+                    if (!tacDef(tac).empty()) final[tac.result] = renamed(names, tac.result);
+                }
+            }
+            for (auto &tac : fn.blocks[test.exit].code) {
+                if (tac.op != "phi") break;
+                for (auto &arg : tac.phiArgs) {
+                    if (arg.first == fn.blocks[test.exiting].label) arg.first = labels[count].at(arg.first);
+                }
+            }
+            fn.blocks[pre].code.back().result = labels[0].at(header.label);
+            removed.push_back(l);
+            full++;
+            continue;
+        }
+
+        int f = factor;
+        while (f > 1 && f * size > sizeLimit) f /= 2;
+        if (f < 2 || (constant && count < f)) continue;
+        int shift = 0;
+        while ((1 << shift) < f) shift++;
+
+        // Iterations of the unrolled loop, n / f, in the preheader
+        std::vector<TAC> code;
+        auto constantReg = [&](int64_t v) {
+            std::string t = module.newTemp();
+            code.push_back(TAC("li", std::to_string(v), "", t));
+            return t;
+        };
+        std::string times;
+        if (constant) {
+            times = constantReg(count >> shift);
+        } else {
+            std::string total = runtimeTripCount(module, test, code);
+            if (total.empty()) continue;
+            std::string shifted = module.newTemp();
+            code.push_back(TAC(">>", total, constantReg(shift), shifted));
+            times = module.newTemp();
+            code.push_back(TAC("&", shifted, constantReg(INT64_MAX), times)); // Logical shift
+            runtime++;
+        }
+
+        // Unrolled loop: a counting header, then f copies back to back
+        std::vector<Renaming> labels;
+        for (int k = 0; k < f; k++) labels.push_back(freshLabels(module, fn, loop));
+        std::string top = module.newLabel(), remainder = module.newLabel();
+        std::string counter = module.newTemp(), decremented = module.newTemp();
+        BasicBlock head;
+        head.label = top;
+        Renaming names, entering; // Header phi -> value in the first copy; -> unrolled loop's phi
+        for (const auto &tac : header.code) {
+            if (tac.op != "phi") continue;
+            names[tac.result] = entering[tac.result] = module.newTemp();
+        }
+        for (int k = 0; k < f; k++) {
+            std::string next = k + 1 < f ? labels[k + 1].at(header.label) : top;
+            auto copy = cloneIteration(module, fn, loop, test, labels[k], names, next, "");
+            for (auto &bb : copy) added[pre].push_back(std::move(bb));
+            Renaming following;
+            for (const auto &tac : header.code) {
+                if (tac.op == "phi") following[tac.result] = renamed(names, phiArg(tac, latch));
+            }
+            names = std::move(following);
+        }
+        std::string last = labels[f - 1].at(latch);
+        for (const auto &tac : header.code) {
+            if (tac.op != "phi") continue;
+            TAC phi("phi", "", "", entering[tac.result]);
+            phi.phiArgs = {{fn.blocks[pre].label, phiArg(tac, fn.blocks[pre].label)}, {last, names.at(tac.result)}};
+            head.code.push_back(phi);
+        }
+        TAC countdown("phi", "", "", counter);
+        countdown.phiArgs = {{fn.blocks[pre].label, times}, {last, decremented}};
+        head.code.push_back(countdown);
+        head.code.push_back(TAC("-", counter, constantReg(1), decremented));
+        head.code.push_back(TAC("beqz", counter, remainder, ""));
+        head.code.push_back(TAC("jmp", "", "", labels[0].at(header.label)));
+        added[pre].insert(added[pre].begin(), std::move(head));
+
+        // The original loop finishes off the iterations left
+        BasicBlock enter;
+        enter.label = remainder;
+        enter.code.push_back(TAC("jmp", "", "", header.label));
+        added[pre].push_back(std::move(enter));
+        for (auto &tac : fn.blocks[loop.header].code) {
+            if (tac.op != "phi") break;
+            for (auto &[label, value] : tac.phiArgs) {
+                if (label != fn.blocks[pre].label) continue;
+                label = remainder;
+                value = entering.at(tac.result);
+            }
+        }
+        auto &preCode = fn.blocks[pre].code;
+        preCode.insert(preCode.end() - 1, code.begin(), code.end());
+        preCode.back().result = top;
+        partial++;
+    }
+    if (!full && !partial) return;
+
+    std::unordered_set<std::string> gone; // Blocks of the fully unrolled loops
+    for (int l : removed) {
+        for (int b : info.loops[l].blocks) gone.insert(fn.blocks[b].label);
+    }
+    std::vector<BasicBlock> blocks;
+    for (size_t b = 0; b < n; b++) {
+        blocks.push_back(std::move(fn.blocks[b]));
+        for (auto &bb : added[b]) blocks.push_back(std::move(bb));
+    }
+    fn.blocks = std::move(blocks);
+
+    // Reads after a fully unrolled loop take the last copy's values, which
+    // may themselves come from a loop unrolled before it
+    auto resolve = [&](std::string &u) {
+        for (auto f = final.find(u); f != final.end(); f = final.find(u)) u = f->second;
+    };
+    for (auto &bb : fn.blocks) {
+        if (gone.count(bb.label)) continue;
+        for (auto &tac : bb.code) {
+            if (tac.op == "phi") {
+                for (auto &arg : tac.phiArgs) resolve(arg.second);
+            } else {
+                forEachUse(tac, resolve);
+            }
+        }
+    }
+    fn.recomputeEdges();
+    removeUnreachableBlocks(fn);
+
+    stats.add("unroll-loops", fn.name, "loops fully unrolled", full);
+    stats.add("unroll-loops", fn.name, "loops partly unrolled", partial);
+    stats.add("unroll-loops", fn.name, "runtime trip counts", runtime);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Loop unrolling over SSA form, for innermost loops whose trip count
+// ScalarEvolution.h works out, as a constant or at run time.
+//
+// Sizes count the instructions of the loop other than phis.
+//
+// - Full unrolling: with a constant count n and (n + 1) copies of the loop
+//   within sizeLimit, the loop becomes n + 1 copies of its body in a row.
+//   The exit test disappears from all of them: the first n go on to the
+//   next copy and the last one leaves. Uses after the loop read the last
+//   copy's values.
+// - Partial unrolling: otherwise the loop is unrolled by `factor` (a power of
+//   two), halved until that many copies fit in sizeLimit. An unrolled loop
+//   runs the copies back to back, without their exit tests, n / factor
+//   times, counting down a register set in the preheader. The original loop
+//   follows as the remainder loop and runs the last n % factor iterations,
+//   testing as before, so uses after the loop are unchanged.
+//
+// Each copy renames the registers it defines; the header phis of the first
+// copy take the values entering the loop, and those of the later copies the
+// values the previous copy sends round the back edge.
+void unrollLoops(Module &module, Function &fn, Statistics &stats, int factor, int sizeLimit);
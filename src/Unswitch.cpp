@@ -0,0 +1,177 @@
+#include "Unswitch.h"
+#include "Loops.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+typedef std::unordered_map<std::string, std::string> Renaming;
+
+std::string renamed(const Renaming &names, const std::string &s) {
+    auto it = names.find(s);
+    return it == names.end() ? s : it->second;
+}
+
+// The block ending in a branch the loop can be unswitched on: both targets
+// in the loop and no operand defined in it. Returns -1 if there is none.
+int invariantBranch(const Function &fn, const Loop &loop, const std::unordered_set<std::string> &defined) {
+    for (int b : loop.blocks) {
+        const auto &code = fn.blocks[b].code;
+        if (code.size() < 2 || !isCondBranch(code[code.size() - 2].op) || code.back().op != "jmp") continue;
+        const TAC &branch = code[code.size() - 2];
+        int taken = fn.findBlock(branchTarget(branch)), other = fn.findBlock(code.back().result);
+        if (taken == other || !loop.contains(taken) || !loop.contains(other)) continue;
+        bool invariant = true;
+        forEachUse(branch, [&](const std::string &u) { invariant &= !defined.count(u); });
+        if (invariant) return b;
+    }
+    return -1;
+}
+
+// Copies the loop after its last block, with the copy taking the branch at
+// `at` the other way, and makes the preheader choose between the two.
+void unswitch(Module &module, Function &fn, const Loop &loop, int pre, int exit, int at) {
+    Renaming labels, names;
+    for (int b : loop.blocks) {
+        labels[fn.blocks[b].label] = module.newLabel();
+        for (const auto &tac : fn.blocks[b].code) {
+            if (!tacDef(tac).empty()) names[tac.result] = module.newTemp();
+        }
+    }
+
+    std::vector<BasicBlock> copy;
+    for (int b : loop.blocks) {
+        BasicBlock bb;
+        bb.label = labels.at(fn.blocks[b].label);
+        for (TAC tac : fn.blocks[b].code) {
+            if (tac.op == "phi") {
+                for (auto &[label, value] : tac.phiArgs) {
+                    label = renamed(labels, label);
+                    value = renamed(names, value);
+                }
+            } else {
+                forEachUse(tac, [&](std::string &u) { u = renamed(names, u); });
+            }
+            forEachTarget(tac, [&](std::string &target) { target = renamed(labels, target); });
+            if (!tacDef(tac).empty()) {
+                tac.result = names.at(tac.result);
+            }
+            bb.code.push_back(tac);
+        }
+        copy.push_back(std::move(bb));
+    }
+
+    // The original loop takes the branch, the copy falls through
+    auto &code = fn.blocks[at].code;
+    TAC branch = code[code.size() - 2];
+    std::string other = code.back().result;
+    code.erase(code.end() - 2, code.end());
+    code.push_back(TAC("jmp", "", "", branchTarget(branch)));
+    auto &copied = copy[std::lower_bound(loop.blocks.begin(), loop.blocks.end(), at) - loop.blocks.begin()].code;
+    copied.erase(copied.end() - 2, copied.end());
+    copied.push_back(TAC("jmp", "", "", labels.at(other)));
+
+    const std::string &header = fn.blocks[loop.header].label;
+    auto &preCode = fn.blocks[pre].code;
+    preCode.pop_back();
+    setBranchTarget(branch, header);
+    preCode.push_back(branch);
+    preCode.push_back(TAC("jmp", "", "", labels.at(header)));
+
+    // The exit is entered from both copies: its phis take the copy's values
+    // on the new edges, and registers of the loop read further on get a phi
+    auto &exitCode = fn.blocks[exit].code;
+    size_t phis = 0;
+    for (; phis < exitCode.size() && exitCode[phis].op == "phi"; phis++) {
+        auto &args = exitCode[phis].phiArgs;
+        size_t count = args.size();
+        for (size_t i = 0; i < count; i++) args.push_back({labels.at(args[i].first), renamed(names, args[i].second)});
+    }
+    Renaming merged;
+    std::vector<TAC> added;
+    for (size_t b = 0; b < fn.blocks.size(); b++) {
+        if (loop.contains(b)) continue;
+        auto &body = fn.blocks[b].code;
+        for (size_t i = (int)b == exit ? phis : 0; i < body.size(); i++) {
+            forEachUse(body[i], [&](std::string &u) {
+                if (!names.count(u)) return;
+                if (!merged.count(u)) {
+                    TAC phi("phi", "", "", module.newTemp());
+                    for (int p : fn.blocks[exit].preds) {
+                        const std::string &from = fn.blocks[p].label;
+                        phi.phiArgs.push_back({from, u});
+                        phi.phiArgs.push_back({labels.at(from), names.at(u)});
+                    }
+                    merged[u] = phi.result;
+                    added.push_back(phi);
+                }
+                u = merged.at(u);
+            });
+        }
+    }
+    exitCode.insert(exitCode.begin() + phis, added.begin(), added.end());
+
+    fn.blocks.insert(fn.blocks.begin() + loop.blocks.back() + 1, copy.begin(), copy.end());
+}
+
+} // namespace
+
+void unswitchLoops(Module &module, Function &fn, Statistics &stats, int budget) {
+    if (!fn.ssa) return;
+    DominatorTree dt = computeDominators(fn);
+    if (findLoops(fn, dt).loops.empty()) return;
+
+    // One loop at a time, as each changes the blocks the analysis describes
+    long unswitched = 0, copied = 0;
+    for (bool changed = true; changed;) {
+        changed = false;
+        insertPreheaders(module, fn);
+        insertDedicatedExits(module, fn);
+        dt = computeDominators(fn);
+        LoopInfo info = findLoops(fn, dt);
+        std::vector<char> innermost(info.loops.size(), 1);
+        for (const auto &loop : info.loops) {
+            if (loop.parent >= 0) innermost[loop.parent] = 0;
+        }
+
+        for (size_t l = 0; l < info.loops.size() && !changed; l++) {
+            const Loop &loop = info.loops[l];
+            int pre = findPreheader(fn, loop);
+            std::vector<int> exits = exitBlocks(fn, loop);
+            if (!innermost[l] || pre < 0 || exits.size() != 1) continue;
+            long size = 0;
+            std::unordered_set<std::string> defined;
+            for (int b : loop.blocks) {
+                for (const auto &tac : fn.blocks[b].code) {
+                    size++;
+                    if (!tacDef(tac).empty()) defined.insert(tac.result);
+                }
+            }
+            int at;
+            if (copied + size > budget || (at = invariantBranch(fn, loop, defined)) < 0) continue;
+
+            unswitch(module, fn, loop, pre, exits[0], at);
+            fn.recomputeEdges();
+            removeUnreachableBlocks(fn);
+
+            // Phis lose the operands of the edges taken out
+            for (auto &bb : fn.blocks) {
+                for (auto &tac : bb.code) {
+                    if (tac.op != "phi") break;
+                    auto &args = tac.phiArgs;
+                    args.erase(std::remove_if(args.begin(), args.end(), [&](const auto &arg) {
+                                   return std::none_of(bb.preds.begin(), bb.preds.end(),
+                                                       [&](int p) { return fn.blocks[p].label == arg.first; });
+                               }),
+                               args.end());
+                }
+            }
+            unswitched++;
+            copied += size;
+            changed = true;
+        }
+    }
+
+    stats.add("unswitch", fn.name, "loops unswitched", unswitched);
+    stats.add("unswitch", fn.name, "instructions copied", copied);
+}
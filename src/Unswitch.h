@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CFG.h"
+#include "Statistics.h"
+
+// Loop unswitching over SSA form: a conditional branch inside a loop whose
+// operands are all defined outside it, such as `if (mode == K)` once LICM
+// has hoisted the comparison, takes the same way on every iteration. The
+// loop is copied, the branch moves to the preheader and picks the copy, and
+// each copy jumps straight to its own side:
+//
+//     pre: jmp head   ...   c: bnez t A; jmp B
+//
+// becomes
+//
+//     pre: bnez t head; jmp head'   ...   c: jmp A   ...   c': jmp B'
+//
+// Blocks only the other side reached then disappear from each copy.
+//
+// Innermost loops with a single, dedicated exit block qualify, for a branch
+// whose two targets are in the loop. Registers of the loop read after it
+// are merged by new phis in the exit block. Unswitching repeats while a
+// loop has such a branch, copies included, until the function has grown by
+// `budget` instructions; a loop that would take it past the budget is not
+// copied.
+void unswitchLoops(Module &module, Function &fn, Statistics &stats, int budget);
@@ -0,0 +1,372 @@
+#include "Verifier.h"
+#include "Dataflow.h"
+#include "Dominators.h"
+#include "Registers.h"
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+// What each field of an instruction must hold, as one character per field
+// (arg1, arg2, result):
+//   r  register read (or the literal 0)      d  register written
+//   ?  optional register read or write       v  stack variable
+//   l  label     f  function name     i  immediate
+//   -  empty     *  anything
+static const char *operandShape(const std::string &op) {
+    static const std::unordered_map<std::string, const char *> shapes = [] {
+        std::unordered_map<std::string, const char *> m = {
+            {"li", "i-d"}, {"load", "v-d"}, {"store", "r-v"}, {"param", "v-?"},
+            {"NEG", "r-d"}, {"~", "r-d"}, {"move", "r-d"}, {"seq", "r*d"},
+            {"call", "f-?"}, {"arg", "r--"}, {"RETURN", "r--"}, {"EXPR", "?--"},
+            {"phi", "--d"}, {"jmp", "--l"}, {"jtab", "r--"}, {"beqz", "rl-"}, {"bnez", "rl-"}, {"beq", "rrl"},
+            {"bne", "rrl"}, {"blt", "rrl"}, {"bgt", "rrl"}, {"bge", "rrl"}, {"ble", "rrl"}};
+        for (const char *op : {"+", "-", "*", "/", "%", "&", "|", "^", "<<", ">>",
+                               "&&", "||", "==", "!=", "<", ">", "<=", ">=", "mulh"}) {
+            m[op] = "rrd";
+        }
+        return m;
+    }();
+    auto it = shapes.find(op);
+    return it == shapes.end() ? nullptr : it->second;
+}
+
+static bool operandMatches(char kind, const std::string &s) {
+    switch (kind) {
+        case 'r': return !s.empty() && (!isImmediate(s) || s == "0");
+        case 'd':
+        case 'v': return !s.empty() && !isImmediate(s);
+        case '?': return s.empty() || !isImmediate(s);
+        case 'l':
+        case 'f': return !s.empty();
+        case 'i': return isImmediate(s);
+        case '-': return s.empty();
+        default: return true;
+    }
+}
+
+static std::string describe(const TAC &tac) {
+    std::string s = "'" + tac.op;
+    for (const auto *f : {&tac.arg1, &tac.arg2, &tac.result}) {
+        s += " " + (f->empty() ? std::string(".") : *f);
+    }
+    return s + "'";
+}
+
+struct FunctionVerifier {
+    const Function &fn;
+    std::vector<std::string> &errors;
+    std::unordered_map<std::string, size_t> paramCounts; // Per function in the module
+
+    void error(int block, int instr, const std::string &message) {
+        std::string where = fn.name;
+        if (block >= 0) where += ": " + fn.blocks[block].label;
+        if (instr >= 0) where += ": " + describe(fn.blocks[block].code[instr]);
+        errors.push_back(where + ": " + message);
+    }
+
+    void checkLabels(std::unordered_map<std::string, int> &index) {
+        for (size_t b = 0; b < fn.blocks.size(); b++) {
+            const auto &label = fn.blocks[b].label;
+            if (label.empty()) {
+                error(b, -1, "block has no label");
+            } else if (!index.emplace(label, b).second) {
+                error(b, -1, "duplicate block label");
+            }
+        }
+    }
+
+    void checkInstructions(const std::unordered_map<std::string, int> &index) {
+        for (size_t b = 0; b < fn.blocks.size(); b++) {
+            const auto &code = fn.blocks[b].code;
+            size_t n = code.size();
+            bool lastBlock = b + 1 == fn.blocks.size();
+            if (!lastBlock && (n == 0 || !isTerminator(code.back()))) {
+                error(b, -1, "block falls through without a terminator");
+            }
+
+            for (size_t i = 0; i < n; i++) {
+                const TAC &tac = code[i];
+                const char *shape = operandShape(tac.op);
+                if (!shape) {
+                    error(b, i, tac.op == "label" || tac.op == "function"
+                                    ? "'" + tac.op + "' inside a block"
+                                    : "unknown op");
+                    continue;
+                }
+                const std::string *fields[] = {&tac.arg1, &tac.arg2, &tac.result};
+                for (int f = 0; f < 3; f++) {
+                    if (!operandMatches(shape[f], *fields[f])) {
+                        error(b, i, "malformed operand " + std::to_string(f + 1));
+                    }
+                }
+
+                // Control flow may only leave at the end of the block
+                bool terminator = isTerminator(tac);
+                if (terminator && i + 1 != n) {
+                    error(b, i, "terminator in the middle of a block");
+                }
+                const std::string *target = shape[1] == 'l' ? &tac.arg2 : shape[2] == 'l' ? &tac.result : nullptr;
+                if (target && !terminator && !(i + 2 == n && code[i + 1].op == "jmp")) {
+                    error(b, i, "conditional branch not followed by the block's closing jmp");
+                }
+                if (target && !index.count(*target)) {
+                    error(b, i, "branch to missing label " + *target);
+                }
+
+                if (tac.op == "jtab") {
+                    if (tac.targets.empty()) error(b, i, "jump table without targets");
+                    for (const auto &t : tac.targets) {
+                        if (!index.count(t)) error(b, i, "branch to missing label " + t);
+                    }
+                }
+
+                if (tac.op == "param" && (b != 0 || (i > 0 && code[i - 1].op != "param"))) {
+                    error(b, i, "param outside the function prologue");
+                }
+                if (tac.op == "arg" && (i + 1 == n || (code[i + 1].op != "arg" && code[i + 1].op != "call"))) {
+                    error(b, i, "arg not followed by a call");
+                }
+                if (tac.op == "call") checkCall(b, i);
+                if (tac.op == "phi") checkPhi(b, i);
+            }
+        }
+    }
+
+    void checkCall(int b, int i) {
+        const auto &code = fn.blocks[b].code;
+        auto it = paramCounts.find(code[i].arg1);
+        if (it == paramCounts.end()) {
+            error(b, i, "call to undefined function");
+            return;
+        }
+        size_t args = 0;
+        while (args < (size_t)i && code[i - 1 - args].op == "arg") args++;
+        if (args != it->second) {
+            error(b, i, "call passes " + std::to_string(args) + " arguments, " +
+                            code[i].arg1 + " takes " + std::to_string(it->second));
+        }
+    }
+
+    // Phis open the block, in SSA form only, with one register per
+    // predecessor.
+    void checkPhi(int b, int i) {
+        const auto &bb = fn.blocks[b];
+        if (!fn.ssa) error(b, i, "phi outside SSA form");
+        if (i > 0 && bb.code[i - 1].op != "phi") error(b, i, "phi after the start of the block");
+
+        const auto &args = bb.code[i].phiArgs;
+        std::vector<std::string> expected, actual;
+        for (int p : bb.preds) {
+            if (p >= 0 && (size_t)p < fn.blocks.size()) expected.push_back(fn.blocks[p].label);
+        }
+        for (const auto &[label, value] : args) {
+            actual.push_back(label);
+            if (!operandMatches('r', value)) error(b, i, "malformed phi operand for " + label);
+        }
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        if (actual != expected) error(b, i, "phi operands do not match the predecessors");
+    }
+
+    // succs/preds must be what recomputeEdges() would derive.
+    void checkEdges(const std::unordered_map<std::string, int> &index) {
+        std::vector<size_t> predCount(fn.blocks.size(), 0);
+        for (size_t b = 0; b < fn.blocks.size(); b++) {
+            const auto &bb = fn.blocks[b];
+            std::vector<int> expected, actual;
+            size_t n = bb.code.size();
+            for (size_t k = n >= 2 ? n - 2 : 0; k < n; k++) {
+                forEachTarget(bb.code[k], [&](const std::string &target) {
+                    auto it = index.find(target);
+                    if (it != index.end()) expected.push_back(it->second);
+                });
+            }
+            bool inRange = true;
+            for (int s : bb.succs) {
+                if (s < 0 || (size_t)s >= fn.blocks.size()) {
+                    inRange = false;
+                    break;
+                }
+                actual.push_back(s);
+                predCount[s]++;
+                const auto &preds = fn.blocks[s].preds;
+                if (std::find(preds.begin(), preds.end(), (int)b) == preds.end()) {
+                    error(b, -1, "successor " + fn.blocks[s].label + " does not list it as a predecessor");
+                }
+            }
+            std::sort(expected.begin(), expected.end());
+            expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+            std::sort(actual.begin(), actual.end());
+            if (!inRange || actual != expected) {
+                error(b, -1, "successor list does not match the terminators");
+            }
+        }
+        for (size_t b = 0; b < fn.blocks.size(); b++) {
+            if (fn.blocks[b].preds.size() != predCount[b]) {
+                error(b, -1, "predecessor list does not match the edges");
+            }
+        }
+    }
+
+    // Every use must be preceded by a definition on all paths from the entry.
+    // Uses after a definition in the same block are settled at once. A
+    // register defined in a single block reaches the rest of its uses exactly
+    // where that block strictly dominates them. The registers defined in
+    // several blocks (promoted variables, and the values `?:` and `&&`/`||`
+    // merge at a join) share one forward bit-vector problem instead: which of
+    // them may still be undefined on entry to each block. A phi operand is
+    // read at the end of its predecessor. In SSA form each register also has
+    // exactly one definition.
+    void checkDefinitions() {
+        size_t n = fn.blocks.size();
+        RegisterNumbering regs(fn);
+        std::vector<std::vector<int>> defBlocks;        // Per register
+        std::vector<int> definedIn;                     // Last block seen defining each register
+        std::vector<std::tuple<int, int, int>> exposed; // (block, instr, register)
+        std::vector<std::tuple<int, int, int, int>> phiUses; // (block, instr, register, predecessor)
+        std::unordered_map<std::string, int> index;
+        for (size_t b = 0; b < n; b++) index.emplace(fn.blocks[b].label, b);
+
+        auto intern = [&](const std::string &name) {
+            int id = regs.id(name);
+            if ((size_t)id == defBlocks.size()) {
+                defBlocks.emplace_back();
+                definedIn.push_back(-1);
+            }
+            return id;
+        };
+
+        std::vector<std::string> uses;
+        for (size_t b = 0; b < n; b++) {
+            const auto &code = fn.blocks[b].code;
+            for (size_t i = 0; i < code.size(); i++) {
+                if (code[i].op == "phi") {
+                    for (const auto &[label, value] : code[i].phiArgs) {
+                        auto it = index.find(label);
+                        if (it != index.end() && !isImmediate(value)) phiUses.emplace_back(b, i, intern(value), it->second);
+                    }
+                } else {
+                    uses.clear();
+                    tacUses(code[i], uses);
+                    for (const auto &u : uses) {
+                        int id = intern(u);
+                        if (definedIn[id] != (int)b) exposed.emplace_back(b, i, id);
+                    }
+                }
+                if (tacDef(code[i]).empty()) continue;
+                int id = intern(code[i].result);
+                if (fn.ssa && !defBlocks[id].empty()) {
+                    error(b, i, code[i].result + " defined more than once in SSA form");
+                }
+                if (definedIn[id] != (int)b) {
+                    definedIn[id] = b;
+                    defBlocks[id].push_back(b);
+                }
+            }
+        }
+
+        // A phi operand defined in its predecessor needs nothing more;
+        // otherwise it must reach the predecessor's entry. Blocks were
+        // visited in order, so each defBlocks list is sorted.
+        std::vector<std::pair<int, int>> phiExposed; // The phi behind each trailing entry of `exposed`
+        for (auto &[b, i, id, p] : phiUses) {
+            const auto &defs = defBlocks[id];
+            if (std::binary_search(defs.begin(), defs.end(), p)) continue;
+            exposed.emplace_back(p, -1, id);
+            phiExposed.push_back({b, i});
+        }
+        size_t firstPhiUse = exposed.size() - phiExposed.size();
+        if (exposed.empty()) return;
+
+        std::vector<int> tracked(defBlocks.size(), -1); // Bit of each multiply-defined register
+        size_t universe = 0;
+        for (const auto &[b, i, id] : exposed) {
+            if (defBlocks[id].size() > 1 && tracked[id] < 0) tracked[id] = universe++;
+        }
+        DataflowResult maybeUndefined;
+        if (universe) {
+            DataflowProblem p;
+            p.universe = universe;
+            p.gen.assign(n, BitVector(universe));
+            p.kill.assign(n, BitVector(universe));
+            p.boundary = BitVector(universe, true);
+            for (size_t id = 0; id < defBlocks.size(); id++) {
+                if (tracked[id] < 0) continue;
+                for (int d : defBlocks[id]) p.kill[d].set(tracked[id]);
+            }
+            maybeUndefined = solveDataflow(fn, p);
+        }
+
+        DominatorTree dom = computeDominators(fn);
+        for (size_t e = 0; e < exposed.size(); e++) {
+            auto [b, i, id] = exposed[e];
+            const std::string &reg = regs.name(id);
+            // Report phi operands at the phi
+            int at = b, instr = i;
+            if (e >= firstPhiUse) std::tie(at, instr) = phiExposed[e - firstPhiUse];
+            if (defBlocks[id].empty()) {
+                error(at, instr, "use of undefined register " + reg);
+                continue;
+            }
+            if (!dom.isReachable(b)) continue;
+
+            bool undefinedPath;
+            if (tracked[id] >= 0) {
+                undefinedPath = maybeUndefined.in[b].test(tracked[id]);
+            } else {
+                int d = defBlocks[id][0];
+                undefinedPath = d == b || !dom.dominates(d, b);
+            }
+            if (undefinedPath) error(at, instr, reg + " may be used before it is defined");
+        }
+    }
+
+    void run() {
+        if (fn.blocks.empty()) {
+            error(-1, -1, "function has no blocks");
+            return;
+        }
+        std::unordered_map<std::string, int> index;
+        checkLabels(index);
+        checkInstructions(index);
+        checkEdges(index);
+        checkDefinitions();
+    }
+};
+
+static std::unordered_map<std::string, size_t> countParams(const Module &module) {
+    std::unordered_map<std::string, size_t> counts;
+    for (const auto &fn : module.functions) {
+        size_t params = 0;
+        if (!fn.blocks.empty()) {
+            for (const auto &tac : fn.blocks[0].code) {
+                if (tac.op != "param") break;
+                params++;
+            }
+        }
+        counts[fn.name] = params;
+    }
+    return counts;
+}
+
+bool verifyFunction(const Module &module, const Function &fn, std::vector<std::string> &errors) {
+    size_t before = errors.size();
+    FunctionVerifier v{fn, errors, countParams(module)};
+    v.run();
+    return errors.size() == before;
+}
+
+bool verifyModule(const Module &module, std::vector<std::string> &errors) {
+    size_t before = errors.size();
+    std::unordered_set<std::string> names;
+    auto params = countParams(module);
+    for (const auto &fn : module.functions) {
+        if (!names.insert(fn.name).second) {
+            errors.push_back(fn.name + ": function defined twice");
+        }
+        FunctionVerifier v{fn, errors, params};
+        v.run();
+    }
+    return errors.size() == before;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "CFG.h"
+#include <string>
+#include <vector>
+
+// Structural checks on a Module, run between passes by `--verify-each`.
+//
+// A function is well formed when:
+//   - block labels are present and unique, and every branch targets one;
+//   - `jmp`/`RETURN` only end a block, a conditional branch is always
+//     followed by the block's closing `jmp`, and only the last block may
+//     fall off the end of the function;
+//   - the cached succs/preds agree with the terminators;
+//   - every instruction has the operands its op requires;
+//   - `param`s open the entry block, and a run of `arg`s is followed by the
+//     `call` that consumes them, matching the callee's parameter count;
+//   - every register use is reached by a definition on all paths;
+//   - phis appear only in SSA form, open their block and have one operand
+//     per predecessor, and in SSA form every register is defined once.
+//
+// All checks are linear in the size of the function, bar the definition
+// check for registers defined in more than one block, which is one bit-vector
+// dataflow problem over just those registers.
+
+bool verifyFunction(const Module &module, const Function &fn, std::vector<std::string> &errors);
+bool verifyModule(const Module &module, std::vector<std::string> &errors);
@@ -50,6 +50,8 @@ void Lexer::next(Token &token) {
       token.type = TokenType::CASE;
     }else if(value == "default"){
       token.type = TokenType::DEFAULT;
+    }else if(value == "inline"){
+      token.type = TokenType::INLINE;
     }else {
       token.type = TokenType::ID;
       token.value = value;
@@ -180,9 +182,15 @@ void Lexer::next(Token &token) {
     BufferPtr++;
     return;
   case '%':
-    token.type = TokenType::MOD;
-    token.line = line;
-    BufferPtr++;
+    if(*(BufferPtr + 1) == '='){
+      token.type = TokenType::MOD_EQUAL;
+      token.line = line;
+      BufferPtr += 2;
+    }else{
+      token.type = TokenType::MOD;
+      token.line = line;
+      BufferPtr++;
+    }
     return;
   case '}':
     token.type = TokenType::RIGHT_BRACE;
@@ -240,6 +248,7 @@ void Lexer::next(Token &token) {
       token.line = line;
       BufferPtr++;
     }
+    return;
   case '<':
     if(*(BufferPtr + 1) == '<'){
       if(*(BufferPtr + 2) == '='){
@@ -73,7 +73,9 @@ typedef enum{
 
     SWITCH,
     CASE,
-    DEFAULT
+    DEFAULT,
+
+    INLINE
 }TokenType;
 
 static string TokenStr[] = {
@@ -141,7 +143,9 @@ static string TokenStr[] = {
 
     "SWITCH",
     "CASE",
-    "DEFAULT"
+    "DEFAULT",
+
+    "INLINE"
 };
 
 typedef struct{
@@ -2,57 +2,299 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <chrono>
+#include <cstring>
 
 #include "lexer.h"
 #include "parser.h"
 #include "codeGen.h"
 #include "TAC_to_ASM.h"
+#include "CFG.h"
+#include "Dataflow.h"
+#include "RegAlloc.h"
+#include "Serialize.h"
+#include "Interpreter.h"
+#include "PassManager.h"
 
 using namespace std;
 
+// Times liveness, reaching definitions and available expressions on every
+// function of the program.
+static void benchDataflow(const std::vector<TAC> &tacCode) {
+    Module module = buildModule(tacCode);
+    for (const auto &fn : module.functions) {
+        size_t instrs = 0;
+        for (const auto &bb : fn.blocks) instrs += bb.code.size();
+        std::cerr << fn.name << ": " << fn.blocks.size() << " blocks, " << instrs << " instructions" << std::endl;
+
+        auto time = [](auto f) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        Liveness live;
+        ReachingDefs rd;
+        AvailableExprs ae;
+        double tl = time([&] { live = computeLiveness(fn); });
+        double tr = time([&] { rd = computeReachingDefs(fn); });
+        double ta = time([&] { ae = computeAvailableExprs(fn); });
+        std::cerr << "    liveness:       " << live.names.size() << " registers, " << live.sets.visits << " visits, " << tl << " ms" << std::endl;
+        std::cerr << "    reaching defs:  " << rd.defs.size() << " definitions, " << rd.sets.visits << " visits, " << tr << " ms" << std::endl;
+        std::cerr << "    available expr: " << ae.exprs.size() << " expressions, " << ae.sets.visits << " visits, " << ta << " ms" << std::endl;
+    }
+}
+
+// Runs both register allocators over every function of the optimised code
+// and compares the moves and spills they leave.
+static void benchRegAlloc(const std::vector<TAC> &tacCode) {
+    const RegisterAllocator allocators[] = {RegisterAllocator::LinearScan, RegisterAllocator::IteratedCoalescing};
+    const char *names[] = {"linear scan:", "coalescing: "};
+    AllocationSummary total[2];
+    for (const auto &code : splitFunctions(tacCode)) {
+        LiveRanges ranges = computeLiveRanges(code);
+        InterferenceGraph graph = buildInterference(ranges);
+        std::cerr << code[0].arg1 << ": " << ranges.intervals.size() << " intervals, " << graph.edges
+                  << " interferences, " << graph.moves.size() << " moves" << std::endl;
+        for (int a = 0; a < 2; a++) {
+            auto start = std::chrono::steady_clock::now();
+            Allocation alloc = allocateRegisters(ranges, allocators[a]);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            AllocationSummary sum = summarizeAllocation(ranges, alloc);
+            std::cerr << "    " << names[a] << " " << sum.movesLeft << " moves left, " << sum.spilled << " spilled, "
+                      << sum.rematerialised << " rematerialised, spill cost " << sum.spillCost << ", "
+                      << sum.registers << " registers, " << ms << " ms" << std::endl;
+            total[a].moves += sum.moves;
+            total[a].movesLeft += sum.movesLeft;
+            total[a].spilled += sum.spilled;
+            total[a].rematerialised += sum.rematerialised;
+            total[a].spillCost += sum.spillCost;
+        }
+    }
+    for (int a = 0; a < 2; a++) {
+        std::cerr << "total " << names[a] << " " << total[a].movesLeft << " of " << total[a].moves << " moves left, "
+                  << total[a].spilled << " spilled, " << total[a].rematerialised << " rematerialised, spill cost "
+                  << total[a].spillCost << std::endl;
+    }
+}
+
 int main(int argc, char ** argv){
-    if(argc <2){
+    const char *inputPath = nullptr;
+    const char *outputPath = nullptr;
+    std::string emit = "asm"; // asm, tac or tac-bin
+    bool fromTAC = false;
+    bool benchFlow = false;
+    bool runInterp = false;
+    bool spillReport = false;
+    bool benchAlloc = false;
+    std::string regalloc; // linear-scan or irc; by default, irc from -O2
+    PassOptions passOptions;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bench-dataflow")) {
+            benchFlow = true;
+        } else if (!strcmp(argv[i], "--bench-regalloc")) {
+            benchAlloc = true;
+        } else if (!strncmp(argv[i], "--regalloc=", 11)) {
+            regalloc = argv[i] + 11;
+            if (regalloc != "linear-scan" && regalloc != "irc") {
+                std::cerr << "Unknown --regalloc engine: " << regalloc << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (!strncmp(argv[i], "--emit=", 7)) {
+            emit = argv[i] + 7;
+            if (emit != "asm" && emit != "tac" && emit != "tac-bin") {
+                std::cerr << "Unknown --emit kind: " << emit << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (!strncmp(argv[i], "--emit-after=", 13)) {
+            passOptions.emitAfter = argv[i] + 13;
+        } else if (!strcmp(argv[i], "--run")) {
+            runInterp = true;
+        } else if (!strcmp(argv[i], "-O0") || !strcmp(argv[i], "-O1") || !strcmp(argv[i], "-O2")) {
+            passOptions.optLevel = argv[i][2] - '0';
+        } else if (!strcmp(argv[i], "--verify-each")) {
+            passOptions.verifyEach = true;
+        } else if (!strncmp(argv[i], "-fno-", 5)) {
+            passOptions.disabled.insert(argv[i] + 5);
+        } else if (!strncmp(argv[i], "-funroll-factor=", 16) || !strncmp(argv[i], "-funroll-limit=", 15) ||
+                   !strncmp(argv[i], "-funswitch-limit=", 17) || !strncmp(argv[i], "-finline-limit=", 15)) {
+            const char *value = strchr(argv[i], '=') + 1;
+            char *end;
+            long n = strtol(value, &end, 10);
+            if (!*value || *end || n < 1 || n > 1 << 16) {
+                std::cerr << "Invalid value in " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!strncmp(argv[i], "-funroll-factor=", 16)) {
+                int factor = 1;
+                while (factor * 2 <= n) factor *= 2;
+                passOptions.unrollFactor = factor;
+            } else if (!strncmp(argv[i], "-funroll-limit=", 15)) {
+                passOptions.unrollLimit = n;
+            } else if (!strncmp(argv[i], "-funswitch-limit=", 17)) {
+                passOptions.unswitchLimit = n;
+            } else {
+                passOptions.inlineLimit = n;
+            }
+        } else if (!strncmp(argv[i], "--switch-table-min-density=", 27)) {
+            const char *value = argv[i] + 27;
+            char *end;
+            long n = strtol(value, &end, 10);
+            if (!*value || *end || n < 1 || n > 100) {
+                std::cerr << "Invalid value in " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+            SwitchStmt::tableMinDensity = n;
+        } else if (!strncmp(argv[i], "-f", 2) && argv[i][2]) {
+            passOptions.enabled.insert(argv[i] + 2);
+        } else if (!strcmp(argv[i], "--stats")) {
+            passOptions.stats = true;
+        } else if (!strcmp(argv[i], "--inline-report")) {
+            passOptions.inlineReport = true;
+        } else if (!strcmp(argv[i], "--spill-report")) {
+            spillReport = true;
+        } else if (!strcmp(argv[i], "--from-tac")) {
+            fromTAC = true;
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (argv[i][0] == '-') {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        } else {
+            inputPath = argv[i];
+        }
+    }
+
+    if(!inputPath){
         std::cerr << "Incorrect Usage. Correct usage is..." << std::endl;
-        std::cerr << "edcomp <input.eco>" << std::endl;
+        std::cerr << "edcomp [-O0|-O1|-O2] [--verify-each] [--stats] [--inline-report] [--spill-report] [--regalloc=linear-scan|irc] [-f<pass>|-fno-<pass>] [-funroll-factor=N] [-funroll-limit=N] [-funswitch-limit=N] [-finline-limit=N] [--switch-table-min-density=N] [--emit=asm|tac|tac-bin] [--emit-after=<pass>] [-o <file>] [--from-tac] [--run] [--bench-dataflow] [--bench-regalloc] <input.eco>" << std::endl;
         
         return EXIT_FAILURE; 
     }
 
-    std::string contents;
-    std::stringstream file_contents;
+    std::vector<TAC> tacCode;
+    if (fromTAC) {
+        std::string error;
+        if (!readTACFile(inputPath, tacCode, error)) {
+            std::cerr << "ERROR: " << inputPath << ": " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        // Phis only come from --emit-after in the middle of the SSA passes;
+        // nothing after them would know what to do with one
+        for (const auto &tac : tacCode) {
+            if (tac.op == "phi" && emit == "asm") {
+                std::cerr << "ERROR: " << inputPath << ": cannot compile TAC in SSA form" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    } else {
+        std::string contents;
+        std::stringstream file_contents;
+        
+        {
+            std::fstream input_file(inputPath, std::ios::in);
+            file_contents <<  input_file.rdbuf();
+            contents = file_contents.str();
+        }
+
+        // tokenize(contents);
+        Lexer lexer(contents);
+        // while(*lexer.BufferPtr){
+        //     Token token;
+        //     lexer.next(token);
+        //     cout << TokenStr[token.type] << ": " << token.value.value_or("") << endl;
+        // }
+
+        Parser parser(lexer);
+        ASTProgram *prog = parser.parse();
+        // prog->print();
+        SymbolTable symTab;
+        prog->resolveSymbol(symTab);
+        string tempVar;
+        tacCode = prog->generateTAC(tempVar);
+    }
+
+    if (benchFlow) {
+        benchDataflow(tacCode);
+        return EXIT_SUCCESS;
+    }
+
+    // -O0 hands the front end's TAC straight to the backend; the CFG is only
+    // built to optimise it or, with --verify-each, to check it
+    Statistics stats;
+    if (passOptions.optLevel > 0 || passOptions.verifyEach || !passOptions.emitAfter.empty()) {
+        Module module = buildModule(tacCode);
+        PassManager pm(passOptions);
+        buildPipeline(pm, passOptions);
+        for (const auto &name : passOptions.disabled) {
+            if (!pm.isOptional(name) && name != "peephole" && passOptions.optLevel > 0) {
+                std::cerr << "Unknown or required pass in -fno-" << name << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        for (const auto &name : passOptions.enabled) {
+            if (!pm.isOptional(name) && passOptions.optLevel > 0) {
+                std::cerr << "Unknown or required pass in -f" << name << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        if (!passOptions.emitAfter.empty()) {
+            if (!pm.contains(passOptions.emitAfter)) {
+                std::cerr << "Unknown or disabled pass in --emit-after=" << passOptions.emitAfter << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (emit == "asm") emit = "tac";
+        }
+        pm.run(module, stats);
+        if (passOptions.optLevel > 0) tacCode = flattenModule(module);
+    }
+
+    if (benchAlloc) {
+        benchRegAlloc(tacCode);
+        return EXIT_SUCCESS;
+    }
     
-    {
-        std::fstream input_file(argv[1], std::ios::in);
-        file_contents <<  input_file.rdbuf();
-        contents = file_contents.str();
-    }
-
-    // tokenize(contents);
-    Lexer lexer(contents);
-    // while(*lexer.BufferPtr){
-    //     Token token;
-    //     lexer.next(token);
-    //     cout << TokenStr[token.type] << ": " << token.value.value_or("") << endl;
-    // }
-
-    Parser parser(lexer);
-    ASTProgram *prog = parser.parse();
-    // prog->print();
-    SymbolTable symTab;
-    prog->resolveSymbol(symTab);
-    string tempVar;
-    std::vector<TAC> tacCode = prog->generateTAC(tempVar);
+    if (runInterp) {
+        Module module = buildModule(tacCode);
+        Interpreter interp(module);
+        InterpResult result;
+        std::string error;
+        if (!interp.run("main", result, error)) {
+            std::cerr << "ERROR: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        printInterpResult(std::cout, result);
+        if (passOptions.stats) stats.print(std::cerr);
+        return EXIT_SUCCESS;
+    }
+
+    if (emit == "tac" || emit == "tac-bin") {
+        std::ofstream file;
+        if (outputPath) file.open(outputPath, std::ios::binary);
+        std::ostream &out = outputPath ? file : std::cout;
+        if (emit == "tac") writeTextTAC(out, tacCode);
+        else writeBinaryTAC(out, tacCode);
+        if (passOptions.stats) stats.print(std::cerr);
+        return EXIT_SUCCESS;
+    }
     
     for (auto &tac : tacCode) {
         tac.print();
     }
-    ofstream outfile("aprog.S");
+    ofstream outfile(outputPath ? outputPath : "aprog.S");
 
     // CodeGenerator codeGen(outfile);
     // codeGen.generate(prog);
 
+    // Register allocation and the peephole optimiser run in the backend,
+    // after the passes, and count their work with theirs
     TACtoASM codeGen(outfile);
-    codeGen.generateAssembly(tacCode);
+    BackendOptions backend;
+    if (regalloc.empty()) regalloc = passOptions.optLevel >= 2 ? "irc" : "linear-scan";
+    backend.allocator = regalloc == "irc" ? RegisterAllocator::IteratedCoalescing : RegisterAllocator::LinearScan;
+    backend.peephole = passOptions.optLevel > 0 && !passOptions.disabled.count("peephole");
+    backend.spillReport = spillReport ? &std::cerr : nullptr;
+    codeGen.generateAssembly(tacCode, backend, stats);
+    if (passOptions.stats) stats.print(std::cerr);
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
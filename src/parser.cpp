@@ -180,6 +180,10 @@ FuncDecl *Parser::parseFunction()
 {
   std::unique_ptr<Block> stmts = std::make_unique<Block>();
 
+  // An `inline` hint may come before the return type
+  bool inlineHint = token.type == TokenType::INLINE;
+  if (inlineHint) consume(TokenType::INLINE);
+
   // Parse the return type of the function (assumed 'int')
   consume(TokenType::INT);
 
@@ -192,8 +196,10 @@ FuncDecl *Parser::parseFunction()
   consume(TokenType::LEFT_PAREN);
   std::vector<std::string> params;
 
-  // Parse each parameter if available
-  if (token.type != TokenType::RIGHT_PAREN) {
+  // Parse each parameter if available; `(void)` declares none
+  if (token.type == TokenType::VOID) {
+    consume(TokenType::VOID);
+  } else if (token.type != TokenType::RIGHT_PAREN) {
     do {
       consume(TokenType::INT); // Assume each param is of type 'int'
       expect(TokenType::ID);
@@ -216,7 +222,9 @@ FuncDecl *Parser::parseFunction()
   consume(TokenType::RIGHT_BRACE);  // Consume the closing brace
 
   // Return a new function declaration object
-  return new FuncDecl(name, std::move(params), std::move(stmts));
+  FuncDecl *decl = new FuncDecl(name, std::move(params), std::move(stmts));
+  decl->inlineHint = inlineHint;
+  return decl;
 }
 
 